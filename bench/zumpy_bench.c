@@ -0,0 +1,331 @@
+// Zumpy benchmark suite.
+//
+// Times the core operations across array sizes from L1-resident to larger than a typical last level cache,
+// and across ranks 1 to 4, and prints the results as JSON so they can be compared from release to release.
+//
+// usage: zumpy_bench [--max-elements N] [--min-time SECONDS] [--output FILE]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/c/include/zumpy.h"
+#include <time.h>
+
+// ---------------------------------------------------------------------------------------------------------------
+// allocation counting. When built with ZUMPY_BENCH_COUNT_ALLOCS the linker routes the library's malloc family
+// through these wrappers (-Wl,--wrap=malloc,...).
+
+static size_t alloc_count = 0;
+static size_t alloc_bytes = 0;
+
+#ifdef ZUMPY_BENCH_COUNT_ALLOCS
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size)
+{
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    alloc_count++;
+    alloc_bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr)
+{
+    __real_free(ptr);
+}
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------
+
+// state shared by the operations being timed
+typedef struct
+{
+    array arr;
+    size_t shape[4];
+    size_t rank;
+    size_t** slice_idx;
+    size_t* slice_dims;
+    FILE* print_stream;
+    volatile float sink;
+} bench_ctx;
+
+// an operation to time; returns the number of bytes it touched
+typedef size_t (*bench_op)(bench_ctx* ctx);
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// odometer increment of an index over the array's shape; returns false after the last index
+static bool next_index(size_t* idx, size_t* shape, size_t rank)
+{
+    for (size_t i = rank; i-- > 0;)
+    {
+        if (++idx[i] < shape[i])
+            return true;
+        idx[i] = 0;
+    }
+    return false;
+}
+
+static bool is_even(void* value)
+{
+    return *(int32_t*)value % 2 == 0;
+}
+
+static size_t op_init(bench_ctx* ctx)
+{
+    array tmp;
+    arr_init(&tmp, ctx->shape, ctx->rank, INT32);
+    size_t bytes = tmp.total_size * tmp.type_size;
+    arr_free(&tmp);
+    return bytes;
+}
+
+static size_t op_at(bench_ctx* ctx)
+{
+    size_t idx[4] = {0, 0, 0, 0};
+    float sum = 0;
+    do
+        sum += *(int32_t*)arr_at(&ctx->arr, idx);
+    while (next_index(idx, ctx->shape, ctx->rank));
+    ctx->sink = sum;
+    return ctx->arr.total_size * ctx->arr.type_size;
+}
+
+static size_t op_set(bench_ctx* ctx)
+{
+    size_t idx[4] = {0, 0, 0, 0};
+    int32_t value = 0;
+    do
+    {
+        arr_set(&ctx->arr, idx, &value);
+        value++;
+    }
+    while (next_index(idx, ctx->shape, ctx->rank));
+    return ctx->arr.total_size * ctx->arr.type_size;
+}
+
+static size_t op_fill(bench_ctx* ctx)
+{
+    int32_t value = 7;
+    arr_fill(&ctx->arr, &value);
+    return ctx->arr.total_size * ctx->arr.type_size;
+}
+
+static size_t op_sum(bench_ctx* ctx)
+{
+    ctx->sink = arr_sum(&ctx->arr);
+    return ctx->arr.total_size * ctx->arr.type_size;
+}
+
+static size_t op_slice(bench_ctx* ctx)
+{
+    array sub;
+    arr_slice(&ctx->arr, ctx->slice_idx, ctx->slice_dims, ctx->rank, &sub);
+    size_t bytes = 2 * sub.total_size * sub.type_size;
+    arr_free(&sub);
+    return bytes;
+}
+
+static size_t op_filter(bench_ctx* ctx)
+{
+    array dest = {.data = NULL};
+    arr_filter(&ctx->arr, &is_even, NULL, 0, ANY, &dest);
+    size_t bytes = (ctx->arr.total_size + dest.total_size) * ctx->arr.type_size;
+    arr_free(&dest);
+    return bytes;
+}
+
+static size_t op_filter_range(bench_ctx* ctx)
+{
+    array dest = {.data = NULL};
+    arr_filter_range(&ctx->arr, 0, 1000, NULL, 0, ANY, &dest);
+    size_t bytes = (ctx->arr.total_size + dest.total_size) * ctx->arr.type_size;
+    arr_free(&dest);
+    return bytes;
+}
+
+static size_t op_print(bench_ctx* ctx)
+{
+    rewind(ctx->print_stream);
+    arr_fprint(&ctx->arr, ctx->print_stream);
+    fflush(ctx->print_stream);
+    return ctx->arr.total_size * ctx->arr.type_size;
+}
+
+typedef struct
+{
+    const char* name;
+    bench_op op;
+} bench_entry;
+
+static const bench_entry entries[] = {
+    { "arr_init", op_init },
+    { "arr_fill", op_fill },
+    { "arr_set", op_set },
+    { "arr_at", op_at },
+    { "arr_sum", op_sum },
+    { "arr_slice", op_slice },
+    { "arr_filter", op_filter },
+    { "arr_filter_range", op_filter_range },
+    { "arr_print", op_print },
+};
+
+// closest shape of the given rank with (at most) the given number of elements
+static size_t make_shape(size_t elements, size_t rank, size_t* shape)
+{
+    size_t side = 1;
+    while (true)
+    {
+        size_t total = 1;
+        for (size_t i = 0; i < rank; ++i)
+            total *= side + 1;
+        if (total > elements)
+            break;
+        side++;
+    }
+
+    size_t total = 1;
+    for (size_t i = 0; i < rank; ++i)
+    {
+        shape[i] = side;
+        total *= side;
+    }
+    return total;
+}
+
+// run op until min_time has passed (at least once) and write one JSON result object
+static void run(FILE* out, bool* first, const bench_entry* entry, bench_ctx* ctx, double min_time)
+{
+    size_t iterations = 0, bytes = 0;
+    size_t allocs_before = alloc_count, alloc_bytes_before = alloc_bytes;
+    double best = 1e300, total = 0.0;
+    while (iterations == 0 || total < min_time)
+    {
+        double start = now_seconds();
+        bytes = entry->op(ctx);
+        double elapsed = now_seconds() - start;
+        total += elapsed;
+        if (elapsed < best)
+            best = elapsed;
+        iterations++;
+    }
+
+    size_t elements = ctx->arr.total_size;
+    fprintf(out, "%s    {\"op\": \"%s\", \"rank\": %zu, \"shape\": [", *first ? "" : ",\n", entry->name, ctx->rank);
+    for (size_t i = 0; i < ctx->rank; ++i)
+        fprintf(out, "%s%zu", i ? ", " : "", ctx->shape[i]);
+    fprintf(out, "], \"elements\": %zu, \"iterations\": %zu, \"best_ns\": %.0f, \"mean_ns\": %.0f, "
+                 "\"ns_per_element\": %.4f, \"gb_per_s\": %.4f, ",
+            elements, iterations, best * 1e9, total / iterations * 1e9,
+            best * 1e9 / elements, bytes / best / 1e9);
+#ifdef ZUMPY_BENCH_COUNT_ALLOCS
+    fprintf(out, "\"allocations\": %.2f, \"allocated_bytes\": %.0f}",
+            (double)(alloc_count - allocs_before) / iterations, (double)(alloc_bytes - alloc_bytes_before) / iterations);
+#else
+    (void)allocs_before;
+    (void)alloc_bytes_before;
+    fprintf(out, "\"allocations\": null, \"allocated_bytes\": null}");
+#endif
+    *first = false;
+}
+
+int main(int argc, char** argv)
+{
+    size_t max_elements = (size_t)1 << 24;
+    double min_time = 0.1;
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--max-elements") == 0 && i + 1 < argc)
+            max_elements = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+            min_time = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--max-elements N] [--min-time SECONDS] [--output FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* out = output ? fopen(output, "w") : stdout;
+    if (out == NULL)
+    {
+        perror(output);
+        return 1;
+    }
+
+    // 4 KiB (L1) up to 64 MiB of int32 (past most last level caches)
+    const size_t sizes[] = { (size_t)1 << 10, (size_t)1 << 13, (size_t)1 << 16, (size_t)1 << 20, (size_t)1 << 24 };
+
+    char* print_buf = NULL;
+    size_t print_len = 0;
+    bench_ctx ctx;
+    ctx.print_stream = open_memstream(&print_buf, &print_len);
+
+    fprintf(out, "{\n  \"library\": \"zumpy\",\n  \"path\": \"c\",\n  \"dtype\": \"int32\",\n  \"results\": [\n");
+    bool first = true;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        if (sizes[s] > max_elements)
+            break;
+
+        for (size_t rank = 1; rank <= 4; ++rank)
+        {
+            ctx.rank = rank;
+            make_shape(sizes[s], rank, ctx.shape);
+            arr_init(&ctx.arr, ctx.shape, rank, INT32);
+
+            // slice every other index of dimension 0 and everything else
+            ctx.slice_dims = malloc(sizeof(size_t) * rank);
+            ctx.slice_idx = malloc(sizeof(size_t*) * rank);
+            for (size_t d = 0; d < rank; ++d)
+            {
+                size_t step = d == 0 ? 2 : 1;
+                ctx.slice_dims[d] = (ctx.shape[d] + step - 1) / step;
+                ctx.slice_idx[d] = malloc(sizeof(size_t) * ctx.slice_dims[d]);
+                for (size_t i = 0; i < ctx.slice_dims[d]; ++i)
+                    ctx.slice_idx[d][i] = i * step;
+            }
+
+            // arr_set leaves 0, 1, 2, ... in the array for the operations after it
+            for (size_t e = 0; e < sizeof(entries) / sizeof(entries[0]); ++e)
+                run(out, &first, &entries[e], &ctx, min_time);
+
+            for (size_t d = 0; d < rank; ++d)
+                free(ctx.slice_idx[d]);
+            free(ctx.slice_idx);
+            free(ctx.slice_dims);
+            arr_free(&ctx.arr);
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    fclose(ctx.print_stream);
+    free(print_buf);
+    if (output)
+        fclose(out);
+    return 0;
+}
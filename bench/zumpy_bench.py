@@ -0,0 +1,162 @@
+# Benchmark harness for the Python (ctypes) binding in src/python/zumpy.py.
+#
+# Measures the same operations as zumpy_bench.c end to end through the ctypes path, across sizes and ranks 1 to 4,
+# and prints the results as JSON in the same format.
+#
+# usage: python3 zumpy_bench.py --lib path/to/libZumpy.so [--max-elements N] [--min-time SECONDS] [--output FILE]
+
+import argparse
+import json
+import os
+import sys
+import tempfile
+import time
+from ctypes import POINTER, c_int32, cast
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SIZES = [1 << 10, 1 << 13, 1 << 16, 1 << 20]
+
+
+def load_zumpy(lib):
+    # zumpy.py loads ./ext/libZumpy.so relative to the working directory, so give it one
+    workdir = tempfile.mkdtemp(prefix='zumpy_bench_')
+    os.mkdir(os.path.join(workdir, 'ext'))
+    os.symlink(os.path.abspath(lib), os.path.join(workdir, 'ext', 'libZumpy.so'))
+    os.chdir(workdir)
+    sys.path.insert(0, os.path.join(HERE, '..', 'src', 'python'))
+    import zumpy
+    return zumpy
+
+
+def make_shape(elements, rank):
+    side = 1
+    while (side + 1) ** rank <= elements:
+        side += 1
+    return [side] * rank
+
+
+def all_indices(shape):
+    idx = [0] * len(shape)
+    while True:
+        yield tuple(idx)
+        for i in reversed(range(len(shape))):
+            idx[i] += 1
+            if idx[i] < shape[i]:
+                break
+            idx[i] = 0
+        else:
+            return
+
+
+def is_even(x):
+    return cast(x, POINTER(c_int32)).contents.value % 2 == 0
+
+
+class stdout_to_devnull():
+    # arr_print writes to the C stdout, so redirect the file descriptor rather than sys.stdout
+    def __enter__(self):
+        sys.stdout.flush()
+        self.saved = os.dup(1)
+        self.devnull = os.open(os.devnull, os.O_WRONLY)
+        os.dup2(self.devnull, 1)
+
+    def __exit__(self, *args):
+        os.dup2(self.saved, 1)
+        os.close(self.devnull)
+        os.close(self.saved)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--lib', required=True, help='path to libZumpy.so')
+    parser.add_argument('--max-elements', type=int, default=1 << 16)
+    parser.add_argument('--min-time', type=float, default=0.1)
+    parser.add_argument('--output')
+    args = parser.parse_args()
+
+    output = os.path.abspath(args.output) if args.output else None
+    zumpy = load_zumpy(args.lib)
+
+    results = []
+    for size in SIZES:
+        if size > args.max_elements:
+            break
+
+        for rank in range(1, 5):
+            shape = make_shape(size, rank)
+            arr = zumpy.array(shape, 'int32')
+            indices = list(all_indices(shape))
+            slice_indices = [range(0, shape[0], 2)] + [range(n) for n in shape[1:]]
+            elements = len(indices)
+
+            def op_init():
+                zumpy.array(shape, 'int32')
+                return elements * 4
+
+            def op_fill():
+                arr.fill(7)
+                return elements * 4
+
+            def op_set():
+                for v, idx in enumerate(indices):
+                    arr[idx] = v
+                return elements * 4
+
+            def op_at():
+                total = 0
+                for idx in indices:
+                    total += arr[idx]
+                return elements * 4
+
+            def op_sum():
+                arr.sum()
+                return elements * 4
+
+            def op_slice():
+                sub = arr.slice(slice_indices)
+                return 2 * sub.arr.total_size * 4
+
+            def op_filter():
+                dest = arr.filter(is_even, [], 'ANY')
+                return (elements + (dest.arr.total_size if dest else 0)) * 4
+
+            def op_filter_range():
+                dest = arr.filter_range(0, 1000, [], 'ANY')
+                return (elements + (dest.arr.total_size if dest else 0)) * 4
+
+            def op_print():
+                with stdout_to_devnull():
+                    str(arr)
+                return elements * 4
+
+            ops = [('arr_init', op_init), ('arr_fill', op_fill), ('arr_set', op_set), ('arr_at', op_at),
+                   ('arr_sum', op_sum), ('arr_slice', op_slice), ('arr_filter', op_filter),
+                   ('arr_filter_range', op_filter_range), ('arr_print', op_print)]
+
+            for name, op in ops:
+                iterations, total, best, touched = 0, 0.0, float('inf'), 0
+                while iterations == 0 or total < args.min_time:
+                    start = time.perf_counter()
+                    touched = op()
+                    elapsed = time.perf_counter() - start
+                    total += elapsed
+                    best = min(best, elapsed)
+                    iterations += 1
+
+                results.append({
+                    'op': name, 'rank': rank, 'shape': shape, 'elements': elements, 'iterations': iterations,
+                    'best_ns': round(best * 1e9), 'mean_ns': round(total / iterations * 1e9),
+                    'ns_per_element': best * 1e9 / elements, 'gb_per_s': touched / best / 1e9,
+                    'allocations': None, 'allocated_bytes': None
+                })
+
+    report = json.dumps({'library': 'zumpy', 'path': 'ctypes', 'dtype': 'int32', 'results': results}, indent=2)
+    if output:
+        with open(output, 'w') as f:
+            f.write(report + '\n')
+    else:
+        print(report)
+
+
+if __name__ == '__main__':
+    main()
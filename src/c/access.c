@@ -6,26 +6,175 @@ void* arr_at(array* arr, size_t* index)
     if (arr->data)
     {
         int t_shape_size = arr->shape_size;
+        STATS_COUNT(STAT_ARR_AT, arr->type_size);
         return ((char*)(arr->data + arr->type_size*calculate_offset(arr, index, t_shape_size)));
     }
+    else if (arr->packed)
+    {
+        STATS_COUNT(STAT_ARR_AT, arr->type_size);
+        return packed_at(arr, calculate_offset(arr, index, arr->shape_size));
+    }
 
     return NULL;
 }
 
 void arr_set(array* arr, size_t* index, void* value)
 {
+    // compressed arrays are read-mostly; go back to plain storage to write
+    arr_decompress(arr);
+    // copy-on-write if the buffer is shared with another array
+    buffer_make_unique(arr);
+
     // only do anything if data is non-empty
     if (arr->data)
     {
         int t_shape_size = arr->shape_size;
-        memcpy(((char*)(arr->data + arr->type_size*calculate_offset(arr, index, t_shape_size))), value, arr->type_size);
+        size_t offset = calculate_offset(arr, index, t_shape_size);
+        memcpy(((char*)(arr->data + arr->type_size*offset)), value, arr->type_size);
+        zone_map_invalidate(arr, offset);
+        STATS_COUNT(STAT_ARR_SET, arr->type_size);
+    }
+}
+
+// internal function for the flat offset of the i-th index in an n x shape_size index buffer; false if any entry is
+// out of range for its dimension (which would otherwise alias another element)
+static bool offset_of(array* arr, size_t* indices, size_t i, size_t* offset)
+{
+    size_t* index = indices + i * arr->shape_size;
+    if (index[0] >= arr->arr_shape[0])
+        return false;
+    *offset = index[0];
+    for (size_t d = 1; d < arr->shape_size; ++d)
+    {
+        if (index[d] >= arr->arr_shape[d])
+            return false;
+        *offset = *offset * arr->arr_shape[d] + index[d];
+    }
+    return true;
+}
+
+// internal function for the flat offset of the i-th entry of a batch, given as indices or (if indices is NULL) as
+// flat offsets; false if it is out of range
+static bool batch_offset(array* arr, size_t* indices, size_t* offsets, size_t i, size_t* offset)
+{
+    if (indices)
+        return offset_of(arr, indices, i, offset);
+    *offset = offsets[i];
+    return *offset < arr->total_size;
+}
+
+// internal function to copy n elements at the given flat offsets (or at indices, if offsets is NULL) into out;
+// returns the number of out-of-range positions, whose slots are zeroed
+static size_t get_many(array* arr, size_t* indices, size_t* offsets, size_t n, void* out)
+{
+    if (!arr->data && !arr->packed)
+    {
+        memset(out, 0, n * arr->type_size);
+        return n;
+    }
+
+    STATS_BEGIN();
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t offset;
+        if (!batch_offset(arr, indices, offsets, i, &offset))
+        {
+            memset((char*)out + i * arr->type_size, 0, arr->type_size);
+            bad++;
+            continue;
+        }
+        // compressed arrays decode through the block cache, so nearby offsets cost one decode per block
+        void* src = arr->packed ? (void*)packed_at(arr, offset) : (char*)arr->data + offset * arr->type_size;
+        memcpy((char*)out + i * arr->type_size, src, arr->type_size);
+    }
+    STATS_END(STAT_ARR_GET_MANY, n * arr->type_size);
+    return bad;
+}
+
+// internal function to write n values at the given flat offsets (or at indices, if offsets is NULL); returns the
+// number of out-of-range positions, in which case nothing is written
+static size_t set_many(array* arr, size_t* indices, size_t* offsets, size_t n, void* values)
+{
+    if (!arr->data && !arr->packed)
+        return n;
+
+    // check every position first so a bad batch doesn't leave the array half written
+    size_t bad = 0;
+    size_t offset;
+    for (size_t i = 0; i < n; ++i)
+        if (!batch_offset(arr, indices, offsets, i, &offset))
+            bad++;
+    if (bad > 0)
+        return bad;
+
+    arr_decompress(arr);
+    buffer_make_unique(arr);
+    if (!arr->data)
+        return n;
+
+    STATS_BEGIN();
+    for (size_t i = 0; i < n; ++i)
+    {
+        batch_offset(arr, indices, offsets, i, &offset);
+        memcpy((char*)arr->data + offset * arr->type_size, (char*)values + i * arr->type_size, arr->type_size);
+        zone_map_invalidate(arr, offset);
     }
+    STATS_END(STAT_ARR_SET_MANY, n * arr->type_size);
+    return 0;
+}
+
+size_t arr_get_many(array* arr, size_t* indices, size_t n, void* out)
+{
+    return get_many(arr, indices, NULL, n, out);
+}
+
+size_t arr_set_many(array* arr, size_t* indices, size_t n, void* values)
+{
+    return set_many(arr, indices, NULL, n, values);
+}
+
+size_t arr_get_flat(array* arr, size_t* offsets, size_t n, void* out)
+{
+    return get_many(arr, NULL, offsets, n, out);
+}
+
+size_t arr_set_flat(array* arr, size_t* offsets, size_t n, void* values)
+{
+    return set_many(arr, NULL, offsets, n, values);
 }
 
 void arr_fill(array* arr, void* value)
 {
+    STATS_BEGIN();
+    arr_decompress(arr);
+    buffer_make_unique(arr);
+
     // only do anything if data is non-empty
     if (arr->data)
-        for (size_t i = 0; i < arr->total_size; ++i)
-            memcpy((char*)(arr->data + i*arr->type_size), value, arr->type_size);
+    {
+        if (arr->type_size == sizeof(uint32_t))
+        {
+            // whole-word stores the compiler can turn into vector stores, rather than a memcpy per element
+            uint32_t word;
+            memcpy(&word, value, sizeof(uint32_t));
+            uint32_t* out = arr->data;
+            for (size_t i = 0; i < arr->total_size; ++i)
+                out[i] = word;
+        }
+        else if (arr->total_size > 0)
+        {
+            // copy the first element, then keep doubling the filled prefix
+            memcpy(arr->data, value, arr->type_size);
+            size_t filled = 1;
+            while (filled < arr->total_size)
+            {
+                size_t n = filled < arr->total_size - filled ? filled : arr->total_size - filled;
+                memcpy((char*)arr->data + filled * arr->type_size, arr->data, n * arr->type_size);
+                filled += n;
+            }
+        }
+        zone_map_invalidate_all(arr);
+    }
+    STATS_END(STAT_ARR_FILL, arr->total_size * arr->type_size);
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#define _DEFAULT_SOURCE
+
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <sys/mman.h>
+
+// Allocation policy for large array storage.
+//
+// Below the threshold (and with ALLOC_HEAP) buffers come from malloc. Above it they are mapped with mmap on a
+// huge page boundary, either asking the kernel for transparent huge pages (MADV_HUGEPAGE) or from the hugetlb pool
+// (MAP_HUGETLB), which needs pages reserved by the administrator and falls back to transparent huge pages when
+// none are free. The mapping is then faulted in up front by the worker threads, one contiguous slice each
+// (pool_parallel_for) with one write per huge page, so the page faults are taken in parallel at allocation instead of
+// one at a time by the first write or scan. Scans themselves run on the calling thread, so no NUMA placement is
+// attempted.
+
+#define HUGE_PAGE_BYTES ((size_t)2 << 20)
+
+static alloc_policy current_policy = ALLOC_HEAP;
+static size_t policy_min_bytes = 64 << 20;
+
+void arr_set_alloc_policy(alloc_policy policy, size_t min_bytes)
+{
+    if (policy >= ALLOC_POLICY_COUNT)
+        return;
+    __atomic_store_n(&policy_min_bytes, min_bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&current_policy, policy, __ATOMIC_RELAXED);
+}
+
+alloc_policy arr_storage_policy(array* arr)
+{
+    return arr->data && arr->buffer ? arr->buffer->policy : ALLOC_HEAP;
+}
+
+// internal function to write one byte per huge page in [start, end) huge pages of the mapping
+static void touch_pages(void* ctx, size_t start, size_t end)
+{
+    volatile char* base = ctx;
+    for (size_t i = start; i < end; ++i)
+        base[i * HUGE_PAGE_BYTES] = 0;
+}
+
+// internal function to map length bytes (a multiple of HUGE_PAGE_BYTES) starting on a huge page boundary
+static void* map_aligned(size_t length)
+{
+    // map one huge page extra and trim both ends
+    char* raw = mmap(NULL, length + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return NULL;
+
+    size_t head = (HUGE_PAGE_BYTES - (uintptr_t)raw % HUGE_PAGE_BYTES) % HUGE_PAGE_BYTES;
+    if (head > 0)
+        munmap(raw, head);
+    munmap(raw + head + length, HUGE_PAGE_BYTES - head);
+    return raw + head;
+}
+
+void* alloc_mapped(size_t bytes, alloc_policy* policy, size_t* mapping_bytes)
+{
+    *policy = __atomic_load_n(&current_policy, __ATOMIC_RELAXED);
+    if (*policy == ALLOC_HEAP || bytes == 0 || bytes < __atomic_load_n(&policy_min_bytes, __ATOMIC_RELAXED))
+    {
+        *policy = ALLOC_HEAP;
+        return NULL;
+    }
+
+    size_t length = (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+    void* data = NULL;
+
+#ifdef MAP_HUGETLB
+    if (*policy == ALLOC_HUGETLB)
+    {
+        data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED)
+            data = NULL;
+    }
+#endif
+    if (data == NULL)
+    {
+        *policy = ALLOC_HUGE_PAGES;
+        data = map_aligned(length);
+        if (data == NULL)
+        {
+            *policy = ALLOC_HEAP;
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(data, length, MADV_HUGEPAGE);
+#endif
+    }
+
+    pool_parallel_for(length / HUGE_PAGE_BYTES, touch_pages, data);
+    *mapping_bytes = length;
+    return data;
+}
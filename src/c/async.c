@@ -0,0 +1,254 @@
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <pthread.h>
+
+// Asynchronous operations.
+//
+// Each *_async call packs its arguments into a future and queues it on the worker threads (pool.c). The worker runs
+// the ordinary synchronous function, marks the future finished, wakes any waiters and then calls the completion
+// callback. The worker and a running callback each hold a use of the future; arr_future_free only marks it freed
+// while a use is outstanding, and whoever drops the last use destroys it, so the callback can read the result (or
+// free the future) even if another thread frees it at the same time.
+//
+// Operations only read the array, so several may run on one array at once. The exception is the zone map, which
+// arr_filter_range and the cached arr_sum build and refresh lazily; the *_async calls for those bring it up to date
+// on the calling thread before queuing, which leaves the workers only reading it.
+
+struct arr_future
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool finished;
+    bool freed;
+    size_t users;
+    arr_future_callback callback;
+    void* user_data;
+
+    // the operation and its arguments
+    void (*operation)(struct arr_future*);
+    void (*task)(void*);
+    void* task_arg;
+    array* arr;
+    array* dest;
+    bool (*filter)(void*);
+    void (*block_filter)(void*, size_t, bool*);
+    size_t* secondary_indices;
+    size_t secondary_indices_size;
+    filter_type ftype;
+    double low;
+    double high;
+    float result;
+};
+
+static void destroy(arr_future* future)
+{
+    pthread_mutex_destroy(&future->lock);
+    pthread_cond_destroy(&future->cond);
+    free(future);
+}
+
+// internal function to drop a use of the future, destroying it if it was freed and this was the last use
+static void release(arr_future* future)
+{
+    pthread_mutex_lock(&future->lock);
+    bool last = --future->users == 0 && future->freed;
+    pthread_mutex_unlock(&future->lock);
+    if (last)
+        destroy(future);
+}
+
+static void run_future(void* arg)
+{
+    arr_future* future = arg;
+    future->operation(future);
+
+    pthread_mutex_lock(&future->lock);
+    future->finished = true;
+    arr_future_callback callback = future->callback;
+    void* user_data = future->user_data;
+    pthread_cond_broadcast(&future->cond);
+    pthread_mutex_unlock(&future->lock);
+
+    if (callback)
+        callback(future, user_data);
+    release(future);
+}
+
+// internal function to allocate a future for the given operation
+static arr_future* new_future(void (*operation)(arr_future*))
+{
+    arr_future* future = calloc(1, sizeof(arr_future));
+    if (future == NULL)
+        return NULL;
+    pthread_mutex_init(&future->lock, NULL);
+    pthread_cond_init(&future->cond, NULL);
+    future->operation = operation;
+    // the worker's use, dropped once it has called the callback
+    future->users = 1;
+    return future;
+}
+
+// internal function to queue a future; frees it and returns NULL if it couldn't be queued
+static arr_future* submit(arr_future* future)
+{
+    if (future == NULL)
+        return NULL;
+    if (!pool_submit(run_future, future))
+    {
+        destroy(future);
+        return NULL;
+    }
+    return future;
+}
+
+static void do_task(arr_future* f)
+{
+    f->task(f->task_arg);
+}
+
+static void do_sum(arr_future* f)
+{
+    f->result = arr_sum(f->arr);
+}
+
+static void do_filter(arr_future* f)
+{
+    arr_filter(f->arr, f->filter, f->secondary_indices, f->secondary_indices_size, f->ftype, f->dest);
+}
+
+static void do_filter_range(arr_future* f)
+{
+    arr_filter_range(f->arr, f->low, f->high, f->secondary_indices, f->secondary_indices_size, f->ftype, f->dest);
+}
+
+static void do_filter_block(arr_future* f)
+{
+    arr_filter_block(f->arr, f->block_filter, f->secondary_indices, f->secondary_indices_size, f->ftype, f->dest);
+}
+
+arr_future* arr_async(void (*task)(void*), void* arg)
+{
+    arr_future* future = new_future(do_task);
+    if (future)
+    {
+        future->task = task;
+        future->task_arg = arg;
+    }
+    return submit(future);
+}
+
+arr_future* arr_sum_async(array* arr)
+{
+    arr_future* future = new_future(do_sum);
+    if (future)
+    {
+        if (arr_aggregate_cached(arr))
+            zone_map_refresh(arr);
+        future->arr = arr;
+    }
+    return submit(future);
+}
+
+// internal function to fill in the arguments shared by the filters
+static void set_filter_args(arr_future* future, array* arr, size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest)
+{
+    future->arr = arr;
+    future->secondary_indices = secondary_indices;
+    future->secondary_indices_size = secondary_indices_size;
+    future->ftype = ftype;
+    future->dest = dest;
+}
+
+arr_future* arr_filter_async(array* arr, bool (*filter)(void*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest)
+{
+    arr_future* future = new_future(do_filter);
+    if (future)
+    {
+        set_filter_args(future, arr, secondary_indices, secondary_indices_size, ftype, dest);
+        future->filter = filter;
+    }
+    return submit(future);
+}
+
+arr_future* arr_filter_range_async(array* arr, double low, double high, size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest)
+{
+    arr_future* future = new_future(do_filter_range);
+    if (future)
+    {
+        zone_map_refresh(arr);
+        set_filter_args(future, arr, secondary_indices, secondary_indices_size, ftype, dest);
+        future->low = low;
+        future->high = high;
+    }
+    return submit(future);
+}
+
+arr_future* arr_filter_block_async(array* arr, void (*filter)(void*, size_t, bool*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest)
+{
+    arr_future* future = new_future(do_filter_block);
+    if (future)
+    {
+        set_filter_args(future, arr, secondary_indices, secondary_indices_size, ftype, dest);
+        future->block_filter = filter;
+    }
+    return submit(future);
+}
+
+bool arr_future_poll(arr_future* future)
+{
+    pthread_mutex_lock(&future->lock);
+    bool finished = future->finished;
+    pthread_mutex_unlock(&future->lock);
+    return finished;
+}
+
+void arr_future_wait(arr_future* future)
+{
+    pthread_mutex_lock(&future->lock);
+    while (!future->finished)
+        pthread_cond_wait(&future->cond, &future->lock);
+    pthread_mutex_unlock(&future->lock);
+}
+
+void arr_future_on_complete(arr_future* future, arr_future_callback callback, void* user_data)
+{
+    pthread_mutex_lock(&future->lock);
+    bool finished = future->finished;
+    if (!finished)
+    {
+        future->callback = callback;
+        future->user_data = user_data;
+    }
+    else
+        future->users++;
+    pthread_mutex_unlock(&future->lock);
+
+    // already done: nobody else will call it
+    if (finished)
+    {
+        callback(future, user_data);
+        release(future);
+    }
+}
+
+float arr_future_result(arr_future* future)
+{
+    arr_future_wait(future);
+    return future->result;
+}
+
+void arr_future_free(arr_future* future)
+{
+    if (future == NULL)
+        return;
+
+    // a queued or running operation still uses the future; the worker or a running callback destroys it once done
+    pthread_mutex_lock(&future->lock);
+    while (!future->finished)
+        pthread_cond_wait(&future->cond, &future->lock);
+    future->freed = true;
+    bool unused = future->users == 0;
+    pthread_mutex_unlock(&future->lock);
+    if (unused)
+        destroy(future);
+}
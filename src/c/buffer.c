@@ -0,0 +1,187 @@
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <sys/mman.h>
+
+// Reference-counted storage behind array.data.
+//
+// Several arrays may point into the same buffer (arr_share, arr_view_rows). Readers never care; every write path
+// calls buffer_make_unique first, which copies the array's elements into a buffer of its own only when somebody
+// else still references the current one (copy-on-write), or when the buffer is a read-only mapping. Writable shared
+// memory segments are the exception: they are always written in place so other processes see the writes. arr_free
+// just drops a reference.
+
+// internal function behind buffer_alloc/buffer_alloc_zeroed
+static struct arr_buffer* create(size_t bytes, bool zeroed)
+{
+    struct arr_buffer* buf = malloc(sizeof(struct arr_buffer));
+    if (buf == NULL)
+        return NULL;
+
+    // large buffers may get mapped pages, depending on the allocation policy (alloc.c)
+    buf->mapping_bytes = 0;
+    buf->mapping = alloc_mapped(bytes, &buf->policy, &buf->mapping_bytes);
+    buf->kind = buf->mapping ? BUFFER_MAPPED : BUFFER_HEAP;
+    buf->data = buf->mapping;
+
+    // always allocate at least one byte so an array with no elements still has valid data
+    if (buf->data == NULL)
+        buf->data = zeroed ? calloc(bytes > 0 ? bytes : 1, 1) : malloc(bytes > 0 ? bytes : 1);
+    if (buf->data == NULL)
+    {
+        free(buf);
+        return NULL;
+    }
+    buf->bytes = bytes;
+    buf->refcount = 1;
+    buf->read_only = false;
+    STATS_ALLOC(bytes);
+    STATS_POLICY(buf->policy, bytes);
+    return buf;
+}
+
+struct arr_buffer* buffer_alloc(size_t bytes)
+{
+    return create(bytes, false);
+}
+
+struct arr_buffer* buffer_alloc_zeroed(size_t bytes)
+{
+    return create(bytes, true);
+}
+
+struct arr_buffer* buffer_wrap_mapping(void* mapping, size_t mapping_bytes, void* data, size_t bytes, buffer_kind kind, bool read_only)
+{
+    struct arr_buffer* buf = malloc(sizeof(struct arr_buffer));
+    if (buf == NULL)
+        return NULL;
+
+    buf->data = data;
+    buf->bytes = bytes;
+    buf->refcount = 1;
+    buf->kind = kind;
+    buf->policy = ALLOC_HEAP;
+    buf->read_only = read_only;
+    buf->mapping = mapping;
+    buf->mapping_bytes = mapping_bytes;
+    return buf;
+}
+
+void buffer_retain(struct arr_buffer* buf)
+{
+    // atomic so arrays sharing a buffer can be used from different threads (e.g by async operations)
+    if (buf)
+        __atomic_add_fetch(&buf->refcount, 1, __ATOMIC_RELAXED);
+}
+
+void buffer_release(struct arr_buffer* buf)
+{
+    if (buf == NULL)
+        return;
+
+    if (__atomic_sub_fetch(&buf->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        if (buf->kind != BUFFER_SHARED)
+            STATS_FREE(buf->bytes);
+        if (buf->mapping)
+            munmap(buf->mapping, buf->mapping_bytes);
+        else
+            free(buf->data);
+        free(buf);
+    }
+}
+
+bool buffer_resize(array* arr, size_t bytes)
+{
+    struct arr_buffer* buf = arr->buffer;
+
+    // sole owner of a heap buffer that starts at our data: grow it in place
+    if (buf && buf->kind == BUFFER_HEAP && __atomic_load_n(&buf->refcount, __ATOMIC_ACQUIRE) == 1 && buf->data == arr->data)
+    {
+        void* alloc = realloc(buf->data, bytes > 0 ? bytes : 1);
+        if (alloc == NULL)
+            return false;
+        STATS_FREE(buf->bytes);
+        STATS_ALLOC(bytes);
+        buf->data = alloc;
+        buf->bytes = bytes;
+        arr->data = alloc;
+        return true;
+    }
+
+    // shared, mapped or a view into the middle of a buffer: move our elements into a heap buffer of our own
+    struct arr_buffer* own = buffer_alloc(bytes);
+    if (own == NULL)
+        return false;
+
+    size_t used = arr->type_size * arr->total_size;
+    if (arr->data)
+        memcpy(own->data, arr->data, used < bytes ? used : bytes);
+    buffer_release(buf);
+    arr->buffer = own;
+    arr->data = own->data;
+    return true;
+}
+
+void buffer_make_unique(array* arr)
+{
+    struct arr_buffer* buf = arr->buffer;
+    if (buf == NULL || (buf->kind == BUFFER_SHARED && !buf->read_only))
+        return;
+    if (!buf->read_only && __atomic_load_n(&buf->refcount, __ATOMIC_ACQUIRE) == 1)
+        return;
+
+    buffer_resize(arr, arr->type_size * row_length(arr) * arr->capacity);
+}
+
+// internal function to start dest as an array of the same shape and type as src, without any storage
+static void init_header(array* src, array* dest, size_t rows)
+{
+    dest->arr_shape = malloc(sizeof(size_t) * src->shape_size);
+    dest->arr_shape[0] = rows;
+    for (size_t i = 1; i < src->shape_size; ++i)
+        dest->arr_shape[i] = src->arr_shape[i];
+    dest->shape_size = src->shape_size;
+    dest->type_size = src->type_size;
+    dest->total_size = rows * row_length(src);
+    dest->capacity = rows;
+    dest->dtype = src->dtype;
+    dest->zone_map = NULL;
+    dest->packed = NULL;
+    dest->buffer = NULL;
+    dest->data = NULL;
+}
+
+void arr_view_rows(array* src, size_t start, size_t stop, array* dest)
+{
+    if ((!src->data && !src->packed) || start > stop || stop > src->arr_shape[0])
+        return;
+
+    init_header(src, dest, stop - start);
+    size_t offset = start * row_length(src);
+
+    // compressed arrays have no plain buffer to share, so the view gets decoded copies of the rows
+    if (src->packed)
+    {
+        dest->buffer = buffer_alloc(dest->type_size * dest->total_size);
+        dest->data = dest->buffer->data;
+        read_elements(src, offset, dest->total_size, dest->data);
+        return;
+    }
+
+    buffer_retain(src->buffer);
+    dest->buffer = src->buffer;
+    dest->data = (char*)src->data + offset * src->type_size;
+}
+
+void arr_share(array* src, array* dest)
+{
+    if (!src->data && !src->packed)
+        return;
+
+    arr_view_rows(src, 0, src->arr_shape[0], dest);
+}
+
+bool arr_is_shared(array* arr)
+{
+    return arr->buffer != NULL && __atomic_load_n(&arr->buffer->refcount, __ATOMIC_ACQUIRE) > 1;
+}
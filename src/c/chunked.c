@@ -0,0 +1,605 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <pthread.h>
+#include <unistd.h>
+
+// Out-of-core execution over .zmp files (see io.c for the layout).
+//
+// A chunked_array only keeps the header in memory. Operations walk the file a chunk of whole rows at a time with
+// two chunk buffers per input: while one is being processed, a reader thread fills the other with the next chunk
+// (pread, so it never races the main thread over the file position). Each operation sizes its chunks so that all
+// of its buffers together fit in the memory budget (chunk_rows_for). Each chunk is wrapped as a plain array so the in-memory
+// operations (arr_sum, arr_filter_range, arr_filter_block) do the actual work. Results the size of the input are
+// written to an output .zmp file chunk by chunk instead of being kept in memory.
+
+// background reader that loads one chunk into one of two buffers
+struct chunk_reader
+{
+    chunked_array* carr;
+    size_t chunk_rows;
+    void* buffers[2];
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool pending; // a chunk was requested and isn't read yet
+    bool stop;
+    size_t chunk;
+    int slot;
+    bool ok; // result of the last read
+};
+
+// number of elements in one row (everything below index 0)
+static size_t chunk_row_length(chunked_array* carr)
+{
+    size_t len = 1;
+    for (size_t i = 1; i < carr->shape_size; ++i)
+        len *= carr->arr_shape[i];
+    return len;
+}
+
+// internal function to read the given chunk of rows into out; false on a short read
+static bool read_chunk(chunked_array* carr, size_t chunk_rows, size_t chunk, void* out)
+{
+    size_t row_bytes = carr->type_size * chunk_row_length(carr);
+    size_t first_row = chunk * chunk_rows;
+    size_t rows = carr->arr_shape[0] - first_row < chunk_rows ? carr->arr_shape[0] - first_row : chunk_rows;
+    size_t bytes = rows * row_bytes;
+    off_t offset = carr->data_offset + first_row * row_bytes;
+
+    size_t done = 0;
+    while (done < bytes)
+    {
+        ssize_t n = pread(fileno(carr->file), (char*)out + done, bytes - done, offset + done);
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+static void* reader_main(void* arg)
+{
+    struct chunk_reader* r = arg;
+    pthread_mutex_lock(&r->lock);
+    while (true)
+    {
+        while (!r->pending && !r->stop)
+            pthread_cond_wait(&r->cond, &r->lock);
+        if (r->stop)
+            break;
+
+        size_t chunk = r->chunk;
+        void* out = r->buffers[r->slot];
+        pthread_mutex_unlock(&r->lock);
+        bool ok = read_chunk(r->carr, r->chunk_rows, chunk, out);
+        pthread_mutex_lock(&r->lock);
+
+        r->ok = ok;
+        r->pending = false;
+        pthread_cond_broadcast(&r->cond);
+    }
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+// internal function to ask the reader for a chunk; it is read into buffers[chunk % 2]
+static void reader_request(struct chunk_reader* r, size_t chunk)
+{
+    pthread_mutex_lock(&r->lock);
+    r->chunk = chunk;
+    r->slot = chunk % 2;
+    r->pending = true;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
+// internal function to wait for the requested chunk; returns its buffer, or NULL if the read failed
+static void* reader_wait(struct chunk_reader* r)
+{
+    pthread_mutex_lock(&r->lock);
+    while (r->pending)
+        pthread_cond_wait(&r->cond, &r->lock);
+    void* buffer = r->ok ? r->buffers[r->slot] : NULL;
+    pthread_mutex_unlock(&r->lock);
+    return buffer;
+}
+
+static bool reader_start(struct chunk_reader* r, chunked_array* carr, size_t chunk_rows)
+{
+    size_t chunk_bytes = carr->type_size * chunk_row_length(carr) * chunk_rows;
+    r->carr = carr;
+    r->chunk_rows = chunk_rows;
+    r->buffers[0] = malloc(chunk_bytes > 0 ? chunk_bytes : 1);
+    r->buffers[1] = malloc(chunk_bytes > 0 ? chunk_bytes : 1);
+    r->pending = false;
+    r->stop = false;
+    r->ok = true;
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+
+    if (r->buffers[0] == NULL || r->buffers[1] == NULL || pthread_create(&r->thread, NULL, reader_main, r) != 0)
+    {
+        free(r->buffers[0]);
+        free(r->buffers[1]);
+        pthread_mutex_destroy(&r->lock);
+        pthread_cond_destroy(&r->cond);
+        return false;
+    }
+    return true;
+}
+
+static void reader_stop(struct chunk_reader* r)
+{
+    pthread_mutex_lock(&r->lock);
+    while (r->pending) // let an in-flight read finish before its buffer goes away
+        pthread_cond_wait(&r->cond, &r->lock);
+    r->stop = true;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+
+    pthread_join(r->thread, NULL);
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->cond);
+    free(r->buffers[0]);
+    free(r->buffers[1]);
+}
+
+// internal function to wrap a chunk of rows as an array for the in-memory operations. The view owns nothing but
+// possibly a zone map (from arr_filter_range), so it is released with zone_map_free rather than arr_free.
+static void chunk_view(chunked_array* carr, void* data, size_t rows, size_t* shape, array* view)
+{
+    shape[0] = rows;
+    for (size_t i = 1; i < carr->shape_size; ++i)
+        shape[i] = carr->arr_shape[i];
+    view->data = data;
+    view->buffer = NULL;
+    view->arr_shape = shape;
+    view->shape_size = carr->shape_size;
+    view->type_size = carr->type_size;
+    view->total_size = rows * chunk_row_length(carr);
+    view->capacity = rows;
+    view->dtype = carr->dtype;
+    view->zone_map = NULL;
+    view->packed = NULL;
+}
+
+static size_t chunk_count(chunked_array* carr, size_t chunk_rows)
+{
+    return (carr->arr_shape[0] + chunk_rows - 1) / chunk_rows;
+}
+
+static size_t rows_in_chunk(chunked_array* carr, size_t chunk_rows, size_t chunk)
+{
+    size_t first_row = chunk * chunk_rows;
+    return carr->arr_shape[0] - first_row < chunk_rows ? carr->arr_shape[0] - first_row : chunk_rows;
+}
+
+// internal function to finish an output file; it is removed if anything went wrong
+static bool close_output(FILE* out, const char* path, bool ok)
+{
+    if (fclose(out) != 0)
+        ok = false;
+    if (!ok)
+        remove(path);
+    return ok;
+}
+
+bool chunked_open(chunked_array* carr, const char* path, size_t memory_budget)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    uint64_t flags;
+    if (!zmp_read_header(file, &carr->dtype, &carr->arr_shape, &carr->shape_size, &flags))
+    {
+        fclose(file);
+        return false;
+    }
+
+    carr->file = file;
+    carr->type_size = get_type_size(carr->dtype);
+    carr->total_size = 1;
+    for (size_t i = 0; i < carr->shape_size; ++i)
+        carr->total_size *= carr->arr_shape[i];
+    carr->data_offset = ftell(file);
+    carr->memory_budget = memory_budget;
+    return true;
+}
+
+// internal function for the number of rows per chunk of an operation that holds fixed bytes plus row_cost bytes per
+// chunk row (every buffer it keeps at once, e.g two prefetch buffers per input and its output), so the whole
+// operation stays within the memory budget. Chunks are at least one row.
+static size_t chunk_rows_for(chunked_array* carr, size_t row_cost, size_t fixed)
+{
+    size_t rows = row_cost > 0 && carr->memory_budget > fixed ? (carr->memory_budget - fixed) / row_cost : 0;
+    return rows > 0 ? rows : 1;
+}
+
+void chunked_close(chunked_array* carr)
+{
+    if (carr->file == NULL)
+        return;
+
+    fclose(carr->file);
+    free(carr->arr_shape);
+    carr->file = NULL;
+    carr->arr_shape = NULL;
+}
+
+bool chunked_sum(chunked_array* carr, float* sum)
+{
+    *sum = 0.0;
+    if (carr->file == NULL)
+        return false;
+    if (carr->total_size == 0)
+        return true;
+
+    // just the two prefetch buffers
+    size_t row_bytes = carr->type_size * chunk_row_length(carr);
+    size_t chunk_rows = chunk_rows_for(carr, 2 * row_bytes, 0);
+    struct chunk_reader reader;
+    if (!reader_start(&reader, carr, chunk_rows))
+        return false;
+
+    size_t shape[carr->shape_size];
+    size_t num_chunks = chunk_count(carr, chunk_rows);
+    size_t row_len = chunk_row_length(carr);
+    // added up in the same order as arr_sum on the whole array (zone map blocks of rows, then the block sums), so the
+    // result doesn't depend on the chunk size. A block may span chunks, so its sum carries over
+    double total = 0.0;
+    double block_sum = 0.0;
+    size_t first_row = 0;
+    bool ok = true;
+    reader_request(&reader, 0);
+    for (size_t c = 0; ok && c < num_chunks; ++c)
+    {
+        void* data = reader_wait(&reader);
+        ok = data != NULL;
+        if (!ok)
+            break;
+        if (c + 1 < num_chunks)
+            reader_request(&reader, c + 1);
+
+        size_t rows = rows_in_chunk(carr, chunk_rows, c);
+        array view;
+        chunk_view(carr, data, rows, shape, &view);
+        for (size_t r = 0; r < rows;)
+        {
+            size_t block_rows = ZONE_MAP_BLOCK_ROWS - (first_row + r) % ZONE_MAP_BLOCK_ROWS;
+            block_rows = block_rows < rows - r ? block_rows : rows - r;
+            block_sum = sum_range(&view, r * row_len, (r + block_rows) * row_len, block_sum);
+            r += block_rows;
+            if ((first_row + r) % ZONE_MAP_BLOCK_ROWS == 0)
+            {
+                total += block_sum;
+                block_sum = 0.0;
+            }
+        }
+        first_row += rows;
+    }
+
+    reader_stop(&reader);
+    if (ok)
+        *sum = (float)(total + block_sum);
+    return ok;
+}
+
+static double element_value(type dtype, void* data, size_t offset)
+{
+    return dtype == INT32 ? ((int32_t*)data)[offset] : ((float*)data)[offset];
+}
+
+bool chunked_sum_axis(chunked_array* carr, size_t axis, const char* path)
+{
+    if (carr->file == NULL || axis >= carr->shape_size)
+        return false;
+
+    // the row splits into [outer][dim][inner] around the reduced axis
+    size_t outer = 1, dim = carr->arr_shape[axis], inner = 1;
+    for (size_t i = 1; i < axis; ++i)
+        outer *= carr->arr_shape[i];
+    for (size_t i = axis + 1; i < carr->shape_size; ++i)
+        inner *= carr->arr_shape[i];
+    size_t row_len = chunk_row_length(carr);
+
+    // result shape is the input shape without the axis (a single value for 1D arrays)
+    size_t out_shape_size = carr->shape_size > 1 ? carr->shape_size - 1 : 1;
+    size_t out_shape[out_shape_size];
+    out_shape[0] = 1;
+    for (size_t i = 0, j = 0; i < carr->shape_size; ++i)
+        if (i != axis)
+            out_shape[j++] = carr->arr_shape[i];
+
+    FILE* out = fopen(path, "wb");
+    if (out == NULL)
+        return false;
+    bool ok = zmp_write_header(out, FLOAT, out_shape, out_shape_size, 0);
+
+    // axis 0 folds every row into one; the other axes reduce each row on its own and stream the rows out. Besides
+    // the two prefetch buffers that takes a double accumulator and a float output per result element.
+    size_t row_bytes = carr->type_size * row_len;
+    size_t result_bytes = sizeof(double) + sizeof(float);
+    size_t chunk_rows = axis == 0
+        ? chunk_rows_for(carr, 2 * row_bytes, result_bytes * row_len)
+        : chunk_rows_for(carr, 2 * row_bytes + result_bytes * outer * inner, 0);
+
+    struct chunk_reader reader;
+    if (!ok || !reader_start(&reader, carr, chunk_rows))
+        return close_output(out, path, false);
+
+    size_t out_len = axis == 0 ? (carr->shape_size > 1 ? row_len : 1) : chunk_rows * outer * inner;
+    double* acc = calloc(out_len > 0 ? out_len : 1, sizeof(double));
+    float* out_chunk = malloc(sizeof(float) * (out_len > 0 ? out_len : 1));
+    ok = acc != NULL && out_chunk != NULL;
+
+    size_t num_chunks = carr->arr_shape[0] > 0 ? chunk_count(carr, chunk_rows) : 0;
+    if (ok && num_chunks > 0)
+        reader_request(&reader, 0);
+    for (size_t c = 0; ok && c < num_chunks; ++c)
+    {
+        void* data = reader_wait(&reader);
+        ok = data != NULL;
+        if (!ok)
+            break;
+        if (c + 1 < num_chunks)
+            reader_request(&reader, c + 1);
+
+        size_t rows = rows_in_chunk(carr, chunk_rows, c);
+        if (axis > 0)
+            memset(acc, 0, sizeof(double) * rows * outer * inner);
+
+        for (size_t r = 0; r < rows; ++r)
+        {
+            if (axis == 0)
+            {
+                for (size_t k = 0; k < row_len; ++k)
+                    acc[carr->shape_size > 1 ? k : 0] += element_value(carr->dtype, data, r * row_len + k);
+                continue;
+            }
+            for (size_t o = 0; o < outer; ++o)
+                for (size_t j = 0; j < dim; ++j)
+                    for (size_t i = 0; i < inner; ++i)
+                        acc[(r * outer + o) * inner + i] += element_value(carr->dtype, data, r * row_len + (o * dim + j) * inner + i);
+        }
+
+        if (axis > 0)
+        {
+            size_t n = rows * outer * inner;
+            for (size_t i = 0; i < n; ++i)
+                out_chunk[i] = acc[i];
+            ok = fwrite(out_chunk, sizeof(float), n, out) == n;
+        }
+    }
+
+    if (ok && axis == 0)
+    {
+        for (size_t i = 0; i < out_len; ++i)
+            out_chunk[i] = acc[i];
+        ok = fwrite(out_chunk, sizeof(float), out_len, out) == out_len;
+    }
+
+    reader_stop(&reader);
+    free(acc);
+    free(out_chunk);
+    return close_output(out, path, ok);
+}
+
+// internal function behind the chunked filters: runs one of the in-memory filters on every chunk and appends the
+// kept rows to the output file. Exactly one of filter (block callback) or range is used.
+static bool filter_chunks(chunked_array* carr, void (*filter)(void*, size_t, bool*), double low, double high, size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, const char* path)
+{
+    if (carr->file == NULL)
+        return false;
+
+    FILE* out = fopen(path, "wb");
+    if (out == NULL)
+        return false;
+
+    // the number of rows is only known at the end; the header is patched then
+    size_t out_shape[carr->shape_size];
+    for (size_t i = 0; i < carr->shape_size; ++i)
+        out_shape[i] = carr->arr_shape[i];
+    bool ok = zmp_write_header(out, carr->dtype, out_shape, carr->shape_size, 0);
+
+    // two prefetch buffers, the kept rows of a chunk (at most a whole chunk) and the filter's list of kept rows
+    size_t row_bytes = carr->type_size * chunk_row_length(carr);
+    size_t chunk_rows = chunk_rows_for(carr, 3 * row_bytes + 2 * sizeof(size_t), 0);
+
+    struct chunk_reader reader;
+    if (!ok || !reader_start(&reader, carr, chunk_rows))
+        return close_output(out, path, false);
+
+    size_t shape[carr->shape_size];
+    size_t kept_rows = 0;
+    size_t num_chunks = carr->arr_shape[0] > 0 ? chunk_count(carr, chunk_rows) : 0;
+    array kept = {.data = NULL};
+    if (num_chunks > 0)
+        reader_request(&reader, 0);
+    for (size_t c = 0; ok && c < num_chunks; ++c)
+    {
+        void* data = reader_wait(&reader);
+        ok = data != NULL;
+        if (!ok)
+            break;
+        if (c + 1 < num_chunks)
+            reader_request(&reader, c + 1);
+
+        array view;
+        chunk_view(carr, data, rows_in_chunk(carr, chunk_rows, c), shape, &view);
+        if (filter)
+            arr_filter_block(&view, filter, secondary_indices, secondary_indices_size, ftype, &kept);
+        else
+            arr_filter_range(&view, low, high, secondary_indices, secondary_indices_size, ftype, &kept);
+        zone_map_free(&view);
+
+        kept_rows += kept.arr_shape[0];
+        ok = fwrite(kept.data, kept.type_size, kept.total_size, out) == kept.total_size;
+    }
+    arr_free(&kept);
+    reader_stop(&reader);
+
+    // no rows: "empty" array with zero shape like arr_filter
+    out_shape[0] = kept_rows;
+    for (size_t i = 1; i < carr->shape_size; ++i)
+        out_shape[i] = kept_rows > 0 ? carr->arr_shape[i] : 0;
+    ok = ok && zmp_patch_shape(out, out_shape, carr->shape_size);
+    return close_output(out, path, ok);
+}
+
+bool chunked_filter_range(chunked_array* carr, double low, double high, size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, const char* path)
+{
+    return filter_chunks(carr, NULL, low, high, secondary_indices, secondary_indices_size, ftype, path);
+}
+
+bool chunked_filter_block(chunked_array* carr, void (*filter)(void*, size_t, bool*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, const char* path)
+{
+    return filter_chunks(carr, filter, 0.0, 0.0, secondary_indices, secondary_indices_size, ftype, path);
+}
+
+// internal function to apply op to n elements; rhs is either an array of n elements or NULL to use scalar.
+// INT32 results wrap like C integer arithmetic in 64 bits, and integer division by zero gives 0.
+static void apply_op(type dtype, elementwise_op op, void* lhs, void* rhs, double scalar, void* out, size_t n)
+{
+    switch (dtype)
+    {
+        case INT32:
+        {
+            int32_t* a = lhs;
+            int32_t* b = rhs;
+            int32_t* dest = out;
+            for (size_t i = 0; i < n; ++i)
+            {
+                int64_t x = a[i];
+                int64_t y = b ? b[i] : (int64_t)scalar;
+                switch (op)
+                {
+                    case ADD:
+                        dest[i] = (int32_t)(x + y);
+                        break;
+                    case SUBTRACT:
+                        dest[i] = (int32_t)(x - y);
+                        break;
+                    case MULTIPLY:
+                        dest[i] = (int32_t)(x * y);
+                        break;
+                    case DIVIDE:
+                        dest[i] = y != 0 ? (int32_t)(x / y) : 0;
+                        break;
+                }
+            }
+            break;
+        }
+        case FLOAT:
+        {
+            float* a = lhs;
+            float* b = rhs;
+            float* dest = out;
+            float s = (float)scalar;
+            for (size_t i = 0; i < n; ++i)
+            {
+                float y = b ? b[i] : s;
+                switch (op)
+                {
+                    case ADD:
+                        dest[i] = a[i] + y;
+                        break;
+                    case SUBTRACT:
+                        dest[i] = a[i] - y;
+                        break;
+                    case MULTIPLY:
+                        dest[i] = a[i] * y;
+                        break;
+                    case DIVIDE:
+                        dest[i] = a[i] / y;
+                        break;
+                }
+            }
+            break;
+        }
+    }
+}
+
+// internal function behind the elementwise operations; rhs is NULL to use scalar
+static bool map_chunks(chunked_array* lhs, chunked_array* rhs, elementwise_op op, double scalar, const char* path)
+{
+    if (lhs->file == NULL || (rhs && rhs->file == NULL))
+        return false;
+
+    if (rhs)
+    {
+        if (lhs->dtype != rhs->dtype || lhs->shape_size != rhs->shape_size)
+            return false;
+        for (size_t i = 0; i < lhs->shape_size; ++i)
+            if (lhs->arr_shape[i] != rhs->arr_shape[i])
+                return false;
+    }
+
+    FILE* out = fopen(path, "wb");
+    if (out == NULL)
+        return false;
+    bool ok = zmp_write_header(out, lhs->dtype, lhs->arr_shape, lhs->shape_size, 0);
+
+    // two prefetch buffers per input and the output chunk. Both inputs step through the same rows, so they share
+    // the smaller chunk size.
+    size_t row_len = chunk_row_length(lhs);
+    size_t row_cost = lhs->type_size * row_len * (rhs ? 5 : 3);
+    size_t chunk_rows = chunk_rows_for(lhs, row_cost, 0);
+    if (rhs && chunk_rows_for(rhs, row_cost, 0) < chunk_rows)
+        chunk_rows = chunk_rows_for(rhs, row_cost, 0);
+    struct chunk_reader lhs_reader, rhs_reader;
+    if (!ok || !reader_start(&lhs_reader, lhs, chunk_rows))
+        return close_output(out, path, false);
+    if (rhs && !reader_start(&rhs_reader, rhs, chunk_rows))
+    {
+        reader_stop(&lhs_reader);
+        return close_output(out, path, false);
+    }
+
+    void* out_chunk = malloc(lhs->type_size * (chunk_rows * row_len > 0 ? chunk_rows * row_len : 1));
+    ok = out_chunk != NULL;
+    size_t num_chunks = lhs->arr_shape[0] > 0 ? chunk_count(lhs, chunk_rows) : 0;
+    if (ok && num_chunks > 0)
+    {
+        reader_request(&lhs_reader, 0);
+        if (rhs)
+            reader_request(&rhs_reader, 0);
+    }
+    for (size_t c = 0; ok && c < num_chunks; ++c)
+    {
+        void* a = reader_wait(&lhs_reader);
+        void* b = rhs ? reader_wait(&rhs_reader) : NULL;
+        ok = a != NULL && (!rhs || b != NULL);
+        if (!ok)
+            break;
+        if (c + 1 < num_chunks)
+        {
+            reader_request(&lhs_reader, c + 1);
+            if (rhs)
+                reader_request(&rhs_reader, c + 1);
+        }
+
+        size_t n = rows_in_chunk(lhs, chunk_rows, c) * row_len;
+        apply_op(lhs->dtype, op, a, b, scalar, out_chunk, n);
+        ok = fwrite(out_chunk, lhs->type_size, n, out) == n;
+    }
+
+    free(out_chunk);
+    reader_stop(&lhs_reader);
+    if (rhs)
+        reader_stop(&rhs_reader);
+    return close_output(out, path, ok);
+}
+
+bool chunked_scalar_op(chunked_array* carr, elementwise_op op, double scalar, const char* path)
+{
+    return map_chunks(carr, NULL, op, scalar, path);
+}
+
+bool chunked_elementwise(chunked_array* lhs, chunked_array* rhs, elementwise_op op, const char* path)
+{
+    return map_chunks(lhs, rhs, op, 0.0, path);
+}
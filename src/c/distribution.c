@@ -0,0 +1,493 @@
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <math.h>
+
+// Histograms and quantiles.
+//
+// Everything reads the array a block of elements at a time, converted to double (so compressed arrays decode into
+// L1) and NaNs are skipped. Bin assignment for a block runs in its own loop writing bin indices and only the counting
+// is a scatter. For fixed-width bins that loop clamps in double and converts to int32_t, which the compiler
+// vectorizes; for explicit edges it is a branch free binary search, but scalar.
+//
+// Exact quantiles copy the elements once and use quickselect, narrowing the range for each larger quantile.
+// Approximate quantiles use a KLL sketch (Karnin, Lang & Liberty): a stack of compactors, where compactor h holds
+// items that each stand for 2^h inputs. When the sketch is full the lowest full compactor is sorted and every other
+// item (random offset) moves up a level. Sketches built on different chunks or threads merge by concatenating
+// their compactors level by level.
+
+#define DIST_BLOCK 1024
+#define KLL_DEFAULT_K 200
+
+// internal function to read count elements starting at flat offset start as doubles
+static void read_doubles(array* arr, size_t start, size_t count, double* out)
+{
+    int32_t scratch[DIST_BLOCK];
+    void* view = element_view(arr, start, count, scratch);
+    switch (arr->dtype)
+    {
+        case INT32:
+            for (size_t i = 0; i < count; ++i)
+                out[i] = ((int32_t*)view)[i];
+            break;
+        case FLOAT:
+            for (size_t i = 0; i < count; ++i)
+                out[i] = ((float*)view)[i];
+            break;
+    }
+}
+
+static size_t block_count(array* arr, size_t start)
+{
+    return arr->total_size - start < DIST_BLOCK ? arr->total_size - start : DIST_BLOCK;
+}
+
+void arr_histogram_fixed(array* arr, double low, double high, size_t num_bins, uint64_t* counts)
+{
+    for (size_t b = 0; b < num_bins; ++b)
+        counts[b] = 0;
+    if ((!arr->data && !arr->packed) || num_bins == 0 || num_bins >= INT32_MAX || !(high > low))
+        return;
+
+    STATS_BEGIN();
+    // one extra slot collects everything out of range (and NaN), so the counting loop has no branches
+    uint64_t* slots = calloc(num_bins + 1, sizeof(uint64_t));
+    double values[DIST_BLOCK];
+    int32_t bins[DIST_BLOCK];
+    double scale = (double)num_bins / (high - low);
+    double last = (double)(num_bins - 1);
+    int32_t outside = (int32_t)num_bins;
+
+    for (size_t start = 0; start < arr->total_size; start += DIST_BLOCK)
+    {
+        size_t count = block_count(arr, start);
+        read_doubles(arr, start, count, values);
+        for (size_t i = 0; i < count; ++i)
+        {
+            double v = values[i];
+            // the right edge belongs to the last bin, and rounding may push values just below it past the end.
+            // Clamping before the conversion also keeps it defined for values out of range
+            double pos = (v - low) * scale;
+            pos = pos < last ? pos : last;
+            pos = pos > 0.0 ? pos : 0.0;
+            bins[i] = v >= low && v <= high ? (int32_t)pos : outside;
+        }
+        for (size_t i = 0; i < count; ++i)
+            slots[bins[i]]++;
+    }
+
+    for (size_t b = 0; b < num_bins; ++b)
+        counts[b] = slots[b];
+    free(slots);
+    STATS_END(STAT_ARR_HISTOGRAM, arr->total_size * arr->type_size);
+}
+
+void arr_histogram(array* arr, double* edges, size_t num_bins, uint64_t* counts)
+{
+    for (size_t b = 0; b < num_bins; ++b)
+        counts[b] = 0;
+    if ((!arr->data && !arr->packed) || num_bins == 0)
+        return;
+
+    STATS_BEGIN();
+    uint64_t* slots = calloc(num_bins + 1, sizeof(uint64_t));
+    double values[DIST_BLOCK];
+    size_t bins[DIST_BLOCK];
+    double low = edges[0];
+    double high = edges[num_bins];
+
+    // the number of halving steps is the same for every element, so the search is branch free
+    size_t steps = 0;
+    while (((size_t)1 << steps) < num_bins + 1)
+        steps++;
+
+    for (size_t start = 0; start < arr->total_size; start += DIST_BLOCK)
+    {
+        size_t count = block_count(arr, start);
+        read_doubles(arr, start, count, values);
+        for (size_t i = 0; i < count; ++i)
+        {
+            double v = values[i];
+            // largest edge index with edges[index] <= v
+            size_t base = 0;
+            size_t len = num_bins + 1;
+            for (size_t s = 0; s < steps; ++s)
+            {
+                size_t half = len / 2;
+                base = edges[base + half] <= v ? base + half : base;
+                len -= half;
+            }
+            bins[i] = v >= low && v <= high ? (base < num_bins ? base : num_bins - 1) : num_bins;
+        }
+        for (size_t i = 0; i < count; ++i)
+            slots[bins[i]]++;
+    }
+
+    for (size_t b = 0; b < num_bins; ++b)
+        counts[b] = slots[b];
+    free(slots);
+    STATS_END(STAT_ARR_HISTOGRAM, arr->total_size * arr->type_size);
+}
+
+static void swap(double* a, double* b)
+{
+    double t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// internal function to put the k-th smallest of values[lo..hi] at index k, smaller ones before it and larger after
+static void select_kth(double* values, size_t lo, size_t hi, size_t k)
+{
+    while (hi > lo)
+    {
+        // median of three as the pivot
+        size_t mid = lo + (hi - lo) / 2;
+        double a = values[lo], b = values[mid], c = values[hi];
+        double pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+
+        // three-way partition so runs of equal values (common in integer data) don't degrade to quadratic time:
+        // [lo, less) < pivot, [less, i) == pivot, (greater, hi] > pivot
+        size_t less = lo, i = lo, greater = hi;
+        while (i <= greater)
+        {
+            if (values[i] < pivot)
+                swap(&values[i++], &values[less++]);
+            else if (values[i] > pivot)
+            {
+                swap(&values[i], &values[greater]);
+                if (greater == 0)
+                    break;
+                greater--;
+            }
+            else
+                i++;
+        }
+
+        if (k < less)
+            hi = less - 1;
+        else if (k > greater)
+            lo = greater + 1;
+        else
+            return;
+    }
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// internal function to list the order in which quantiles should be computed: ascending
+static size_t* ascending_order(double* quantiles, size_t n)
+{
+    size_t* order = malloc(sizeof(size_t) * (n > 0 ? n : 1));
+    for (size_t i = 0; i < n; ++i)
+        order[i] = i;
+    // insertion sort; n is the handful of requested quantiles
+    for (size_t i = 1; i < n; ++i)
+        for (size_t j = i; j > 0 && quantiles[order[j]] < quantiles[order[j - 1]]; --j)
+        {
+            size_t t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+    return order;
+}
+
+static double clamp_unit(double q)
+{
+    return q < 0.0 ? 0.0 : q > 1.0 ? 1.0 : q;
+}
+
+// internal function for exact quantiles with linear interpolation between the two closest ranks
+static void exact_quantiles(array* arr, double* quantiles, size_t n, double* out)
+{
+    double* values = malloc(sizeof(double) * (arr->total_size > 0 ? arr->total_size : 1));
+    size_t size = 0;
+    double block[DIST_BLOCK];
+    for (size_t start = 0; start < arr->total_size; start += DIST_BLOCK)
+    {
+        size_t count = block_count(arr, start);
+        read_doubles(arr, start, count, block);
+        for (size_t i = 0; i < count; ++i)
+            if (!isnan(block[i]))
+                values[size++] = block[i];
+    }
+
+    size_t* order = ascending_order(quantiles, n);
+    // everything before the last selected rank is no larger than it, so each search starts there
+    size_t from = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t qi = order[i];
+        if (size == 0)
+        {
+            out[qi] = NAN;
+            continue;
+        }
+        double pos = clamp_unit(quantiles[qi]) * (double)(size - 1);
+        size_t rank = (size_t)pos;
+        select_kth(values, from, size - 1, rank);
+        double lower = values[rank];
+        double upper = lower;
+        if (rank + 1 < size)
+        {
+            select_kth(values, rank + 1, size - 1, rank + 1);
+            upper = values[rank + 1];
+        }
+        out[qi] = lower + (upper - lower) * (pos - (double)rank);
+        from = rank;
+    }
+
+    free(order);
+    free(values);
+}
+
+// one level of a KLL sketch: items that each stand for 2^level inputs
+struct compactor
+{
+    double* items;
+    size_t size;
+    size_t capacity;
+};
+
+struct arr_sketch
+{
+    size_t k;
+    struct compactor* levels;
+    size_t num_levels;
+    size_t size;     // items over all levels
+    size_t max_size; // sum of the level capacities; compress when size reaches it
+    uint64_t count;  // inputs seen
+    double min;
+    double max;
+    arr_rng rng;
+};
+
+// internal function to get the number of items level h may hold before it is compacted: k for the top level,
+// shrinking by 2/3 per level below it
+static size_t level_capacity(arr_sketch* sketch, size_t h)
+{
+    double cap = ceil(pow(2.0 / 3.0, (double)(sketch->num_levels - h - 1)) * (double)sketch->k);
+    return (size_t)cap + 1;
+}
+
+static void push_item(struct compactor* level, double value)
+{
+    if (level->size == level->capacity)
+    {
+        level->capacity = level->capacity > 0 ? level->capacity * 2 : 16;
+        level->items = realloc(level->items, sizeof(double) * level->capacity);
+    }
+    level->items[level->size++] = value;
+}
+
+static void add_level(arr_sketch* sketch)
+{
+    sketch->levels = realloc(sketch->levels, sizeof(struct compactor) * (sketch->num_levels + 1));
+    sketch->levels[sketch->num_levels].items = NULL;
+    sketch->levels[sketch->num_levels].size = 0;
+    sketch->levels[sketch->num_levels].capacity = 0;
+    sketch->num_levels++;
+
+    sketch->max_size = 0;
+    for (size_t h = 0; h < sketch->num_levels; ++h)
+        sketch->max_size += level_capacity(sketch, h);
+}
+
+// internal function to compact the lowest full level: sort it and promote every other item
+static void compress(arr_sketch* sketch)
+{
+    for (size_t h = 0; h < sketch->num_levels; ++h)
+    {
+        struct compactor* level = &sketch->levels[h];
+        if (level->size < level_capacity(sketch, h))
+            continue;
+
+        if (h + 1 == sketch->num_levels)
+            add_level(sketch);
+        level = &sketch->levels[h];
+        struct compactor* up = &sketch->levels[h + 1];
+
+        qsort(level->items, level->size, sizeof(double), compare_doubles);
+        // an odd item out stays on this level
+        size_t pairs = level->size / 2;
+        size_t offset = (size_t)(arr_rng_next(&sketch->rng) >> 63);
+        size_t first = level->size - 2 * pairs;
+        for (size_t p = 0; p < pairs; ++p)
+            push_item(up, level->items[first + 2 * p + offset]);
+        level->size = first;
+        sketch->size -= pairs;
+        return;
+    }
+}
+
+arr_sketch* arr_sketch_new(size_t k)
+{
+    arr_sketch* sketch = calloc(1, sizeof(arr_sketch));
+    if (sketch == NULL)
+        return NULL;
+    sketch->k = k >= 8 ? k : KLL_DEFAULT_K;
+    sketch->min = INFINITY;
+    sketch->max = -INFINITY;
+    arr_rng_seed(&sketch->rng, 0x6b6c6cu);
+    add_level(sketch);
+    return sketch;
+}
+
+void arr_sketch_free(arr_sketch* sketch)
+{
+    if (sketch == NULL)
+        return;
+    for (size_t h = 0; h < sketch->num_levels; ++h)
+        free(sketch->levels[h].items);
+    free(sketch->levels);
+    free(sketch);
+}
+
+void arr_sketch_add(arr_sketch* sketch, double value)
+{
+    if (isnan(value))
+        return;
+
+    push_item(&sketch->levels[0], value);
+    sketch->size++;
+    sketch->count++;
+    if (value < sketch->min) sketch->min = value;
+    if (value > sketch->max) sketch->max = value;
+    if (sketch->size >= sketch->max_size)
+        compress(sketch);
+}
+
+// internal function behind arr_sketch_add_array, without the stats
+static void add_elements(arr_sketch* sketch, array* arr)
+{
+    double values[DIST_BLOCK];
+    for (size_t start = 0; start < arr->total_size; start += DIST_BLOCK)
+    {
+        size_t count = block_count(arr, start);
+        read_doubles(arr, start, count, values);
+        for (size_t i = 0; i < count; ++i)
+            arr_sketch_add(sketch, values[i]);
+    }
+}
+
+void arr_sketch_add_array(arr_sketch* sketch, array* arr)
+{
+    if (!arr->data && !arr->packed)
+        return;
+
+    STATS_BEGIN();
+    add_elements(sketch, arr);
+    STATS_END(STAT_ARR_QUANTILES, arr->total_size * arr->type_size);
+}
+
+void arr_sketch_merge(arr_sketch* dest, arr_sketch* src)
+{
+    while (dest->num_levels < src->num_levels)
+        add_level(dest);
+
+    for (size_t h = 0; h < src->num_levels; ++h)
+        for (size_t i = 0; i < src->levels[h].size; ++i)
+            push_item(&dest->levels[h], src->levels[h].items[i]);
+    dest->size += src->size;
+    dest->count += src->count;
+    if (src->min < dest->min) dest->min = src->min;
+    if (src->max > dest->max) dest->max = src->max;
+
+    while (dest->size >= dest->max_size)
+    {
+        size_t before = dest->size;
+        compress(dest);
+        if (dest->size == before)
+            break;
+    }
+}
+
+uint64_t arr_sketch_count(arr_sketch* sketch)
+{
+    return sketch->count;
+}
+
+struct weighted
+{
+    double value;
+    uint64_t weight;
+};
+
+static int compare_weighted(const void* a, const void* b)
+{
+    return compare_doubles(&((const struct weighted*)a)->value, &((const struct weighted*)b)->value);
+}
+
+void arr_sketch_quantiles(arr_sketch* sketch, double* quantiles, size_t n, double* out)
+{
+    if (sketch->count == 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = NAN;
+        return;
+    }
+
+    // every item with its weight, sorted, gives an approximate cumulative distribution
+    struct weighted* items = malloc(sizeof(struct weighted) * sketch->size);
+    size_t size = 0;
+    uint64_t total = 0;
+    for (size_t h = 0; h < sketch->num_levels; ++h)
+        for (size_t i = 0; i < sketch->levels[h].size; ++i)
+        {
+            items[size].value = sketch->levels[h].items[i];
+            items[size].weight = (uint64_t)1 << h;
+            total += items[size].weight;
+            size++;
+        }
+    qsort(items, size, sizeof(struct weighted), compare_weighted);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        double q = clamp_unit(quantiles[i]);
+        // the extremes are tracked exactly
+        if (q == 0.0 || q == 1.0)
+        {
+            out[i] = q == 0.0 ? sketch->min : sketch->max;
+            continue;
+        }
+
+        double target = q * (double)total;
+        uint64_t seen = 0;
+        out[i] = items[size - 1].value;
+        for (size_t j = 0; j < size; ++j)
+        {
+            seen += items[j].weight;
+            if ((double)seen >= target)
+            {
+                out[i] = items[j].value;
+                break;
+            }
+        }
+    }
+    free(items);
+}
+
+void arr_quantiles(array* arr, double* quantiles, size_t n, quantile_mode mode, double* out)
+{
+    if (!arr->data && !arr->packed)
+    {
+        for (size_t i = 0; i < n; ++i)
+            out[i] = NAN;
+        return;
+    }
+
+    STATS_BEGIN();
+    if (mode == QUANTILE_EXACT)
+        exact_quantiles(arr, quantiles, n, out);
+    else
+    {
+        arr_sketch* sketch = arr_sketch_new(KLL_DEFAULT_K);
+        add_elements(sketch, arr);
+        arr_sketch_quantiles(sketch, quantiles, n, out);
+        arr_sketch_free(sketch);
+    }
+    STATS_END(STAT_ARR_QUANTILES, arr->total_size * arr->type_size);
+}
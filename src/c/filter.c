@@ -1,6 +1,9 @@
 #include "include/zumpy.h"
 #include "include/zumpy_internal.h"
 
+// number of elements arr_filter_block hands to the callback at a time (rounded down to whole rows)
+#define FILTER_BLOCK_ELEMENTS 16384
+
 // iterate over the boolean array for secondary index to check if a row should be kept or not
 bool check_row_boolean(filter_type ftype, bool* keep_row_arr, size_t keep_row_arr_size)
 {
@@ -22,6 +25,7 @@ bool check_row_boolean(filter_type ftype, bool* keep_row_arr, size_t keep_row_ar
 
 void arr_filter(array* arr, bool (*filter)(void*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest)
 {
+    STATS_BEGIN();
     size_t* bounds = malloc(sizeof(size_t) * arr->shape_size);
     size_t* current_idx = malloc(sizeof(size_t) * arr->shape_size);
 
@@ -100,10 +104,9 @@ void arr_filter(array* arr, bool (*filter)(void*), size_t* secondary_indices, si
             keep_row_iter = 0;
         }
 
-        if (filter(arr_at(arr, current_idx)))
-            keep_row_arr[keep_row_iter] = true;
-        else
-            keep_row_arr[keep_row_iter] = false;
+        bool matched;
+        STATS_TIME(STAT_FILTER_CALLBACK, arr->type_size, matched = filter(arr_at(arr, current_idx)));
+        keep_row_arr[keep_row_iter] = matched;
 
         current_idx[arr->shape_size - 1]++;
         keep_row_iter++;
@@ -143,7 +146,7 @@ void arr_filter(array* arr, bool (*filter)(void*), size_t* secondary_indices, si
     if (kept_rows > 0)
     {
         // free up array if it's not empty already
-        if (dest->data != NULL)
+        if (dest->data != NULL || dest->packed != NULL)
             arr_free(dest);
 
         size_t new_shape[arr->shape_size];
@@ -192,7 +195,7 @@ void arr_filter(array* arr, bool (*filter)(void*), size_t* secondary_indices, si
     else
     {
         // if no rows match, make "empty" array with zero shape
-        if (dest->data != NULL)
+        if (dest->data != NULL || dest->packed != NULL)
             arr_free(dest);
         size_t new_shape[arr->shape_size];
         for (size_t i = 0; i < arr->shape_size; ++i)
@@ -208,5 +211,230 @@ void arr_filter(array* arr, bool (*filter)(void*), size_t* secondary_indices, si
     free(row_logical);
     if (secondary_idx_dynamic) // free secondary idx if it was dynamically allocated by algorithm
         free(secondary_indices);
+    STATS_END(STAT_ARR_FILTER, (arr->total_size + dest->total_size) * arr->type_size);
+
+}
+
+// internal function to read a single element as a double so int32 and float can share range checks
+static double value_at(type dtype, void* data, size_t offset)
+{
+    switch (dtype)
+    {
+        case INT32:
+            return ((int32_t*)data)[offset];
+        case FLOAT:
+            return ((float*)data)[offset];
+    }
+    return 0.0;
+}
+
+// internal function to check a single row against the range using ANY/ALL over the checked columns.
+// rows points at the (possibly decoded) data of the block the row belongs to.
+static bool row_in_range(type dtype, void* rows, size_t row, size_t row_len, size_t ncols, bool* checked, double low, double high, filter_type ftype)
+{
+    size_t start = row * row_len;
+    for (size_t i = 0; i < row_len; ++i)
+    {
+        if (!checked[i % ncols])
+            continue;
+
+        double v = value_at(dtype, rows, start + i);
+        bool match = v >= low && v <= high;
+        if (ftype == ANY && match)
+            return true;
+        if (ftype == ALL && !match)
+            return false;
+    }
+    return ftype == ALL;
+}
+
+// internal function to flag the columns (last index) that take part in a filter; same defaults as arr_filter
+static bool* checked_columns(array* arr, size_t* secondary_indices, size_t secondary_indices_size)
+{
+    size_t ncols = column_count(arr);
+    bool* checked = malloc(sizeof(bool) * (ncols > 0 ? ncols : 1));
+    bool check_all = secondary_indices == NULL || arr->shape_size == 1;
+    for (size_t c = 0; c < ncols; ++c)
+        checked[c] = check_all;
+    if (!check_all)
+        for (size_t i = 0; i < secondary_indices_size; ++i)
+            if (secondary_indices[i] < ncols)
+                checked[secondary_indices[i]] = true;
+    return checked;
+}
+
+// internal function to append a row to the list of kept rows, growing it geometrically
+static size_t* keep_row(size_t* kept, size_t* kept_rows, size_t* kept_capacity, size_t row)
+{
+    if (*kept_rows == *kept_capacity)
+    {
+        *kept_capacity *= 2;
+        kept = realloc(kept, sizeof(size_t) * *kept_capacity);
+    }
+    kept[(*kept_rows)++] = row;
+    return kept;
+}
+
+// internal function to (re)initialize dest with the kept rows of arr, in order
+static void copy_kept_rows(array* arr, size_t* kept, size_t kept_rows, array* dest)
+{
+    if (dest->data != NULL || dest->packed != NULL)
+        arr_free(dest);
+
+    size_t new_shape[arr->shape_size];
+    new_shape[0] = kept_rows;
+    for (size_t i = 1; i < arr->shape_size; ++i)
+        new_shape[i] = kept_rows > 0 ? arr->arr_shape[i] : 0; // "empty" array with zero shape like arr_filter
+
+    arr_init(dest, new_shape, arr->shape_size, arr->dtype);
+
+    // copy runs of consecutive rows in one go
+    size_t row_len = row_length(arr);
+    size_t row_bytes = row_len * arr->type_size;
+    size_t i = 0;
+    while (i < kept_rows)
+    {
+        size_t run = 1;
+        while (i + run < kept_rows && kept[i + run] == kept[i] + run)
+            run++;
+        read_elements(arr, kept[i] * row_len, run * row_len, (char*)dest->data + i * row_bytes);
+        i += run;
+    }
+}
+
+void arr_filter_range(array* arr, double low, double high, size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest)
+{
+    if (!arr->data && !arr->packed)
+        return;
+
+    STATS_BEGIN();
+    zone_map_refresh(arr);
+    struct zone_map* zmap = arr->zone_map;
+    size_t rows = arr->arr_shape[0];
+    size_t row_len = row_length(arr);
+    size_t ncols = zmap->num_columns;
+
+    bool* checked = checked_columns(arr, secondary_indices, secondary_indices_size);
 
-}
\ No newline at end of file
+    // rows we are keeping, grown geometrically so the cost follows the number of matches
+    size_t kept_capacity = 16;
+    size_t kept_rows = 0;
+    size_t* kept = malloc(sizeof(size_t) * kept_capacity);
+
+    // compressed arrays decode a block of rows at a time into scratch
+    void* scratch = NULL;
+    if (arr->packed)
+        scratch = malloc(arr->type_size * row_len * zmap->block_rows);
+
+    for (size_t b = 0; b < zmap->num_blocks; ++b)
+    {
+        double* bmin = zmap->min + b * ncols;
+        double* bmax = zmap->max + b * ncols;
+        uint64_t* bnan = zmap->nan_count + b * ncols;
+        bool any_overlap = false, all_overlap = true;
+        bool any_inside = false, all_inside = true;
+        for (size_t c = 0; c < ncols; ++c)
+        {
+            if (!checked[c])
+                continue;
+            bool overlap = bmax[c] >= low && bmin[c] <= high;
+            // NaN rows never match, so a block with any can't be taken whole
+            bool inside = bnan[c] == 0 && bmin[c] >= low && bmax[c] <= high;
+            any_overlap |= overlap;
+            all_overlap &= overlap;
+            any_inside |= inside;
+            all_inside &= inside;
+        }
+
+        // skip: no row in the block can match. take: every row in the block matches.
+        bool skip = ftype == ANY ? !any_overlap : !all_overlap;
+        bool take = ftype == ANY ? any_inside : all_inside;
+        if (skip)
+            continue;
+
+        size_t first_row = b * zmap->block_rows;
+        size_t last_row = first_row + zmap->block_rows;
+        if (last_row > rows)
+            last_row = rows;
+
+        void* rows_data = NULL;
+        if (!take)
+            rows_data = element_view(arr, first_row * row_len, (last_row - first_row) * row_len, scratch);
+
+        for (size_t r = first_row; r < last_row; ++r)
+        {
+            if (!take && !row_in_range(arr->dtype, rows_data, r - first_row, row_len, ncols, checked, low, high, ftype))
+                continue;
+
+            kept = keep_row(kept, &kept_rows, &kept_capacity, r);
+        }
+    }
+
+    copy_kept_rows(arr, kept, kept_rows, dest);
+
+    free(checked);
+    free(kept);
+    free(scratch);
+    STATS_END(STAT_ARR_FILTER_RANGE, (arr->total_size + dest->total_size) * arr->type_size);
+}
+
+// internal function to apply ANY/ALL over the checked columns of one row of a block filter's mask
+static bool row_matches(bool* mask, size_t row, size_t row_len, size_t ncols, bool* checked, filter_type ftype)
+{
+    bool* row_mask = mask + row * row_len;
+    for (size_t i = 0; i < row_len; ++i)
+    {
+        if (!checked[i % ncols])
+            continue;
+        if (ftype == ANY && row_mask[i])
+            return true;
+        if (ftype == ALL && !row_mask[i])
+            return false;
+    }
+    return ftype == ALL;
+}
+
+void arr_filter_block(array* arr, void (*filter)(void*, size_t, bool*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest)
+{
+    if (!arr->data && !arr->packed)
+        return;
+
+    STATS_BEGIN();
+    size_t rows = arr->arr_shape[0];
+    size_t row_len = row_length(arr);
+    size_t ncols = column_count(arr);
+    bool* checked = checked_columns(arr, secondary_indices, secondary_indices_size);
+
+    // whole rows per callback, about FILTER_BLOCK_ELEMENTS elements at a time
+    size_t block_rows = row_len > 0 && row_len < FILTER_BLOCK_ELEMENTS ? FILTER_BLOCK_ELEMENTS / row_len : 1;
+    bool* mask = malloc(sizeof(bool) * (block_rows * row_len > 0 ? block_rows * row_len : 1));
+    void* scratch = NULL;
+    if (arr->packed)
+        scratch = malloc(arr->type_size * block_rows * row_len);
+
+    size_t kept_capacity = 16;
+    size_t kept_rows = 0;
+    size_t* kept = malloc(sizeof(size_t) * kept_capacity);
+
+    for (size_t first_row = 0; first_row < rows; first_row += block_rows)
+    {
+        size_t nrows = rows - first_row < block_rows ? rows - first_row : block_rows;
+        size_t count = nrows * row_len;
+        void* block = element_view(arr, first_row * row_len, count, scratch);
+
+        memset(mask, 0, sizeof(bool) * count);
+        STATS_TIME(STAT_FILTER_CALLBACK, count * arr->type_size, filter(block, nrows, mask));
+
+        for (size_t r = 0; r < nrows; ++r)
+            if (row_matches(mask, r, row_len, ncols, checked, ftype))
+                kept = keep_row(kept, &kept_rows, &kept_capacity, first_row + r);
+    }
+
+    copy_kept_rows(arr, kept, kept_rows, dest);
+
+    free(checked);
+    free(mask);
+    free(scratch);
+    free(kept);
+    STATS_END(STAT_ARR_FILTER_BLOCK, (arr->total_size + dest->total_size) * arr->type_size);
+}
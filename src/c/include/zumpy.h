@@ -10,14 +10,27 @@
 
 typedef enum { INT32, FLOAT } type;
 
+// per-block min/max index used to skip blocks in range filters; see zone_map.c
+struct zone_map;
+
+// compressed element storage used in place of data; see packed.c
+struct packed_data;
+
+// reference-counted storage that data points into; see buffer.c
+struct arr_buffer;
+
 typedef struct
 {
     void *data;
+    struct arr_buffer *buffer; // shared between arrays created by arr_share()/arr_view_rows()
     size_t *arr_shape;
     size_t shape_size;
     size_t type_size;
     size_t total_size;
+    size_t capacity; // rows (index 0 entries) data has room for; grows with arr_append_rows()
     type dtype;
+    struct zone_map *zone_map; // built lazily by arr_filter_range(); NULL until then
+    struct packed_data *packed; // set (and data NULL) after arr_compress(); NULL otherwise
 } array;
 
 /**
@@ -67,6 +80,9 @@ void arr_free(array* arr);
 
 /**
  * @brief Access an element of the array by index.
+ * @note For compressed arrays (see arr_compress(array*)) the element is decoded into a small per-thread cache and the
+ * returned pointer is only valid until the next arr_at() call on a compressed array from the same thread. It must
+ * not be written through.
  * @param arr Reference (pointer) to an array struct.
  * @param index A size_t array (decayed to pointer) indicating the index to access.
  *
@@ -124,6 +140,77 @@ void arr_set(array* arr, size_t* index, void* value);
 
 
 
+/**
+ * @brief Read many elements in one call.
+ * This is the batched form of arr_at(array*, size_t*) for bindings (e.g Python) where every call has a fixed cost.
+ * Every entry of an index is checked against its dimension; out-of-range indices leave a zero in their slot of out.
+ * @param arr Reference (pointer) to an array struct.
+ * @param indices n indices of shape_size entries each, one after another: {i0_0, i0_1, ..., i1_0, i1_1, ...}.
+ * @param n Number of elements to read.
+ * @param out Buffer of n elements (n * type_size bytes) to copy the values into.
+ * @return Number of out-of-range indices; 0 if every element was read.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * size_t shape[] = {3, 2};
+ * array myarr;
+ * arr_init(&myarr, shape, 2, INT32);
+ * int32_t val = 10;
+ * arr_fill(&myarr, &val);
+ *
+ * size_t indices[] = { 0, 1,
+ *                      2, 0 };
+ * int32_t values[2];
+ * arr_get_many(&myarr, indices, 2, values); // values = {10, 10}
+ *
+ * arr_free(&myarr);
+ * @endcode
+ */
+size_t arr_get_many(array* arr, size_t* indices, size_t n, void* out);
+
+
+
+/**
+ * @brief Write many elements in one call; the batched form of arr_set(array*, size_t*, void*).
+ * Indices are checked as in arr_get_many(); if any is out of range nothing is written.
+ * @param arr Reference (pointer) to an array struct.
+ * @param indices n indices of shape_size entries each, laid out as in arr_get_many().
+ * @param n Number of elements to write.
+ * @param values Buffer of n elements to write, in the same order as indices.
+ * @return Number of out-of-range indices; 0 if every element was written.
+ */
+size_t arr_set_many(array* arr, size_t* indices, size_t n, void* values);
+
+
+
+/**
+ * @brief Read many elements by flat (row-major) offset, i.e offset = index[0] * shape[1] * ... + index[shape_size-1].
+ * Offsets past the end of the array leave a zero in their slot of out.
+ * @param arr Reference (pointer) to an array struct.
+ * @param offsets n flat offsets.
+ * @param n Number of elements to read.
+ * @param out Buffer of n elements to copy the values into.
+ * @return Number of out-of-range offsets; 0 if every element was read.
+ */
+size_t arr_get_flat(array* arr, size_t* offsets, size_t n, void* out);
+
+
+
+/**
+ * @brief Write many elements by flat (row-major) offset. If any offset is past the end of the array nothing is written.
+ * @param arr Reference (pointer) to an array struct.
+ * @param offsets n flat offsets.
+ * @param n Number of elements to write.
+ * @param values Buffer of n elements to write, in the same order as offsets.
+ * @return Number of out-of-range offsets; 0 if every element was written.
+ */
+size_t arr_set_flat(array* arr, size_t* offsets, size_t n, void* values);
+
+
+
 /**
  * @brief Fill an array with a constant value.
  * @param arr Reference (pointer) to an array struct.
@@ -183,6 +270,87 @@ void arr_fill(array* arr, void* value);
 
 
 
+/**
+ * @brief Initialize an array like arr_init(array*, size_t*, size_t, type) with every element set to zero.
+ * This is cheaper than arr_init followed by arr_fill with zero: the storage comes from calloc, which for large arrays
+ * maps zero pages on demand instead of writing them.
+ * @param arr Array to initialize.
+ * @param arr_shape Shape of the array, e.g {3, 2}.
+ * @param shape_size Number of dimensions (length of arr_shape).
+ * @param dtype Data type of the array.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * size_t shape[] = {1000, 1000};
+ * array myarr;
+ * arr_zeros(&myarr, shape, 2, FLOAT);
+ * arr_free(&myarr);
+ * @endcode
+ */
+void arr_zeros(array* arr, size_t* arr_shape, size_t shape_size, type dtype);
+
+
+
+/**
+ * @brief Initialize a 1D array with evenly spaced values start, start + step, ... up to but not including stop.
+ * If step doesn't move from start towards stop, the array is empty (shape {0}).
+ * @param arr Array to initialize.
+ * @param start First value.
+ * @param stop End of the range (exclusive).
+ * @param step Spacing between values; may be negative.
+ * @param dtype Data type of the array. INT32 values are truncated.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * array myarr;
+ * arr_arange(&myarr, 0, 10, 2, INT32);
+ * arr_print(&myarr);
+ * arr_free(&myarr);
+ * @endcode
+ *
+ * Output:
+ * @code
+ * 0 2 4 6 8
+ * @endcode
+ */
+void arr_arange(array* arr, double start, double stop, double step, type dtype);
+
+
+
+/**
+ * @brief Initialize a 1D array with num evenly spaced values from start to stop (both included).
+ * @param arr Array to initialize.
+ * @param start First value.
+ * @param stop Last value.
+ * @param num Number of values.
+ * @param dtype Data type of the array. INT32 values are truncated.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * array myarr;
+ * arr_linspace(&myarr, 0, 1, 5, FLOAT);
+ * arr_print(&myarr);
+ * arr_free(&myarr);
+ * @endcode
+ *
+ * Output:
+ * @code
+ * 0.000000 0.250000 0.500000 0.750000 1.000000
+ * @endcode
+ */
+void arr_linspace(array* arr, double start, double stop, size_t num, type dtype);
+
+
+
 /**
  * @brief Sum all elements in an array.
  * @note For multi-dimensional arrays this will sum ALL cells. If you want to sum a specific row or column, check arr_sum_row(array*) and arr_sum_column(array*).
@@ -190,6 +358,9 @@ void arr_fill(array* arr, void* value);
  * @see arr_sum_column(array*)
  * @param arr Reference (pointer) to an array struct.
  * @return The sum of all cells as a float.
+ * @note With the aggregate cache on (see arr_aggregate_cache(array*, bool)) only blocks written since the last call
+ * are rescanned. Either way the sum is accumulated in double precision in the same order, so the cache only changes
+ * the cost and never the result.
  *
  * @code
  * #include "zumpy.h"
@@ -214,6 +385,218 @@ float arr_sum(array* arr);
 
 
 
+/**
+ * Sum, min, max and element count of an array; see arr_aggregates_get(array*, arr_aggregates*).
+ */
+typedef struct
+{
+    double sum;
+    double min;   // INFINITY for empty arrays; NaNs are ignored
+    double max;   // -INFINITY for empty arrays; NaNs are ignored
+    size_t count; // number of elements
+} arr_aggregates;
+
+/**
+ * @brief Compute the sum, min, max and element count of an array in one pass.
+ * With the aggregate cache on (see arr_aggregate_cache(array*, bool)) only blocks written since the last call are
+ * rescanned.
+ * @param arr Reference (pointer) to an array struct.
+ * @param out Struct to store the results into.
+ */
+void arr_aggregates_get(array* arr, arr_aggregates* out);
+
+
+
+/**
+ * @brief Turn the aggregate cache of an array on or off.
+ * The cache keeps the sum, min and max of every block of rows (the zone map blocks, see arr_filter_range()). Writes
+ * through arr_set(), arr_fill() and the other library functions mark their blocks dirty, and arr_sum() and
+ * arr_aggregates_get() rescan only the dirty blocks, so re-querying a large array after a few updates costs a few
+ * blocks instead of a full scan.
+ * @note Writes made directly through arr->data or the pointer returned by arr_at() aren't seen; call
+ * arr_aggregate_cache(arr, false) and on again after them. arr_zone_map_drop() also turns the cache off.
+ * @param arr Reference (pointer) to an array struct.
+ * @param enable True to keep the cache, false to release it.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * arr_aggregate_cache(&arr, true);
+ * printf("%f\n", arr_sum(&arr)); // full scan, fills the cache
+ *
+ * size_t idx[] = {42, 0};
+ * int32_t val = 7;
+ * arr_set(&arr, idx, &val);
+ * printf("%f\n", arr_sum(&arr)); // rescans one block
+ * @endcode
+ */
+void arr_aggregate_cache(array* arr, bool enable);
+
+
+
+/**
+ * @brief Check whether an array has the aggregate cache on.
+ */
+bool arr_aggregate_cached(array* arr);
+
+
+
+/**
+ * @brief Count the elements of an array falling into each of num_bins equal-width bins spanning [low, high].
+ * Bin i covers [low + i * width, low + (i + 1) * width) and the last bin also includes high, like NumPy. Elements
+ * outside [low, high] and NaNs aren't counted.
+ * @param arr Reference (pointer) to an array struct.
+ * @param low Left edge of the first bin.
+ * @param high Right edge of the last bin; must be greater than low.
+ * @param num_bins Number of bins; must be below INT32_MAX.
+ * @param counts Array of num_bins counts to store the results into.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * uint64_t counts[10];
+ * arr_histogram_fixed(&arr, 0.0, 100.0, 10, counts); // counts[0] is the number of elements in [0, 10)
+ * @endcode
+ */
+void arr_histogram_fixed(array* arr, double low, double high, size_t num_bins, uint64_t* counts);
+
+
+
+/**
+ * @brief Count the elements of an array falling into each bin given by its edges.
+ * Bin i covers [edges[i], edges[i + 1]) and the last bin also includes its right edge. Elements outside the edges
+ * and NaNs aren't counted.
+ * @param arr Reference (pointer) to an array struct.
+ * @param edges num_bins + 1 increasing bin edges.
+ * @param num_bins Number of bins.
+ * @param counts Array of num_bins counts to store the results into.
+ */
+void arr_histogram(array* arr, double* edges, size_t num_bins, uint64_t* counts);
+
+
+
+/**
+ * How arr_quantiles(array*, double*, size_t, quantile_mode, double*) computes quantiles.
+ * QUANTILE_EXACT: selection on a copy of the elements (8 bytes per element of extra memory), interpolating linearly
+ * between the two closest ranks like NumPy. QUANTILE_SKETCH: a KLL sketch in a few kilobytes; the rank of each
+ * result is typically within about 1% of the requested one.
+ */
+typedef enum { QUANTILE_EXACT, QUANTILE_SKETCH } quantile_mode;
+
+/**
+ * @brief Compute quantiles of all elements of an array. NaNs are ignored.
+ * @param arr Reference (pointer) to an array struct.
+ * @param quantiles The n quantiles to compute, in [0, 1] (0.5 for the median).
+ * @param n Number of quantiles.
+ * @param mode QUANTILE_EXACT or QUANTILE_SKETCH.
+ * @param out Array of n values to store the results into; NaN for empty arrays.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * double q[] = {0.5, 0.9, 0.99};
+ * double result[3];
+ * arr_quantiles(&arr, q, 3, QUANTILE_EXACT, result);
+ * printf("median %f p99 %f\n", result[0], result[2]);
+ * @endcode
+ */
+void arr_quantiles(array* arr, double* quantiles, size_t n, quantile_mode mode, double* out);
+
+
+
+/**
+ * A mergeable quantile sketch (KLL). Build one per chunk or thread with arr_sketch_add_array(), combine them with
+ * arr_sketch_merge() and query the result with arr_sketch_quantiles().
+ */
+typedef struct arr_sketch arr_sketch;
+
+/**
+ * @brief Create an empty quantile sketch.
+ * @param k Accuracy parameter: the memory used and the accuracy grow with k. 200 (used for 0 or values below 8)
+ * gives ranks within about 1%.
+ * @return The sketch; free it with arr_sketch_free(). NULL if out of memory.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * // one sketch per block of rows (e.g one per thread), merged at the end
+ * arr_sketch* total = arr_sketch_new(0);
+ * for (size_t start = 0; start < arr.arr_shape[0]; start += 100000)
+ * {
+ *     size_t stop = start + 100000 < arr.arr_shape[0] ? start + 100000 : arr.arr_shape[0];
+ *     array rows;
+ *     arr_view_rows(&arr, start, stop, &rows);
+ *     arr_sketch* part = arr_sketch_new(0);
+ *     arr_sketch_add_array(part, &rows);
+ *     arr_sketch_merge(total, part);
+ *     arr_sketch_free(part);
+ *     arr_free(&rows);
+ * }
+ *
+ * double q[] = {0.5};
+ * double median;
+ * arr_sketch_quantiles(total, q, 1, &median);
+ * arr_sketch_free(total);
+ * @endcode
+ */
+arr_sketch* arr_sketch_new(size_t k);
+
+
+
+/**
+ * @brief Free a sketch created with arr_sketch_new().
+ */
+void arr_sketch_free(arr_sketch* sketch);
+
+
+
+/**
+ * @brief Add one value to a sketch. NaN is ignored.
+ */
+void arr_sketch_add(arr_sketch* sketch, double value);
+
+
+
+/**
+ * @brief Add every element of an array to a sketch. NaNs are ignored.
+ */
+void arr_sketch_add_array(arr_sketch* sketch, array* arr);
+
+
+
+/**
+ * @brief Merge the contents of src into dest, as if dest had seen every value added to src. src is left unchanged.
+ */
+void arr_sketch_merge(arr_sketch* dest, arr_sketch* src);
+
+
+
+/**
+ * @brief Number of values added to a sketch (including through merges).
+ */
+uint64_t arr_sketch_count(arr_sketch* sketch);
+
+
+
+/**
+ * @brief Estimate quantiles from a sketch. Quantiles 0 and 1 are the exact min and max.
+ * @param sketch Sketch to query.
+ * @param quantiles The n quantiles to compute, in [0, 1].
+ * @param n Number of quantiles.
+ * @param out Array of n values to store the results into; NaN for empty sketches.
+ */
+void arr_sketch_quantiles(arr_sketch* sketch, double* quantiles, size_t n, double* out);
+
+
+
 /**
  * @brief Slice an array by specifying a jagged array indicating what indices to pull from which dimensions of a source array and store them into a target aray.
  * @note For the sub array, you DO NOT need to initalize it as it will be initialized in the function for you. But you still must free it. See the example below for a full example.
@@ -293,6 +676,15 @@ void arr_slice(array* srcarray, size_t** sub_arr_idx, size_t* sub_arr_dims, size
  */
 void arr_print(array* arr);
 
+
+
+/**
+ * @brief Print the contents of an array to a stream, in the same format as arr_print(array*).
+ * @param arr Reference (pointer) to an array struct.
+ * @param stream Stream to print to, e.g a file opened with fopen() or stderr.
+ */
+void arr_fprint(array* arr, FILE* stream);
+
 /**
  * Filter type used in arr_filter(array*, bool (*)(void*), size_t*, size_t, filter_type, array*)
  * to specify whether to check if ALL columns match the condition or if at least one does.
@@ -543,4 +935,1194 @@ typedef enum {ANY, ALL} filter_type;
  * @endcode
  */
 void arr_filter(array* arr, bool (*filter)(void*), size_t* secondary_indices, size_t secondary_indices_size, filter_type, array* dest);
+
+
+/**
+ * @brief Filter an array's rows by an inclusive value range and store results into a different array, dest.
+ * This is the native counterpart to arr_filter(array*, bool (*)(void*), size_t*, size_t, filter_type, array*) for the
+ * very common "low <= value <= high" condition. Because the condition is known to the library, it can consult the
+ * array's zone map (the min/max of every column in each block of rows) and skip whole blocks that cannot match, or keep
+ * whole blocks that match entirely, without looking at their elements. On roughly sorted columns this makes the cost
+ * of a selective query proportional to the number of matching rows rather than the size of the array.
+ * @note The zone map is built on the first call and kept on the array. arr_set() and arr_fill() invalidate the affected
+ * blocks which are rebuilt on the next call. Use arr_zone_map_drop(array*) to release it.
+ * @note ANY/ALL and secondary_indices behave exactly like in arr_filter(). For 1D arrays secondary_indices is ignored.
+ * @param arr Primary array to filter
+ * @param low Lower bound (inclusive) of the range.
+ * @param high Upper bound (inclusive) of the range.
+ * @param secondary_indices Optional parameter specifying specific column(s) to apply the filter to. If NULL is passed, all columns will be checked.
+ * @param secondary_indices_size The size of the previous parameter, secondary_indices. If NULL is passed, you can pass 0.
+ * @param ftype One of "ANY" or "ALL". See arr_filter() for details.
+ * @param dest Destination array to store filtered results into. Memory will be allocated inside the function call so no need to initialize it beforehand.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * // 1000x2 array where column 0 is a sorted timestamp
+ * size_t shape[] = {1000, 2};
+ * array arr;
+ * arr_init(&arr, shape, 2, INT32);
+ *
+ * size_t idx[] = {0, 0};
+ * for (int32_t r = 0; r < 1000; ++r)
+ * {
+ *     idx[0] = r;
+ *     idx[1] = 0;
+ *     arr_set(&arr, idx, &r);
+ *     idx[1] = 1;
+ *     int32_t val = r % 7;
+ *     arr_set(&arr, idx, &val);
+ * }
+ *
+ * // keep rows where 100 <= timestamp <= 104
+ * array filtered = {.data = NULL};
+ * size_t secondary_idx[] = {0};
+ * arr_filter_range(&arr, 100, 104, secondary_idx, 1, ANY, &filtered);
+ *
+ * arr_print(&filtered);
+ *
+ * arr_free(&arr);
+ * arr_free(&filtered);
+ * @endcode
+ *
+ * Output:
+ * @code
+ * 100 2
+ * 101 3
+ * 102 4
+ * 103 5
+ * 104 6
+ * @endcode
+ */
+void arr_filter_range(array* arr, double low, double high, size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest);
+
+
+
+/**
+ * @brief Filter rows with a callback that sees a whole block of rows per call instead of one element.
+ * The callback gets a pointer to nrows contiguous rows (nrows * row length elements, row-major) and a mask with one
+ * bool per element, all false, to set for the elements that match. The rows are then kept with ANY/ALL over the mask
+ * entries of the checked columns, exactly like arr_filter(), so the callback may simply evaluate every element.
+ * This cuts the number of callback calls from one per element to one per few thousand elements, which matters most
+ * when the callback comes from an interpreter (e.g Python through ctypes).
+ * @note The rows pointer may point into the array itself and must not be written through.
+ * @param arr Primary array to filter
+ * @param filter Callback taking (rows, nrows, mask).
+ * @param secondary_indices Optional parameter specifying specific column(s) to apply the filter to. If NULL is passed, all columns will be checked.
+ * @param secondary_indices_size The size of the previous parameter, secondary_indices. If NULL is passed, you can pass 0.
+ * @param ftype One of "ANY" or "ALL". See arr_filter() for details.
+ * @param dest Destination array to store filtered results into. Memory will be allocated inside the function call so no need to initialize it beforehand.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // 2 columns per row
+ * void greater_than_10(void* rows, size_t nrows, bool* mask)
+ * {
+ *     int32_t* values = rows;
+ *     for (size_t i = 0; i < nrows * 2; ++i)
+ *         mask[i] = values[i] > 10;
+ * }
+ *
+ * // ... other code
+ *
+ * size_t shape[] = {1000, 2};
+ * array arr;
+ * arr_init(&arr, shape, 2, INT32);
+ * // ... set values
+ *
+ * array filtered = {.data = NULL};
+ * arr_filter_block(&arr, &greater_than_10, NULL, 0, ALL, &filtered);
+ *
+ * arr_free(&arr);
+ * arr_free(&filtered);
+ * @endcode
+ */
+void arr_filter_block(array* arr, void (*filter)(void*, size_t, bool*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest);
+
+
+
+/**
+ * @brief Build (or refresh) the zone map of an array ahead of time.
+ * @note This is optional; arr_filter_range() builds the zone map lazily on first use. Calling it up front moves that
+ * one-time cost out of the first query.
+ * @param arr Reference (pointer) to an array struct.
+ */
+void arr_zone_map_build(array* arr);
+
+
+
+/**
+ * @brief Release the zone map of an array, if it has one.
+ * @param arr Reference (pointer) to an array struct.
+ */
+void arr_zone_map_drop(array* arr);
+
+
+
+/**
+ * @brief Save an array to a Zumpy (.zmp) file.
+ * @note If the array has a zone map it is refreshed and stored alongside the data so arr_load() can restore it
+ * without rescanning the array. Values are written in the machine's native byte order.
+ * @param arr Reference (pointer) to an array struct.
+ * @param path Path of the file to write. An existing file is overwritten.
+ * @return true on success, false if the file could not be written.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * size_t shape[] = {3, 3};
+ * array arr, loaded;
+ * arr_init(&arr, shape, 2, INT32);
+ *
+ * int32_t val = 10;
+ * arr_fill(&arr, &val);
+ *
+ * arr_save(&arr, "myarr.zmp");
+ * arr_load(&loaded, "myarr.zmp"); // NOTE: DO NOT initialize loaded; it will be initialized for you
+ *
+ * printf("%f\n", arr_sum(&loaded)); // 90.0
+ *
+ * arr_free(&arr);
+ * arr_free(&loaded);
+ * @endcode
+ */
+bool arr_save(array* arr, const char* path);
+
+
+
+/**
+ * @brief Load an array from a Zumpy (.zmp) file written by arr_save().
+ * @note Like arr_slice(), the destination array is initialized inside the function; you still must free it.
+ * @param arr Reference (pointer) to an array struct to load into.
+ * @param path Path of the file to read.
+ * @return true on success, false if the file could not be read or is not a Zumpy file.
+ */
+bool arr_load(array* arr, const char* path);
+
+
+
+/**
+ * @brief Compress an INT32 array in place to save memory.
+ * The array is split into blocks of 1024 elements and each block is stored with whichever of frame-of-reference
+ * bit-packing, delta encoding or dictionary encoding is smallest for its values. Small-valued IDs, counters and
+ * sorted columns typically shrink several times over.
+ * arr_at(), arr_sum(), arr_filter(), arr_filter_range(), arr_slice() and arr_print() read compressed arrays directly,
+ * decoding blocks on the fly. Writes (arr_set(), arr_fill()) decompress the array first, so this is meant for
+ * read-mostly arrays.
+ * @note FLOAT arrays, and arrays that wouldn't get any smaller, are left as they are.
+ * @param arr Reference (pointer) to an array struct.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * size_t shape[] = {100000};
+ * array arr;
+ * arr_init(&arr, shape, 1, INT32);
+ *
+ * size_t idx[] = {0};
+ * for (int32_t i = 0; i < 100000; ++i)
+ * {
+ *     idx[0] = i;
+ *     int32_t val = i % 16;
+ *     arr_set(&arr, idx, &val);
+ * }
+ *
+ * printf("%zu\n", arr_storage_bytes(&arr)); // 400000
+ * arr_compress(&arr);
+ * printf("%zu\n", arr_storage_bytes(&arr)); // roughly 50000
+ *
+ * printf("%f\n", arr_sum(&arr)); // 750000.0
+ *
+ * arr_free(&arr);
+ * @endcode
+ */
+void arr_compress(array* arr);
+
+
+
+/**
+ * @brief Decompress an array compressed by arr_compress(array*) back to plain storage.
+ * @note Does nothing if the array isn't compressed. If the plain storage can't be allocated the array stays
+ * compressed, and writes to it keep doing nothing.
+ * @param arr Reference (pointer) to an array struct.
+ */
+void arr_decompress(array* arr);
+
+
+
+/**
+ * @brief Number of bytes used to store the elements of an array, compressed or not.
+ * @param arr Reference (pointer) to an array struct.
+ * @return Bytes used by the element storage (excluding the shape and zone map).
+ */
+size_t arr_storage_bytes(array* arr);
+
+
+
+/**
+ * Storage format of a sparse_array. COO (coordinate lists) is cheap to build entry by entry with sparse_insert();
+ * CSR (compressed sparse rows) is what the compute functions use. They convert a COO array to CSR on first use.
+ */
+typedef enum { COO, CSR } sparse_format;
+
+/**
+ * A 2D array that only stores its non-zero entries, for arrays that are mostly zero.
+ * In COO format row_indices/col_indices/values hold one entry per stored value (capacity is the allocated length).
+ * In CSR format row_indices holds rows + 1 offsets: the entries of row r are [row_indices[r], row_indices[r + 1]).
+ */
+typedef struct
+{
+    sparse_format format;
+    size_t rows;
+    size_t cols;
+    size_t nnz;
+    size_t capacity;
+    size_t *row_indices;
+    size_t *col_indices;
+    void *values;
+    size_t type_size;
+    type dtype;
+} sparse_array;
+
+/**
+ * @brief Initialize an empty rows x cols sparse array in COO format.
+ * @param sp Reference (pointer) to a sparse_array struct.
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @param dtype Data type of the array; must be one of INT32 or FLOAT.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * sparse_array sp;
+ * sparse_init(&sp, 1000, 1000, INT32);
+ *
+ * int32_t val = 5;
+ * sparse_insert(&sp, 3, 7, &val);
+ * sparse_insert(&sp, 999, 0, &val);
+ *
+ * printf("%f\n", sparse_sum(&sp)); // 10.0
+ *
+ * sparse_free(&sp);
+ * @endcode
+ */
+void sparse_init(sparse_array* sp, size_t rows, size_t cols, type dtype);
+
+
+
+/**
+ * @brief Free up allocated memory taken by the sparse array.
+ * @param sp Reference (pointer) to a sparse_array struct.
+ */
+void sparse_free(sparse_array* sp);
+
+
+
+/**
+ * @brief Add an entry to a sparse array.
+ * @note Entries inserted more than once at the same position are added together when the array is converted to CSR.
+ * Inserting into a CSR array converts it back to COO first, so build arrays completely before computing on them.
+ * @param sp Reference (pointer) to a sparse_array struct.
+ * @param row Row of the entry.
+ * @param col Column of the entry.
+ * @param value Value to store.
+ */
+void sparse_insert(sparse_array* sp, size_t row, size_t col, void* value);
+
+
+
+/**
+ * @brief Convert a sparse array from COO to CSR format (does nothing if it is already CSR).
+ * @param sp Reference (pointer) to a sparse_array struct.
+ */
+void sparse_to_csr(sparse_array* sp);
+
+
+
+/**
+ * @brief Build a CSR sparse array from the non-zero entries of a 2D array.
+ * @note Like arr_slice(), the sparse array is initialized inside the function; you still must free it.
+ * @param arr 2D array to convert.
+ * @param sp Reference (pointer) to the sparse_array struct to store the result into.
+ */
+void sparse_from_dense(array* arr, sparse_array* sp);
+
+
+
+/**
+ * @brief Expand a sparse array into a regular 2D array.
+ * @note The array is initialized inside the function; you still must free it.
+ * @param sp Reference (pointer) to a sparse_array struct.
+ * @param arr Reference (pointer) to the array struct to store the result into.
+ */
+void sparse_to_dense(sparse_array* sp, array* arr);
+
+
+
+/**
+ * @brief Sum all elements in a sparse array. Costs O(nnz).
+ * @param sp Reference (pointer) to a sparse_array struct.
+ * @return The sum of all cells as a float.
+ */
+float sparse_sum(sparse_array* sp);
+
+
+
+/**
+ * @brief Sum a sparse array along an axis. Costs O(nnz + rows).
+ * @param sp Reference (pointer) to a sparse_array struct.
+ * @param axis 0 to sum each column (result has cols elements) or 1 to sum each row (result has rows elements).
+ * @param dest 1D FLOAT array to store the sums into. It is initialized inside the function; you still must free it.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * sparse_array sp;
+ * sparse_init(&sp, 2, 3, INT32);
+ *
+ * int32_t val = 4;
+ * sparse_insert(&sp, 0, 2, &val);
+ * sparse_insert(&sp, 1, 2, &val);
+ *
+ * array col_sums;
+ * sparse_sum_axis(&sp, 0, &col_sums);
+ * arr_print(&col_sums);
+ *
+ * sparse_free(&sp);
+ * arr_free(&col_sums);
+ * @endcode
+ *
+ * Output:
+ * @code
+ * 0.000000 0.000000 8.000000
+ * @endcode
+ */
+void sparse_sum_axis(sparse_array* sp, size_t axis, array* dest);
+
+
+
+/**
+ * @brief Filter the rows of a sparse array, with the same ANY/ALL semantics as arr_filter().
+ * The filter is only called for stored entries, plus once for the value zero which stands in for every implicit
+ * zero, so the cost is O(nnz + rows) rather than O(rows * cols).
+ * @param sp Primary sparse array to filter.
+ * @param filter A boolean function pointer specifying your filter condition(s). See arr_filter().
+ * @param secondary_indices Optional parameter specifying specific column(s) to apply the filter to. If NULL is passed, all columns will be checked.
+ * @param secondary_indices_size The size of the previous parameter, secondary_indices. If NULL is passed, you can pass 0.
+ * @param ftype One of "ANY" or "ALL". See arr_filter().
+ * @param dest Destination sparse array (CSR) to store the kept rows into. It's best to initialize its "values" member to NULL.
+ */
+void sparse_filter(sparse_array* sp, bool (*filter)(void*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, sparse_array* dest);
+
+
+
+/**
+ * @brief Multiply a sparse matrix by a dense vector or matrix. Costs O(nnz * k) for a cols x k right hand side.
+ * @param sp Sparse rows x cols matrix.
+ * @param mat Dense 1D array of length cols (a vector) or 2D cols x k array.
+ * @param dest FLOAT array to store the product into: rows elements for a vector, rows x k for a matrix.
+ * It is initialized inside the function; you still must free it.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * sparse_array sp;
+ * sparse_init(&sp, 2, 2, FLOAT);
+ * float val = 2.0f;
+ * sparse_insert(&sp, 0, 1, &val);
+ *
+ * size_t shape[] = {2};
+ * array vec, result;
+ * arr_init(&vec, shape, 1, FLOAT);
+ * float one = 1.5f;
+ * arr_fill(&vec, &one);
+ *
+ * sparse_matmul(&sp, &vec, &result);
+ * arr_print(&result); // 3.000000 0.000000
+ *
+ * sparse_free(&sp);
+ * arr_free(&vec);
+ * arr_free(&result);
+ * @endcode
+ */
+void sparse_matmul(sparse_array* sp, array* mat, array* dest);
+
+
+
+/**
+ * @brief Make room for at least the given number of rows (entries along index 0) without changing the shape.
+ * @note Reserving up front avoids the reallocations of arr_append_rows() when the final size is known.
+ * @param arr Reference (pointer) to an array struct.
+ * @param rows Number of rows to make room for.
+ */
+void arr_reserve(array* arr, size_t rows);
+
+
+
+/**
+ * @brief Release the spare capacity left by arr_reserve() or arr_append_rows().
+ * @param arr Reference (pointer) to an array struct.
+ */
+void arr_shrink_to_fit(array* arr);
+
+
+
+/**
+ * @brief Append the rows of one array to the end of another (along index 0), in place.
+ * The capacity grows geometrically, so appending a stream of batches costs amortized O(1) per row instead of
+ * copying the whole array every time.
+ * @note Both arrays must have the same data type and the same shape apart from index 0; otherwise nothing happens.
+ * A zone map, if present, is extended and the new rows are scanned on the next arr_filter_range().
+ * @param arr Array to append to.
+ * @param rows Array holding the rows to append.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * size_t shape[] = {0, 2}; // start with no rows
+ * size_t batch_shape[] = {3, 2};
+ * array arr, batch;
+ * arr_init(&arr, shape, 2, INT32);
+ * arr_init(&batch, batch_shape, 2, INT32);
+ *
+ * for (int32_t i = 0; i < 1000; ++i)
+ * {
+ *     arr_fill(&batch, &i);
+ *     arr_append_rows(&arr, &batch);
+ * }
+ *
+ * printf("%zu %zu\n", arr.arr_shape[0], arr.capacity); // 3000 4096
+ * arr_shrink_to_fit(&arr);
+ * printf("%zu %zu\n", arr.arr_shape[0], arr.capacity); // 3000 3000
+ *
+ * arr_free(&arr);
+ * arr_free(&batch);
+ * @endcode
+ */
+void arr_append_rows(array* arr, array* rows);
+
+
+
+/**
+ * @brief Concatenate two arrays along index 0 into a new array.
+ * @note Both arrays must have the same data type and the same shape apart from index 0; otherwise nothing happens.
+ * The destination array is initialized inside the function; you still must free it.
+ * @param first Array whose rows come first.
+ * @param second Array whose rows come second.
+ * @param dest Destination array.
+ */
+void arr_concatenate(array* first, array* second, array* dest);
+
+
+
+/**
+ * @brief Make dest a view of the whole of src that shares its storage instead of copying it.
+ * The storage is reference counted: arr_free() on either array only drops a reference, and the memory is released
+ * with the last one. Writing to either array (arr_set(), arr_fill(), arr_append_rows(), ...) first gives the written
+ * array a copy of its own if the storage is still shared (copy-on-write), so the other array never sees the change.
+ * @note Writing through the pointer returned by arr_at() bypasses copy-on-write.
+ * @note Arrays in a writable shared memory segment (arr_create_shared(), arr_attach_shared()) are never copied: writes
+ * to either array go straight to the segment, so both arrays and the other processes see them.
+ * @note Compressed arrays have nothing to share; dest gets a decoded copy.
+ * @param src Array to share.
+ * @param dest Destination array. It is initialized inside the function; you still must free it.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * size_t shape[] = {3, 3};
+ * array arr, view;
+ * arr_init(&arr, shape, 2, INT32);
+ *
+ * int32_t val = 10;
+ * arr_fill(&arr, &val);
+ *
+ * arr_share(&arr, &view); // no copy
+ * printf("%d\n", arr_is_shared(&arr)); // 1
+ *
+ * val = 20;
+ * arr_fill(&view, &val); // view gets its own copy first
+ * printf("%f %f\n", arr_sum(&arr), arr_sum(&view)); // 90.0 180.0
+ *
+ * arr_free(&arr);
+ * arr_free(&view);
+ * @endcode
+ */
+void arr_share(array* src, array* dest);
+
+
+
+/**
+ * @brief Make dest a view of the rows [start, stop) of src (along index 0) that shares its storage.
+ * Rows are contiguous, so this is zero-copy just like arr_share(); see it for the ownership and copy-on-write rules.
+ * @param src Array to take the rows from.
+ * @param start First row of the view.
+ * @param stop One past the last row of the view.
+ * @param dest Destination array. It is initialized inside the function; you still must free it.
+ */
+void arr_view_rows(array* src, size_t start, size_t stop, array* dest);
+
+
+
+/**
+ * @brief Check whether an array currently shares its storage with another array.
+ * @param arr Reference (pointer) to an array struct.
+ * @return true if another array references the same storage. A write to arr then copies it first, unless it is in a
+ * writable shared memory segment.
+ */
+bool arr_is_shared(array* arr);
+
+
+
+/**
+ * State of a xoshiro256++ random number generator; see arr_rng_seed(arr_rng*, uint64_t).
+ */
+typedef struct
+{
+    uint64_t s[4];
+} arr_rng;
+
+/**
+ * @brief Seed a random number generator. The same seed always gives the same sequence.
+ * @param rng Generator to seed.
+ * @param seed Any 64-bit value.
+ */
+void arr_rng_seed(arr_rng* rng, uint64_t seed);
+
+
+
+/**
+ * @brief Advance a generator by 2^128 outputs.
+ * Calling this on copies of one generator a different number of times gives independent, non-overlapping streams,
+ * e.g one per thread.
+ * @param rng Generator to advance.
+ */
+void arr_rng_jump(arr_rng* rng);
+
+
+
+/**
+ * @brief Seed a generator and jump it to the given stream; shorthand for arr_rng_seed() and stream calls to arr_rng_jump().
+ * @param rng Generator to seed.
+ * @param seed Seed shared by all streams.
+ * @param stream Index of the stream, e.g the thread number.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... in worker thread number t, each filling its own array
+ *
+ * arr_rng rng;
+ * arr_rng_stream(&rng, 42, t);
+ * arr_random_uniform(&arrays[t], &rng, 0.0, 1.0);
+ * @endcode
+ */
+void arr_rng_stream(arr_rng* rng, uint64_t seed, size_t stream);
+
+
+
+/**
+ * @brief Draw the next raw 64-bit value from a generator.
+ */
+uint64_t arr_rng_next(arr_rng* rng);
+
+
+
+/**
+ * @brief Fill an array with uniformly distributed integers in [low, high] (both included).
+ * Does nothing if low > high.
+ * @param arr Array to fill (INT32 or FLOAT).
+ * @param rng Generator to draw from.
+ * @param low Smallest value.
+ * @param high Largest value.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * arr_rng rng;
+ * arr_rng_seed(&rng, 400);
+ *
+ * size_t shape[] = {3, 2};
+ * array myarr;
+ * arr_init(&myarr, shape, 2, INT32);
+ * arr_random_int(&myarr, &rng, 0, 50);
+ * arr_print(&myarr);
+ * arr_free(&myarr);
+ * @endcode
+ */
+void arr_random_int(array* arr, arr_rng* rng, int32_t low, int32_t high);
+
+
+
+/**
+ * @brief Fill an array with uniformly distributed values in [low, high).
+ * INT32 arrays get the values rounded down.
+ * @param arr Array to fill.
+ * @param rng Generator to draw from.
+ * @param low Lower bound (included).
+ * @param high Upper bound (excluded).
+ */
+void arr_random_uniform(array* arr, arr_rng* rng, double low, double high);
+
+
+
+/**
+ * @brief Fill an array with normally distributed values.
+ * INT32 arrays get the values rounded to the nearest integer.
+ * @param arr Array to fill.
+ * @param rng Generator to draw from.
+ * @param mean Mean of the distribution.
+ * @param stddev Standard deviation of the distribution.
+ */
+void arr_random_normal(array* arr, arr_rng* rng, double mean, double stddev);
+
+
+
+/**
+ * @brief Fill an array with 1 with probability p and 0 otherwise.
+ * @param arr Array to fill.
+ * @param rng Generator to draw from.
+ * @param p Probability of a 1, clamped to [0, 1].
+ */
+void arr_random_bernoulli(array* arr, arr_rng* rng, double p);
+
+
+
+/**
+ * Where array storage comes from; see arr_set_alloc_policy(alloc_policy, size_t).
+ * ALLOC_HEAP: malloc with regular pages. ALLOC_HUGE_PAGES: mmap on a 2 MiB boundary with MADV_HUGEPAGE, so the kernel
+ * backs it with transparent huge pages when it can. ALLOC_HUGETLB: mmap from the reserved hugetlb pool
+ * (vm.nr_hugepages); falls back to ALLOC_HUGE_PAGES when it is empty.
+ */
+typedef enum { ALLOC_HEAP, ALLOC_HUGE_PAGES, ALLOC_HUGETLB, ALLOC_POLICY_COUNT } alloc_policy;
+
+/**
+ * @brief Choose how the storage of large arrays is allocated from now on.
+ * Huge pages cut the TLB misses of scans over multi-gigabyte arrays. Storage allocated with a huge page policy is
+ * also faulted in up front by the worker threads (see arr_pool_init()), each touching one contiguous slice, so the
+ * page faults are taken in parallel when the array is allocated.
+ * Existing arrays keep their storage.
+ * @param policy Policy for arrays of at least min_bytes. ALLOC_HEAP (the default) for plain malloc.
+ * @param min_bytes Smallest storage size the policy applies to; smaller arrays always use the heap. 64 MiB by default.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * arr_set_alloc_policy(ALLOC_HUGE_PAGES, 256 << 20);
+ *
+ * size_t shape[] = {100000000, 4};
+ * array big;
+ * arr_zeros(&big, shape, 2, FLOAT);
+ * printf("%d\n", arr_storage_policy(&big)); // 1 (ALLOC_HUGE_PAGES)
+ * @endcode
+ */
+void arr_set_alloc_policy(alloc_policy policy, size_t min_bytes);
+
+
+
+/**
+ * @brief The allocation policy an array's storage actually got (after any fallback). ALLOC_HEAP for compressed
+ * arrays and arrays in shared memory.
+ */
+alloc_policy arr_storage_policy(array* arr);
+
+
+
+/**
+ * Operations counted by the instrumentation layer; indexes arr_stats.ops.
+ * STAT_FILTER_CALLBACK is the time spent inside user filter callbacks during arr_filter() and arr_filter_block(); STAT_ARR_RANDOM counts
+ * all the arr_random_* fills; STAT_ARR_GET_MANY/STAT_ARR_SET_MANY count the batched accessors (one call per batch);
+ * STAT_ARR_QUANTILES also counts arr_sketch_add_array().
+ */
+typedef enum
+{
+    STAT_ARR_INIT,
+    STAT_ARR_FREE,
+    STAT_ARR_AT,
+    STAT_ARR_SET,
+    STAT_ARR_FILL,
+    STAT_ARR_SUM,
+    STAT_ARR_SLICE,
+    STAT_ARR_FILTER,
+    STAT_FILTER_CALLBACK,
+    STAT_ARR_FILTER_RANGE,
+    STAT_ARR_PRINT,
+    STAT_INDEX_COMBINATIONS,
+    STAT_ARR_APPEND_ROWS,
+    STAT_ARR_COMPRESS,
+    STAT_ARR_RANDOM,
+    STAT_ARR_GET_MANY,
+    STAT_ARR_SET_MANY,
+    STAT_ARR_FILTER_BLOCK,
+    STAT_ARR_AGGREGATES,
+    STAT_ARR_HISTOGRAM,
+    STAT_ARR_QUANTILES,
+    STAT_OP_COUNT
+} stat_op;
+
+/**
+ * Counters for one operation.
+ * @note arr_at() and arr_set() are counted but not timed since reading the clock would cost more than the call.
+ */
+typedef struct
+{
+    uint64_t calls;
+    uint64_t bytes;       // bytes of array data read or written (or allocated, for get_index_combinations)
+    uint64_t nanoseconds; // cumulative wall time
+} arr_op_stats;
+
+/**
+ * Snapshot of the library's instrumentation counters; see arr_stats_get(arr_stats*).
+ */
+typedef struct
+{
+    arr_op_stats ops[STAT_OP_COUNT];
+    uint64_t live_bytes;  // bytes of array storage currently allocated
+    uint64_t peak_bytes;  // highest live_bytes since the last arr_stats_reset()
+    uint64_t allocations; // number of array storage allocations since the last arr_stats_reset()
+    uint64_t policy_allocations[ALLOC_POLICY_COUNT]; // allocations by the policy they got (see arr_storage_policy())
+    uint64_t policy_bytes[ALLOC_POLICY_COUNT];       // bytes allocated by policy since the last arr_stats_reset()
+} arr_stats;
+
+/**
+ * @brief Read the instrumentation counters of all threads.
+ * The counters are compiled in only when the library is built with ZUMPY_STATS (cmake -DZUMPY_STATS=ON); otherwise
+ * they cost nothing and this reports zeros. Each thread counts into its own counters, so instrumented builds don't
+ * add contention between threads.
+ * @param stats Struct to store the snapshot into.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * arr_stats_reset();
+ *
+ * size_t shape[] = {1000, 10};
+ * array arr;
+ * arr_init(&arr, shape, 2, INT32);
+ * int32_t val = 1;
+ * arr_fill(&arr, &val);
+ * arr_sum(&arr);
+ *
+ * arr_stats stats;
+ * arr_stats_get(&stats);
+ * for (size_t op = 0; op < arr_stats_op_count(); ++op)
+ *     if (stats.ops[op].calls > 0)
+ *         printf("%s: %llu calls, %llu ns\n", arr_stats_op_name(op),
+ *                (unsigned long long)stats.ops[op].calls, (unsigned long long)stats.ops[op].nanoseconds);
+ * printf("live %llu peak %llu\n", (unsigned long long)stats.live_bytes, (unsigned long long)stats.peak_bytes);
+ *
+ * arr_free(&arr);
+ * @endcode
+ */
+void arr_stats_get(arr_stats* stats);
+
+
+
+/**
+ * @brief Reset the per-operation counters, the allocation count and the peak (which restarts at the live bytes).
+ */
+void arr_stats_reset(void);
+
+
+
+/**
+ * @brief Check whether the library was built with the instrumentation counters (ZUMPY_STATS).
+ */
+bool arr_stats_enabled(void);
+
+
+
+/**
+ * @brief Name of an operation counted in arr_stats, e.g "arr_sum". NULL if op is out of range.
+ */
+const char* arr_stats_op_name(size_t op);
+
+
+
+/**
+ * @brief Number of operations counted in arr_stats (STAT_OP_COUNT).
+ */
+size_t arr_stats_op_count(void);
+
+
+
+/**
+ * Operations for chunked_scalar_op() and chunked_elementwise().
+ */
+typedef enum { ADD, SUBTRACT, MULTIPLY, DIVIDE } elementwise_op;
+
+/**
+ * An array stored in a Zumpy (.zmp) file (see arr_save()) that is processed a chunk of rows at a time, for data
+ * larger than memory. Only the header is kept in memory. Open with chunked_open(), close with chunked_close().
+ */
+typedef struct
+{
+    FILE* file;
+    size_t* arr_shape;
+    size_t shape_size;
+    size_t type_size;
+    size_t total_size;
+    type dtype;
+    size_t data_offset; // where the elements start in the file
+    size_t memory_budget; // bytes an operation may use for its chunk buffers
+} chunked_array;
+
+/**
+ * @brief Open a Zumpy (.zmp) file for chunked (out-of-core) processing.
+ * Operations read the file a chunk of whole rows at a time, prefetching the next chunk on a background thread while
+ * the current one is processed, so two chunks are in memory at a time (per input). Operations that write an output
+ * file hold one more chunk-sized buffer for the results. Each operation picks its chunk size so that all of these
+ * buffers together fit in the memory budget.
+ * @param carr Chunked array to open.
+ * @param path Path of the .zmp file.
+ * @param memory_budget Bytes an operation may use for its chunk buffers. Chunks are at least one row, so very wide
+ * rows can exceed a small budget.
+ * @return True on success; false if the file can't be opened or isn't a Zumpy file.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * chunked_array big;
+ * if (chunked_open(&big, "big.zmp", 64 << 20)) // 64 MiB of chunks
+ * {
+ *     float sum;
+ *     if (chunked_sum(&big, &sum))
+ *         printf("%f\n", sum);
+ *
+ *     // keep rows where column 0 is in [0, 100]; the result goes to another file
+ *     size_t secondary_idx[] = {0};
+ *     chunked_filter_range(&big, 0, 100, secondary_idx, 1, ANY, "filtered.zmp");
+ *
+ *     // multiply every element by 2
+ *     chunked_scalar_op(&big, MULTIPLY, 2, "doubled.zmp");
+ *
+ *     chunked_close(&big);
+ * }
+ * @endcode
+ */
+bool chunked_open(chunked_array* carr, const char* path, size_t memory_budget);
+
+
+
+/**
+ * @brief Close a chunked array opened with chunked_open().
+ */
+void chunked_close(chunked_array* carr);
+
+
+
+/**
+ * @brief Sum of all elements of a chunked array; see arr_sum(array*).
+ * @param carr Chunked array to sum.
+ * @param sum Where to store the sum; 0 on failure.
+ * @return True on success; false if the file couldn't be read.
+ */
+bool chunked_sum(chunked_array* carr, float* sum);
+
+
+
+/**
+ * @brief Sum a chunked array along one axis into a FLOAT .zmp file.
+ * The result has the shape of the input without that axis (shape {1} for a 1D array). Summing along axis 0 keeps a
+ * single row of sums in memory; other axes reduce each row on its own and stream the results to the file.
+ * @param carr Chunked array to sum.
+ * @param axis Axis to sum along.
+ * @param path Path of the output file, which can be loaded with arr_load() or opened with chunked_open().
+ * @return True on success. The output file is removed on failure.
+ */
+bool chunked_sum_axis(chunked_array* carr, size_t axis, const char* path);
+
+
+
+/**
+ * @brief Range filter (see arr_filter_range()) over a chunked array, writing the kept rows to a .zmp file.
+ * @return True on success. The output file is removed on failure.
+ */
+bool chunked_filter_range(chunked_array* carr, double low, double high, size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, const char* path);
+
+
+
+/**
+ * @brief Block-callback filter (see arr_filter_block()) over a chunked array, writing the kept rows to a .zmp file.
+ * The callback sees at most one chunk of rows per call.
+ * @return True on success. The output file is removed on failure.
+ */
+bool chunked_filter_block(chunked_array* carr, void (*filter)(void*, size_t, bool*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, const char* path);
+
+
+
+/**
+ * @brief Apply op with a scalar to every element of a chunked array, writing the result to a .zmp file of the same
+ * shape and type. For INT32 arrays the scalar is truncated to an integer and division by zero gives 0.
+ * @param carr Chunked array (left operand).
+ * @param op Operation to apply.
+ * @param scalar Right operand.
+ * @param path Path of the output file.
+ * @return True on success. The output file is removed on failure.
+ */
+bool chunked_scalar_op(chunked_array* carr, elementwise_op op, double scalar, const char* path);
+
+
+
+/**
+ * @brief Apply op to the elements of two chunked arrays of the same shape and type, writing the result to a .zmp file.
+ * @param lhs Left operand.
+ * @param rhs Right operand.
+ * @param op Operation to apply.
+ * @param path Path of the output file.
+ * @return True on success; false if the shapes or types differ. The output file is removed on failure.
+ */
+bool chunked_elementwise(chunked_array* lhs, chunked_array* rhs, elementwise_op op, const char* path);
+
+
+
+/**
+ * Handle to an operation running on the library's worker threads; see arr_sum_async(array*).
+ */
+typedef struct arr_future arr_future;
+
+/**
+ * Completion callback for arr_future_on_complete(). It runs on the worker thread that finished the operation (or on
+ * the calling thread if the operation had already finished).
+ */
+typedef void (*arr_future_callback)(arr_future* future, void* user_data);
+
+/**
+ * @brief Start the worker threads that run asynchronous operations.
+ * Calling this is optional: the workers start on the first asynchronous call with one thread per online CPU.
+ * @param threads Number of worker threads; 0 for one per online CPU.
+ * @return True if the workers were started by this call, false if they were already running.
+ */
+bool arr_pool_init(size_t threads);
+
+
+
+/**
+ * @brief Number of worker threads running (0 until the first asynchronous call or arr_pool_init()).
+ */
+size_t arr_pool_size(void);
+
+
+
+/**
+ * @brief Sum an array on a worker thread; see arr_sum(array*).
+ * The calling thread returns immediately. Get the sum with arr_future_result() and release the handle with
+ * arr_future_free().
+ * @note Operations may run concurrently, so the array (and for filters dest and secondary_indices) must stay alive
+ * and must not be modified or freed until the operation has finished. While operations on an array are running,
+ * further asynchronous operations on it may be queued and the thread that queued them may keep making read-only
+ * calls on it (arr_at(), arr_get_many(), arr_sum(), arr_filter(), arr_filter_range(), arr_filter_block(),
+ * arr_aggregates_get(), ...), compressed or not. Calls that write to it or change its storage (arr_set(),
+ * arr_fill(), arr_append_rows(), arr_compress(), arr_aggregate_cache(), arr_zone_map_drop(), arr_free(), ...) must
+ * wait until they have finished. Each dest must belong to a single operation.
+ * @param arr Array to sum.
+ * @return Handle to the operation, or NULL if it couldn't be queued.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * arr_future* first = arr_sum_async(&arr1);
+ * arr_future* second = arr_sum_async(&arr2);
+ *
+ * // ... do other work while both sums run
+ *
+ * printf("%f\n", arr_future_result(first) + arr_future_result(second));
+ * arr_future_free(first);
+ * arr_future_free(second);
+ * @endcode
+ */
+arr_future* arr_sum_async(array* arr);
+
+
+
+/**
+ * @brief Run arr_filter() on a worker thread. dest is filled in once the operation has finished.
+ * The filter callback is called on the worker thread.
+ * @return Handle to the operation, or NULL if it couldn't be queued.
+ */
+arr_future* arr_filter_async(array* arr, bool (*filter)(void*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest);
+
+
+
+/**
+ * @brief Run arr_filter_range() on a worker thread. dest is filled in once the operation has finished.
+ * @return Handle to the operation, or NULL if it couldn't be queued.
+ */
+arr_future* arr_filter_range_async(array* arr, double low, double high, size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest);
+
+
+
+/**
+ * @brief Run arr_filter_block() on a worker thread. dest is filled in once the operation has finished.
+ * @return Handle to the operation, or NULL if it couldn't be queued.
+ */
+arr_future* arr_filter_block_async(array* arr, void (*filter)(void*, size_t, bool*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, array* dest);
+
+
+
+/**
+ * @brief Run any function on a worker thread, e.g a sequence of array operations.
+ * @param task Function to run.
+ * @param arg Argument passed to task.
+ * @return Handle to the operation, or NULL if it couldn't be queued.
+ */
+arr_future* arr_async(void (*task)(void*), void* arg);
+
+
+
+/**
+ * @brief Check whether an operation has finished, without blocking.
+ */
+bool arr_future_poll(arr_future* future);
+
+
+
+/**
+ * @brief Block until an operation has finished.
+ */
+void arr_future_wait(arr_future* future);
+
+
+
+/**
+ * @brief Call a function when an operation finishes.
+ * If it has already finished the callback runs right away on the calling thread, otherwise on the worker thread
+ * that finishes it. A future has at most one callback. The future stays valid until the callback returns, even if
+ * it is freed from inside the callback or by another thread meanwhile.
+ * @param future Operation to watch.
+ * @param callback Function to call.
+ * @param user_data Passed to the callback.
+ */
+void arr_future_on_complete(arr_future* future, arr_future_callback callback, void* user_data);
+
+
+
+/**
+ * @brief Wait for an operation and return its result: the sum for arr_sum_async(), 0 for the others.
+ */
+float arr_future_result(arr_future* future);
+
+
+
+/**
+ * @brief Release an operation's handle, waiting for the operation first if it hasn't finished.
+ * A completion callback that is still running keeps the future alive; it is destroyed once the callback returns.
+ */
+void arr_future_free(arr_future* future);
+
+
+
+/**
+ * @brief Create an array in a named POSIX shared memory segment, so other processes can attach to it with
+ * arr_attach_shared(). The elements start zeroed.
+ * The segment stays around until arr_unlink_shared() is called, even after every process has freed its array.
+ * Operations that change an array's size (e.g arr_append_rows) move it into private memory first.
+ * @param arr Array to initialize; free it with arr_free() as usual.
+ * @param name Segment name, e.g "/weights" (see shm_open).
+ * @param arr_shape The shape of the array.
+ * @param shape_size The size of the shape.
+ * @param dtype The type of the array.
+ * @return False if the segment already exists or couldn't be created.
+ *
+ * @code
+ * #include "zumpy.h"
+ *
+ * // ... other code
+ *
+ * // in the parent process
+ * array weights;
+ * size_t shape[2] = {100000, 64};
+ * arr_create_shared(&weights, "/weights", shape, 2, FLOAT);
+ * // ... fill weights, then start the workers
+ *
+ * // in every worker process
+ * array w;
+ * if (arr_attach_shared(&w, "/weights", false))
+ * {
+ *     printf("%f\n", arr_sum(&w));
+ *     arr_free(&w);
+ * }
+ * @endcode
+ */
+bool arr_create_shared(array* arr, const char* name, size_t* arr_shape, size_t shape_size, type dtype);
+
+
+
+/**
+ * @brief Attach to an array created with arr_create_shared(), possibly by another process. Its shape and type are
+ * read from the segment.
+ * A read-only attachment shares the elements until the process writes to the array; the write then goes to a
+ * private copy (the other processes don't see it). A writable attachment writes straight into the segment; use
+ * arr_shared_lock() to coordinate writers with readers.
+ * @param arr Array to initialize; free it with arr_free() as usual.
+ * @param name Segment name given to arr_create_shared().
+ * @param writable Whether writes should go to the shared copy.
+ * @return False if the segment doesn't exist or doesn't hold an array.
+ */
+bool arr_attach_shared(array* arr, const char* name, bool writable);
+
+
+
+/**
+ * @brief Remove a shared memory segment's name. Arrays already attached to it keep working; the memory is released
+ * when the last of them is freed.
+ * @return False if there is no segment with that name.
+ */
+bool arr_unlink_shared(const char* name);
+
+
+
+/**
+ * @brief Take the reader/writer lock stored in an array's shared memory segment. It is shared by every process
+ * attached to the segment.
+ * Writers should hold it exclusively while writing so other processes never see half-updated rows, and so their
+ * zone maps (see arr_filter_range()) are refreshed afterwards.
+ * @note The lock isn't released if a process dies while holding it.
+ * @param arr Array created with arr_create_shared() or arr_attach_shared() (or a view of one).
+ * @param exclusive True for writing, false for reading.
+ * @return False if the array doesn't live in shared memory.
+ */
+bool arr_shared_lock(array* arr, bool exclusive);
+
+
+
+/**
+ * @brief Release the lock taken with arr_shared_lock(). Pass the same exclusive flag.
+ */
+void arr_shared_unlock(array* arr, bool exclusive);
+
+
+
+/**
+ * @brief Check whether an array's elements live in a shared memory segment. A read-only attachment stops being
+ * shared once it has been written to.
+ */
+bool arr_is_shared_memory(array* arr);
 #endif //ZUMPY_ZUMPY_H
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdint.h>
 
 // offset calculation which dynamically scales with N-dimensions
 size_t calculate_offset(array* arr, size_t* index, int shape_size);
@@ -34,5 +35,180 @@ size_t** get_index_combinations(size_t* sub_arr_dims, size_t sub_arr_dims_len, s
 
 int cmp(const void* a, const void* b);
 
+// number of elements in one row (everything below index 0)
+size_t row_length(array* arr);
+
+// number of columns used by filters, i.e the size of the last dimension (1 for 1D arrays)
+size_t column_count(array* arr);
+
+// size of the data type based off the enum; defined in zumpy.c
+int get_type_size(type dtype);
+
+// number of rows (index 0 entries) summarised by one zone map entry
+#define ZONE_MAP_BLOCK_ROWS 1024
+
+// per-block min/max for every column (last dimension index) of an array.
+// min/max are laid out block-major: entry [block * num_columns + column].
+// valid[block] is cleared by writes and the block is rescanned by zone_map_refresh.
+struct zone_map
+{
+    size_t block_rows;
+    size_t num_blocks;
+    size_t num_columns;
+    double* min;
+    double* max;
+    uint64_t* nan_count; // NaNs per block and column, laid out like min/max; they are left out of min/max
+    bool* valid;
+    double* sum; // per-block sum of every element; only kept while the aggregate cache is on, NULL otherwise
+    uint64_t generation; // shared_generation() when the blocks were last checked
+};
+
+// allocate an (all invalid) zone map for the array's current shape
+struct zone_map* zone_map_alloc(array* arr);
+
+// rescan every invalid block so the whole zone map can be trusted; returns the number of elements rescanned
+size_t zone_map_refresh(array* arr);
+
+// mark the block containing the element at flat offset as stale
+void zone_map_invalidate(array* arr, size_t offset);
+
+// mark every block as stale
+void zone_map_invalidate_all(array* arr);
+
+// resize the zone map after rows were added or removed; blocks holding new rows are marked stale
+void zone_map_resize(array* arr);
+
+void zone_map_free(array* arr);
+
+
+// number of elements in one compressed block
+#define PACK_BLOCK_SIZE 1024
+
+// one compressed block; see packed.c for the encodings
+struct packed_block
+{
+    uint8_t encoding;
+    uint8_t bit_width;
+    uint16_t dict_size;
+    int32_t base;        // PACK_FOR: block minimum. PACK_DELTA: first value
+    uint32_t delta_base; // PACK_DELTA: minimum difference (mod 2^32)
+    size_t offset;       // byte offset of the block in packed_data.bytes
+};
+
+struct packed_data
+{
+    size_t total_size;
+    size_t num_blocks;
+    struct packed_block* blocks;
+    uint8_t* bytes;
+    size_t num_bytes;
+    uint64_t id; // unique per compression, names the data in packed_at's per-thread cache
+};
+
+// pointer to the decoded element at flat offset; valid until the next packed_at from the same thread
+int32_t* packed_at(array* arr, size_t offset);
+
+// decode count elements starting at flat offset start into out
+void packed_decode(array* arr, size_t start, size_t count, int32_t* out);
+
+void packed_free(array* arr);
+
+// copy count elements starting at flat offset start into out, decoding them if the array is compressed
+void read_elements(array* arr, size_t start, size_t count, void* out);
+
+// add elements [start, end) to sum in double, in order, a block at a time so compressed arrays decode into L1.
+// arr_sum adds up one zone map block of rows per call and then the block sums
+double sum_range(array* arr, size_t start, size_t end, double sum);
+
+// pointer to count contiguous elements starting at flat offset start. Plain arrays return a pointer
+// into data; compressed arrays decode into scratch (count * type_size bytes) and return it.
+void* element_view(array* arr, size_t start, size_t count, void* scratch);
+
+// where a buffer's memory comes from, which decides how it is released
+typedef enum { BUFFER_HEAP, BUFFER_MAPPED, BUFFER_SHARED } buffer_kind;
+
+// reference-counted storage shared by arrays; see buffer.c
+struct arr_buffer
+{
+    void* data;
+    size_t bytes;
+    size_t refcount; // updated atomically
+    buffer_kind kind;
+    alloc_policy policy;
+    bool read_only; // writes go to a private copy (buffer_make_unique) instead
+    void* mapping; // BUFFER_MAPPED/BUFFER_SHARED: the whole mapping, unmapped with the last reference
+    size_t mapping_bytes;
+};
+
+// new buffer with a single reference, or NULL if out of memory
+struct arr_buffer* buffer_alloc(size_t bytes);
+struct arr_buffer* buffer_alloc_zeroed(size_t bytes);
+
+// new buffer over bytes of data inside a mapping made with mmap; the mapping is unmapped with the last reference
+struct arr_buffer* buffer_wrap_mapping(void* mapping, size_t mapping_bytes, void* data, size_t bytes, buffer_kind kind, bool read_only);
+
+void buffer_retain(struct arr_buffer* buf);
+
+// drop a reference; the buffer is freed with the last one
+void buffer_release(struct arr_buffer* buf);
+
+// give arr storage of the given size, keeping its elements. Reallocates in place when arr is the
+// only user of its buffer, otherwise copies into a new buffer of its own.
+bool buffer_resize(array* arr, size_t bytes);
+
+// copy-on-write: called before every write so arr stops sharing its buffer with anyone else
+void buffer_make_unique(array* arr);
+
+// write counter of the shared segment behind buf (bumped by exclusive arr_shared_unlock), 0 for other buffers.
+// Zone maps compare it to notice writes made by other processes.
+uint64_t shared_generation(struct arr_buffer* buf);
+
+// queue run(arg) on the library's worker threads (pool.c), starting them if needed; false if that failed
+bool pool_submit(void (*run)(void*), void* arg);
+
+// run body(ctx, start, end) over [0, n) split into one contiguous slice per worker thread (the calling thread takes
+// the last one) and return once every slice is done. Runs inline when called from a worker.
+void pool_parallel_for(size_t n, void (*body)(void*, size_t, size_t), void* ctx);
+
+// storage for a buffer of the given size following the allocation policy (alloc.c): pages mapped with mmap,
+// already touched in parallel, or NULL when the policy says plain heap memory (or mapping failed). Mapped memory is
+// zeroed. *policy is set to the policy actually used and *mapping_bytes to the length to munmap.
+void* alloc_mapped(size_t bytes, alloc_policy* policy, size_t* mapping_bytes);
+
+// .zmp header helpers shared by io.c and chunked.c; the elements follow the header directly.
+// zmp_read_header allocates *shape, which the caller frees. It fails when the header is malformed or the file is
+// too short to hold the data it describes.
+bool zmp_write_header(FILE* file, type dtype, size_t* shape, size_t shape_size, uint64_t flags);
+bool zmp_read_header(FILE* file, type* dtype, size_t** shape, size_t* shape_size, uint64_t* flags);
+// rewrite the shape of a header written earlier (e.g once the number of rows is known), keeping the file position
+bool zmp_patch_shape(FILE* file, size_t* shape, size_t shape_size);
+
+// instrumentation hooks; see stats.c. Without ZUMPY_STATS they compile to nothing.
+#ifdef ZUMPY_STATS
+uint64_t stats_now(void);
+void stats_record(stat_op op, uint64_t bytes, uint64_t nanoseconds);
+void stats_alloc(uint64_t bytes);
+void stats_free(uint64_t bytes);
+void stats_policy(alloc_policy policy, uint64_t bytes);
+
+// time a function body: STATS_BEGIN() at the top, STATS_END(op, bytes) before every return
+#define STATS_BEGIN() uint64_t stats_start_ = stats_now()
+#define STATS_END(op, bytes) stats_record((op), (bytes), stats_now() - stats_start_)
+// time a single statement
+#define STATS_TIME(op, bytes, stmt) do { uint64_t stats_t_ = stats_now(); stmt; stats_record((op), (bytes), stats_now() - stats_t_); } while (0)
+// count a call without timing it, for per-element functions where reading the clock would dominate
+#define STATS_COUNT(op, bytes) stats_record((op), (bytes), 0)
+#define STATS_ALLOC(bytes) stats_alloc(bytes)
+#define STATS_FREE(bytes) stats_free(bytes)
+#define STATS_POLICY(policy, bytes) stats_policy((policy), (bytes))
+#else
+#define STATS_BEGIN() ((void)0)
+#define STATS_END(op, bytes) ((void)0)
+#define STATS_TIME(op, bytes, stmt) do { stmt; } while (0)
+#define STATS_COUNT(op, bytes) ((void)0)
+#define STATS_ALLOC(bytes) ((void)0)
+#define STATS_FREE(bytes) ((void)0)
+#define STATS_POLICY(policy, bytes) ((void)0)
+#endif
 
 #endif //ZUMPY_ZUMPY_INTERNAL_H
@@ -0,0 +1,220 @@
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+
+// Zumpy (.zmp) file layout, all values in native byte order:
+//
+//   char[8]    magic "ZUMPYARR"
+//   uint32_t   version
+//   uint32_t   dtype
+//   uint64_t   shape_size
+//   uint64_t   shape[shape_size]
+//   uint64_t   flags (ZMP_FLAG_ZONE_MAP if a zone map section follows the data, ZMP_FLAG_NAN_COUNTS if it has NaN counts)
+//   ...        total_size * type_size bytes of data
+//   [zone map] uint64_t block_rows, num_blocks, num_columns; double min[], max[]; [uint64_t nan_count[]]
+//
+// the zone map lives after the data so the data always starts at a fixed offset from the header.
+
+#define ZMP_MAGIC "ZUMPYARR"
+#define ZMP_VERSION 1
+#define ZMP_FLAG_ZONE_MAP 1
+#define ZMP_FLAG_NAN_COUNTS 2
+// offset of shape[0] in the file
+#define ZMP_SHAPE_OFFSET 24
+
+bool zmp_write_header(FILE* file, type dtype, size_t* shape, size_t shape_size, uint64_t flags)
+{
+    uint32_t version = ZMP_VERSION;
+    uint32_t dtype32 = dtype;
+    uint64_t shape_size64 = shape_size;
+
+    bool ok = fwrite(ZMP_MAGIC, 1, 8, file) == 8
+        && fwrite(&version, sizeof(version), 1, file) == 1
+        && fwrite(&dtype32, sizeof(dtype32), 1, file) == 1
+        && fwrite(&shape_size64, sizeof(shape_size64), 1, file) == 1;
+
+    for (size_t i = 0; ok && i < shape_size; ++i)
+    {
+        uint64_t dim = shape[i];
+        ok = fwrite(&dim, sizeof(dim), 1, file) == 1;
+    }
+
+    return ok && fwrite(&flags, sizeof(flags), 1, file) == 1;
+}
+
+bool zmp_patch_shape(FILE* file, size_t* shape, size_t shape_size)
+{
+    long end = ftell(file);
+    bool ok = end >= 0 && fseek(file, ZMP_SHAPE_OFFSET, SEEK_SET) == 0;
+    for (size_t i = 0; ok && i < shape_size; ++i)
+    {
+        uint64_t dim = shape[i];
+        ok = fwrite(&dim, sizeof(dim), 1, file) == 1;
+    }
+    return ok && fseek(file, end, SEEK_SET) == 0;
+}
+
+// internal function to get the number of bytes between the current position and the end of the file, or -1
+static long remaining_bytes(FILE* file)
+{
+    long position = ftell(file);
+    if (position < 0 || fseek(file, 0, SEEK_END) != 0)
+        return -1;
+    long end = ftell(file);
+    if (fseek(file, position, SEEK_SET) != 0 || end < position)
+        return -1;
+    return end - position;
+}
+
+bool zmp_read_header(FILE* file, type* dtype, size_t** shape, size_t* shape_size, uint64_t* flags)
+{
+    char magic[8];
+    uint32_t version, dtype32;
+    uint64_t shape_size64;
+    bool ok = fread(magic, 1, 8, file) == 8 && memcmp(magic, ZMP_MAGIC, 8) == 0
+        && fread(&version, sizeof(version), 1, file) == 1 && version == ZMP_VERSION
+        && fread(&dtype32, sizeof(dtype32), 1, file) == 1 && (dtype32 == INT32 || dtype32 == FLOAT)
+        && fread(&shape_size64, sizeof(shape_size64), 1, file) == 1 && shape_size64 > 0;
+
+    // a corrupt header must not lead to huge allocations: the shape and the data it describes have to be in the file
+    long remaining = ok ? remaining_bytes(file) : -1;
+    if (remaining < 0 || shape_size64 > (uint64_t)remaining / sizeof(uint64_t))
+        return false;
+
+    *shape = malloc(sizeof(size_t) * shape_size64);
+    if (*shape == NULL)
+        return false;
+    uint64_t data_bytes = get_type_size(dtype32);
+    for (size_t i = 0; ok && i < shape_size64; ++i)
+    {
+        uint64_t dim;
+        ok = fread(&dim, sizeof(dim), 1, file) == 1 && dim <= SIZE_MAX;
+        (*shape)[i] = dim;
+        if (ok && dim != 0 && data_bytes > SIZE_MAX / dim)
+            ok = false;
+        data_bytes *= dim;
+    }
+    ok = ok && fread(flags, sizeof(uint64_t), 1, file) == 1;
+    ok = ok && data_bytes <= (uint64_t)remaining - (shape_size64 + 1) * sizeof(uint64_t);
+    if (!ok)
+    {
+        free(*shape);
+        *shape = NULL;
+        return false;
+    }
+
+    *dtype = dtype32;
+    *shape_size = shape_size64;
+    return true;
+}
+
+bool arr_save(array* arr, const char* path)
+{
+    if (!arr->data && !arr->packed)
+        return false;
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+
+    if (arr->zone_map != NULL)
+        zone_map_refresh(arr);
+
+    uint64_t flags = arr->zone_map != NULL ? ZMP_FLAG_ZONE_MAP | ZMP_FLAG_NAN_COUNTS : 0;
+    bool ok = zmp_write_header(file, arr->dtype, arr->arr_shape, arr->shape_size, flags);
+
+    if (arr->packed)
+    {
+        // the file always holds plain data; decode a block at a time
+        int32_t block[PACK_BLOCK_SIZE];
+        for (size_t start = 0; ok && start < arr->total_size; start += PACK_BLOCK_SIZE)
+        {
+            size_t count = arr->total_size - start < PACK_BLOCK_SIZE ? arr->total_size - start : PACK_BLOCK_SIZE;
+            packed_decode(arr, start, count, block);
+            ok = fwrite(block, arr->type_size, count, file) == count;
+        }
+    }
+    else
+        ok = ok && fwrite(arr->data, arr->type_size, arr->total_size, file) == arr->total_size;
+
+    if (ok && arr->zone_map != NULL)
+    {
+        struct zone_map* zmap = arr->zone_map;
+        uint64_t dims[3] = { zmap->block_rows, zmap->num_blocks, zmap->num_columns };
+        size_t entries = zmap->num_blocks * zmap->num_columns;
+        ok = fwrite(dims, sizeof(uint64_t), 3, file) == 3
+            && fwrite(zmap->min, sizeof(double), entries, file) == entries
+            && fwrite(zmap->max, sizeof(double), entries, file) == entries
+            && fwrite(zmap->nan_count, sizeof(uint64_t), entries, file) == entries;
+    }
+
+    if (fclose(file) != 0)
+        ok = false;
+
+    return ok;
+}
+
+// internal function to read the NaN counts of a stored zone map. Files written before they were stored have none,
+// which is only safe to assume for int32 arrays; float arrays then rescan their blocks.
+static bool read_nan_counts(FILE* file, type dtype, uint64_t flags, uint64_t* nan_count, size_t entries)
+{
+    if (flags & ZMP_FLAG_NAN_COUNTS)
+        return fread(nan_count, sizeof(uint64_t), entries, file) == entries;
+    if (dtype != INT32)
+        return false;
+    for (size_t i = 0; i < entries; ++i)
+        nan_count[i] = 0;
+    return true;
+}
+
+bool arr_load(array* arr, const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    type dtype;
+    size_t* shape;
+    size_t shape_size;
+    uint64_t flags;
+    if (!zmp_read_header(file, &dtype, &shape, &shape_size, &flags))
+    {
+        fclose(file);
+        return false;
+    }
+
+    arr_init(arr, shape, shape_size, dtype);
+    free(shape);
+    if (arr->data == NULL)
+    {
+        free(arr->arr_shape);
+        arr->arr_shape = NULL;
+        fclose(file);
+        return false;
+    }
+    bool ok = fread(arr->data, arr->type_size, arr->total_size, file) == arr->total_size;
+
+    if (ok && (flags & ZMP_FLAG_ZONE_MAP))
+    {
+        uint64_t dims[3];
+        struct zone_map* zmap = zone_map_alloc(arr);
+        size_t entries = zmap->num_blocks * zmap->num_columns;
+        // only trust the stored zone map if it was built with the same layout
+        if (fread(dims, sizeof(uint64_t), 3, file) == 3 && dims[0] == zmap->block_rows
+            && dims[1] == zmap->num_blocks && dims[2] == zmap->num_columns
+            && fread(zmap->min, sizeof(double), entries, file) == entries
+            && fread(zmap->max, sizeof(double), entries, file) == entries
+            && read_nan_counts(file, arr->dtype, flags, zmap->nan_count, entries))
+        {
+            for (size_t i = 0; i < zmap->num_blocks; ++i)
+                zmap->valid[i] = true;
+        }
+        arr->zone_map = zmap;
+    }
+
+    fclose(file);
+
+    if (!ok)
+        arr_free(arr);
+
+    return ok;
+}
@@ -1,20 +1,111 @@
 #include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <math.h>
+
+// internal function to add up the cached per-block sums after rescanning the dirty blocks (*scanned elements)
+static double cached_sum(array* arr, size_t* scanned)
+{
+    *scanned = zone_map_refresh(arr);
+    double sum = 0.0;
+    for (size_t b = 0; b < arr->zone_map->num_blocks; ++b)
+        sum += arr->zone_map->sum[b];
+    return sum;
+}
+
+double sum_range(array* arr, size_t start, size_t end, double sum)
+{
+    int32_t decoded[PACK_BLOCK_SIZE];
+    for (; start < end; start += PACK_BLOCK_SIZE)
+    {
+        size_t count = end - start < PACK_BLOCK_SIZE ? end - start : PACK_BLOCK_SIZE;
+        void* view = element_view(arr, start, count, decoded);
+        switch (arr->dtype)
+        {
+            case INT32:
+                for (size_t i = 0; i < count; ++i)
+                    sum += ((int32_t*)view)[i];
+                break;
+            case FLOAT:
+                for (size_t i = 0; i < count; ++i)
+                    sum += ((float*)view)[i];
+                break;
+        }
+    }
+    return sum;
+}
+
+// the uncached sums add up one zone map block at a time and then the block sums, the same order the aggregate cache
+// uses, so turning the cache on only changes the cost and never the result
+static size_t sum_block_elements(array* arr)
+{
+    return ZONE_MAP_BLOCK_ROWS * row_length(arr);
+}
 
 float arr_sum(array* arr)
 {
-    float sum = 0.0;
-    switch (arr->dtype)
+    STATS_BEGIN();
+    if (arr_aggregate_cached(arr))
+    {
+        size_t scanned;
+        float sum = (float)cached_sum(arr, &scanned);
+        STATS_END(STAT_ARR_SUM, scanned * arr->type_size);
+        return sum;
+    }
+
+    double sum = 0.0;
+    size_t step = sum_block_elements(arr);
+    for (size_t start = 0; start < arr->total_size; start += step)
+        sum += sum_range(arr, start, arr->total_size - start < step ? arr->total_size : start + step, 0.0);
+    STATS_END(STAT_ARR_SUM, arr->total_size * arr->type_size);
+    return (float)sum;
+}
+
+void arr_aggregates_get(array* arr, arr_aggregates* out)
+{
+    out->sum = 0.0;
+    out->min = INFINITY;
+    out->max = -INFINITY;
+    out->count = (arr->data || arr->packed) ? arr->total_size : 0;
+    if (out->count == 0)
+        return;
+
+    STATS_BEGIN();
+    if (arr_aggregate_cached(arr))
+    {
+        size_t scanned;
+        out->sum = cached_sum(arr, &scanned);
+        struct zone_map* zmap = arr->zone_map;
+        for (size_t i = 0; i < zmap->num_blocks * zmap->num_columns; ++i)
+        {
+            if (zmap->min[i] < out->min) out->min = zmap->min[i];
+            if (zmap->max[i] > out->max) out->max = zmap->max[i];
+        }
+        STATS_END(STAT_ARR_AGGREGATES, scanned * arr->type_size);
+        return;
+    }
+
+    // no cache: one pass over the elements, a block at a time so compressed arrays decode into L1
+    double block[PACK_BLOCK_SIZE];
+    int32_t decoded[PACK_BLOCK_SIZE];
+    size_t step = sum_block_elements(arr);
+    for (size_t first = 0; first < arr->total_size; first += step)
     {
-        case INT32:
-            for (size_t i = 0; i < arr->total_size; ++i)
-                sum += *(int32_t*)((char*)(arr->data + arr->type_size*i));
-            return sum;
-            break;
-        case FLOAT:
-            for (size_t i = 0; i < arr->total_size; ++i)
-                sum += *(float*)((char*)(arr->data + arr->type_size*i));
-            return sum;
-            break;
+        size_t end = arr->total_size - first < step ? arr->total_size : first + step;
+        double block_sum = 0.0;
+        for (size_t start = first; start < end; start += PACK_BLOCK_SIZE)
+        {
+            size_t count = end - start < PACK_BLOCK_SIZE ? end - start : PACK_BLOCK_SIZE;
+            void* view = element_view(arr, start, count, decoded);
+            for (size_t i = 0; i < count; ++i)
+                block[i] = arr->dtype == INT32 ? ((int32_t*)view)[i] : ((float*)view)[i];
+            for (size_t i = 0; i < count; ++i)
+            {
+                block_sum += block[i];
+                if (block[i] < out->min) out->min = block[i];
+                if (block[i] > out->max) out->max = block[i];
+            }
+        }
+        out->sum += block_sum;
     }
-    return sum; // 0.0
-}
\ No newline at end of file
+    STATS_END(STAT_ARR_AGGREGATES, arr->total_size * arr->type_size);
+}
@@ -0,0 +1,360 @@
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+
+// Compressed (packed) storage for INT32 arrays.
+//
+// The elements are split into blocks of PACK_BLOCK_SIZE and every block picks whichever of these encodings is
+// smallest for its values:
+//
+//   PACK_FOR   frame of reference: the block minimum plus (value - minimum) bit-packed at the narrowest width
+//   PACK_DELTA the first value plus successive differences, themselves frame-of-reference bit-packed
+//   PACK_DICT  a sorted dictionary of the distinct values plus bit-packed codes into it
+//
+// Bits are packed LSB-first into a byte stream. Every value is read with one fixed-width 5 byte load and a
+// shift/mask, whatever its bit offset. The stream is padded so those loads never read past the end. Unpacking is a
+// scalar loop; only the passes decode_block runs over the unpacked values (adding the frame of reference, looking up
+// dictionary codes) are simple enough for the compiler to vectorize, and the delta prefix sum is scalar too.
+
+#define PACK_FOR 0
+#define PACK_DELTA 1
+#define PACK_DICT 2
+
+// bytes of padding after the packed stream so unpack can always load 5 bytes
+#define PACK_PADDING 8
+
+// number of bits needed to store values in [0, range]
+static unsigned bit_width(uint64_t range)
+{
+    unsigned width = 0;
+    while (range > 0)
+    {
+        width++;
+        range >>= 1;
+    }
+    return width;
+}
+
+static void pack_bits(uint8_t* out, const uint32_t* values, size_t count, unsigned width)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t bit = i * width;
+        uint64_t v = (uint64_t)values[i] << (bit & 7);
+        uint8_t* p = out + (bit >> 3);
+        for (size_t b = 0; b < 5; ++b)
+            p[b] |= (uint8_t)(v >> (8 * b));
+    }
+}
+
+static void unpack_bits(const uint8_t* in, size_t count, unsigned width, uint32_t* out)
+{
+    if (width == 0)
+    {
+        memset(out, 0, sizeof(uint32_t) * count);
+        return;
+    }
+
+    uint64_t mask = width == 32 ? 0xFFFFFFFFu : (((uint64_t)1 << width) - 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t bit = i * width;
+        const uint8_t* p = in + (bit >> 3);
+        uint64_t v = (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16
+            | (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32;
+        out[i] = (uint32_t)((v >> (bit & 7)) & mask);
+    }
+}
+
+static size_t packed_bytes(size_t count, unsigned width)
+{
+    return (count * width + 7) / 8;
+}
+
+static int cmp_int32(const void* a, const void* b)
+{
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// internal function to pick the smallest encoding for a block. Fills in everything but the offset
+// and returns the number of bytes the block needs. dict is scratch space for the sorted distinct values.
+static size_t choose_encoding(const int32_t* values, size_t count, struct packed_block* blk, int32_t* dict)
+{
+    int32_t min = values[0], max = values[0];
+    int64_t min_delta = 0, max_delta = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (values[i] < min) min = values[i];
+        if (values[i] > max) max = values[i];
+        if (i > 0)
+        {
+            int64_t d = (int64_t)values[i] - values[i - 1];
+            if (i == 1 || d < min_delta) min_delta = d;
+            if (i == 1 || d > max_delta) max_delta = d;
+        }
+    }
+
+    // frame of reference always works since max - min fits in 32 bits
+    blk->encoding = PACK_FOR;
+    blk->bit_width = bit_width((uint64_t)((int64_t)max - min));
+    blk->base = min;
+    blk->delta_base = 0;
+    blk->dict_size = 0;
+    size_t best = packed_bytes(count, blk->bit_width);
+
+    if (count > 1 && (uint64_t)(max_delta - min_delta) <= 0xFFFFFFFFu)
+    {
+        unsigned width = bit_width((uint64_t)(max_delta - min_delta));
+        size_t size = packed_bytes(count - 1, width);
+        if (size < best)
+        {
+            best = size;
+            blk->encoding = PACK_DELTA;
+            blk->bit_width = width;
+            blk->base = values[0];
+            blk->delta_base = (uint32_t)min_delta;
+        }
+    }
+
+    memcpy(dict, values, sizeof(int32_t) * count);
+    qsort(dict, count, sizeof(int32_t), cmp_int32);
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; ++i)
+        if (distinct == 0 || dict[distinct - 1] != dict[i])
+            dict[distinct++] = dict[i];
+
+    unsigned width = bit_width(distinct - 1);
+    size_t size = sizeof(int32_t) * distinct + packed_bytes(count, width);
+    if (size < best)
+    {
+        best = size;
+        blk->encoding = PACK_DICT;
+        blk->bit_width = width;
+        blk->dict_size = distinct;
+    }
+
+    return best;
+}
+
+// internal function to write a block whose encoding was picked by choose_encoding.
+// out must be zeroed; codes is scratch space for count values.
+static void write_block(const int32_t* values, size_t count, struct packed_block* blk, const int32_t* dict, uint8_t* out, uint32_t* codes)
+{
+    switch (blk->encoding)
+    {
+        case PACK_FOR:
+            for (size_t i = 0; i < count; ++i)
+                codes[i] = (uint32_t)values[i] - (uint32_t)blk->base;
+            pack_bits(out, codes, count, blk->bit_width);
+            break;
+        case PACK_DELTA:
+            for (size_t i = 1; i < count; ++i)
+                codes[i - 1] = (uint32_t)values[i] - (uint32_t)values[i - 1] - blk->delta_base;
+            pack_bits(out, codes, count - 1, blk->bit_width);
+            break;
+        case PACK_DICT:
+            memcpy(out, dict, sizeof(int32_t) * blk->dict_size);
+            for (size_t i = 0; i < count; ++i)
+                codes[i] = (int32_t*)bsearch(&values[i], dict, blk->dict_size, sizeof(int32_t), cmp_int32) - dict;
+            pack_bits(out + sizeof(int32_t) * blk->dict_size, codes, count, blk->bit_width);
+            break;
+    }
+}
+
+// internal function to decode the first count elements of block b into out
+static void decode_block(struct packed_data* packed, size_t b, size_t count, int32_t* out)
+{
+    struct packed_block* blk = &packed->blocks[b];
+    const uint8_t* in = packed->bytes + blk->offset;
+    uint32_t* u = (uint32_t*)out;
+
+    switch (blk->encoding)
+    {
+        case PACK_FOR:
+            unpack_bits(in, count, blk->bit_width, u);
+            for (size_t i = 0; i < count; ++i)
+                u[i] += (uint32_t)blk->base;
+            break;
+        case PACK_DELTA:
+            u[0] = (uint32_t)blk->base;
+            unpack_bits(in, count - 1, blk->bit_width, u + 1);
+            for (size_t i = 1; i < count; ++i)
+                u[i] += u[i - 1] + blk->delta_base;
+            break;
+        case PACK_DICT:
+        {
+            int32_t dict[PACK_BLOCK_SIZE];
+            memcpy(dict, in, sizeof(int32_t) * blk->dict_size);
+            unpack_bits(in + sizeof(int32_t) * blk->dict_size, count, blk->bit_width, u);
+            for (size_t i = 0; i < count; ++i)
+                out[i] = dict[u[i]];
+            break;
+        }
+    }
+}
+
+static size_t block_count(struct packed_data* packed, size_t b)
+{
+    size_t remaining = packed->total_size - b * PACK_BLOCK_SIZE;
+    return remaining < PACK_BLOCK_SIZE ? remaining : PACK_BLOCK_SIZE;
+}
+
+// last block decoded by packed_at so sequential access doesn't decode a block per element. It is kept per thread,
+// so concurrent readers of one compressed array (e.g asynchronous filters) don't overwrite each other's block, and
+// keyed by packed_data.id rather than the pointer since freed packed data may be reallocated at the same address.
+static uint64_t next_packed_id = 1;
+static __thread int32_t cache[PACK_BLOCK_SIZE];
+static __thread uint64_t cached_id = 0;
+static __thread size_t cached_block = 0;
+
+int32_t* packed_at(array* arr, size_t offset)
+{
+    struct packed_data* packed = arr->packed;
+    size_t b = offset / PACK_BLOCK_SIZE;
+    if (cached_id != packed->id || cached_block != b)
+    {
+        decode_block(packed, b, block_count(packed, b), cache);
+        cached_id = packed->id;
+        cached_block = b;
+    }
+    return &cache[offset % PACK_BLOCK_SIZE];
+}
+
+void packed_decode(array* arr, size_t start, size_t count, int32_t* out)
+{
+    struct packed_data* packed = arr->packed;
+    int32_t block[PACK_BLOCK_SIZE];
+    size_t end = start + count;
+    while (start < end)
+    {
+        size_t b = start / PACK_BLOCK_SIZE;
+        size_t first = start % PACK_BLOCK_SIZE;
+        size_t n = block_count(packed, b);
+        size_t take = n - first < end - start ? n - first : end - start;
+
+        // decode straight into the output when a whole block is wanted
+        if (first == 0 && take == n)
+            decode_block(packed, b, n, out);
+        else
+        {
+            decode_block(packed, b, first + take, block);
+            memcpy(out, block + first, sizeof(int32_t) * take);
+        }
+        out += take;
+        start += take;
+    }
+}
+
+void read_elements(array* arr, size_t start, size_t count, void* out)
+{
+    if (count == 0)
+        return;
+
+    if (arr->packed)
+        packed_decode(arr, start, count, out);
+    else
+        memcpy(out, (char*)arr->data + start * arr->type_size, count * arr->type_size);
+}
+
+void* element_view(array* arr, size_t start, size_t count, void* scratch)
+{
+    if (arr->packed)
+    {
+        packed_decode(arr, start, count, scratch);
+        return scratch;
+    }
+    return (char*)arr->data + start * arr->type_size;
+}
+
+void arr_compress(array* arr)
+{
+    if (!arr->data || arr->dtype != INT32 || arr->total_size == 0)
+        return;
+
+    STATS_BEGIN();
+    struct packed_data* packed = malloc(sizeof(struct packed_data));
+    packed->total_size = arr->total_size;
+    packed->num_blocks = (arr->total_size + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE;
+    packed->blocks = malloc(sizeof(struct packed_block) * packed->num_blocks);
+    packed->id = __atomic_fetch_add(&next_packed_id, 1, __ATOMIC_RELAXED);
+
+    int32_t* values = arr->data;
+    int32_t* dict = malloc(sizeof(int32_t) * PACK_BLOCK_SIZE);
+    uint32_t* codes = malloc(sizeof(uint32_t) * PACK_BLOCK_SIZE);
+
+    // first pass sizes every block, second pass writes them
+    size_t offset = 0;
+    for (size_t b = 0; b < packed->num_blocks; ++b)
+    {
+        packed->blocks[b].offset = offset;
+        offset += choose_encoding(values + b * PACK_BLOCK_SIZE, block_count(packed, b), &packed->blocks[b], dict);
+    }
+
+    // incompressible data (e.g random values) stays as it is
+    if (offset + PACK_PADDING + sizeof(struct packed_block) * packed->num_blocks >= arr->type_size * arr->total_size)
+    {
+        free(dict);
+        free(codes);
+        free(packed->blocks);
+        free(packed);
+        STATS_END(STAT_ARR_COMPRESS, arr->type_size * arr->total_size);
+        return;
+    }
+
+    packed->num_bytes = offset + PACK_PADDING;
+    packed->bytes = calloc(packed->num_bytes, 1);
+    STATS_ALLOC(packed->num_bytes);
+    for (size_t b = 0; b < packed->num_blocks; ++b)
+    {
+        const int32_t* block_values = values + b * PACK_BLOCK_SIZE;
+        size_t n = block_count(packed, b);
+        // the dict scratch only holds the last block sized above, so rebuild it for dictionary blocks
+        if (packed->blocks[b].encoding == PACK_DICT)
+            choose_encoding(block_values, n, &packed->blocks[b], dict);
+        write_block(block_values, n, &packed->blocks[b], dict, packed->bytes + packed->blocks[b].offset, codes);
+    }
+
+    free(dict);
+    free(codes);
+    buffer_release(arr->buffer);
+    arr->buffer = NULL;
+    arr->data = NULL;
+    arr->packed = packed;
+    arr->capacity = arr->arr_shape[0]; // spare rows aren't kept; arr_decompress allocates exactly the rows in use
+    STATS_END(STAT_ARR_COMPRESS, arr->type_size * arr->total_size);
+}
+
+void arr_decompress(array* arr)
+{
+    if (!arr->packed)
+        return;
+
+    struct arr_buffer* buf = buffer_alloc(arr->type_size * arr->total_size);
+    if (buf == NULL)
+        return; // out of memory: stay compressed
+    packed_decode(arr, 0, arr->total_size, buf->data);
+    packed_free(arr);
+    arr->buffer = buf;
+    arr->data = buf->data;
+}
+
+size_t arr_storage_bytes(array* arr)
+{
+    if (arr->packed)
+        return arr->packed->num_bytes + sizeof(struct packed_block) * arr->packed->num_blocks;
+    if (arr->data)
+        return arr->type_size * arr->total_size;
+    return 0;
+}
+
+void packed_free(array* arr)
+{
+    if (!arr->packed)
+        return;
+
+    STATS_FREE(arr->packed->num_bytes);
+    free(arr->packed->blocks);
+    free(arr->packed->bytes);
+    free(arr->packed);
+    arr->packed = NULL;
+}
@@ -0,0 +1,208 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <pthread.h>
+#include <unistd.h>
+
+// The library's worker threads.
+//
+// A fixed set of threads takes tasks off a FIFO queue. The pool starts on first use with one thread per online CPU
+// unless arr_pool_init() picked a size before that. The workers live until the process exits.
+
+struct pool_task
+{
+    void (*run)(void*);
+    void* arg;
+    struct pool_task* next;
+};
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static struct pool_task* queue_head = NULL;
+static struct pool_task* queue_tail = NULL;
+static size_t num_workers = 0;
+static __thread bool is_worker = false;
+
+static void* worker_main(void* arg)
+{
+    (void)arg;
+    is_worker = true;
+    pthread_mutex_lock(&pool_lock);
+    while (true)
+    {
+        while (queue_head == NULL)
+            pthread_cond_wait(&pool_cond, &pool_lock);
+
+        struct pool_task* task = queue_head;
+        queue_head = task->next;
+        if (queue_head == NULL)
+            queue_tail = NULL;
+        pthread_mutex_unlock(&pool_lock);
+
+        task->run(task->arg);
+        free(task);
+
+        pthread_mutex_lock(&pool_lock);
+    }
+    return NULL;
+}
+
+// internal function to start the workers; called with pool_lock held
+static void start_workers(size_t threads)
+{
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker_main, NULL) != 0)
+            break;
+        pthread_detach(thread);
+        num_workers++;
+    }
+}
+
+bool arr_pool_init(size_t threads)
+{
+    pthread_mutex_lock(&pool_lock);
+    bool started = num_workers == 0;
+    if (started)
+        start_workers(threads);
+    pthread_mutex_unlock(&pool_lock);
+    return started;
+}
+
+size_t arr_pool_size(void)
+{
+    pthread_mutex_lock(&pool_lock);
+    size_t n = num_workers;
+    pthread_mutex_unlock(&pool_lock);
+    return n;
+}
+
+bool pool_submit(void (*run)(void*), void* arg)
+{
+    struct pool_task* task = malloc(sizeof(struct pool_task));
+    if (task == NULL)
+        return false;
+    task->run = run;
+    task->arg = arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    if (num_workers == 0)
+        start_workers(0);
+    if (num_workers == 0)
+    {
+        pthread_mutex_unlock(&pool_lock);
+        free(task);
+        return false;
+    }
+
+    if (queue_tail)
+        queue_tail->next = task;
+    else
+        queue_head = task;
+    queue_tail = task;
+    pthread_cond_signal(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+    return true;
+}
+
+// one slice of a pool_parallel_for; the last one runs on the calling thread
+struct parallel_part
+{
+    struct parallel_job* job;
+    size_t start;
+    size_t end;
+};
+
+struct parallel_job
+{
+    void (*body)(void*, size_t, size_t);
+    void* ctx;
+    size_t remaining;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static void run_part(void* arg)
+{
+    struct parallel_part* part = arg;
+    struct parallel_job* job = part->job;
+    job->body(job->ctx, part->start, part->end);
+
+    pthread_mutex_lock(&job->lock);
+    if (--job->remaining == 0)
+        pthread_cond_signal(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
+void pool_parallel_for(size_t n, void (*body)(void*, size_t, size_t), void* ctx)
+{
+    pthread_mutex_lock(&pool_lock);
+    if (num_workers == 0)
+        start_workers(0);
+    size_t parts = num_workers;
+    pthread_mutex_unlock(&pool_lock);
+
+    if (parts > n)
+        parts = n;
+    // a worker waiting on other workers could deadlock the pool, so nested calls run inline
+    if (parts <= 1 || is_worker)
+    {
+        body(ctx, 0, n);
+        return;
+    }
+
+    struct parallel_part* part = malloc(sizeof(struct parallel_part) * parts);
+    if (part == NULL)
+    {
+        body(ctx, 0, n);
+        return;
+    }
+    struct parallel_job job = {
+        .body = body,
+        .ctx = ctx,
+        .remaining = 0,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+    };
+
+    // contiguous, equal slices: part i covers [n * i / parts, n * (i + 1) / parts)
+    for (size_t i = 0; i < parts; ++i)
+    {
+        part[i].job = &job;
+        part[i].start = n * i / parts;
+        part[i].end = n * (i + 1) / parts;
+    }
+
+    for (size_t i = 0; i + 1 < parts; ++i)
+    {
+        pthread_mutex_lock(&job.lock);
+        job.remaining++;
+        pthread_mutex_unlock(&job.lock);
+        if (!pool_submit(run_part, &part[i]))
+        {
+            pthread_mutex_lock(&job.lock);
+            job.remaining--;
+            pthread_mutex_unlock(&job.lock);
+            body(ctx, part[i].start, part[i].end);
+        }
+    }
+    body(ctx, part[parts - 1].start, part[parts - 1].end);
+
+    pthread_mutex_lock(&job.lock);
+    while (job.remaining > 0)
+        pthread_cond_wait(&job.cond, &job.lock);
+    pthread_mutex_unlock(&job.lock);
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.cond);
+    free(part);
+}
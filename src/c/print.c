@@ -3,8 +3,9 @@
 
 // internal function to print the contents of an arbitrary-dimensional array.
 // the implementation is extremely similar to get_index_combinations but still a bit different
-void print(array* arr, size_t* sub_arr_dims, size_t sub_arr_dims_len)
+void print(array* arr, size_t* sub_arr_dims, size_t sub_arr_dims_len, FILE* stream)
 {
+    STATS_BEGIN();
     size_t* bounds = malloc(sizeof(size_t) * sub_arr_dims_len);
     size_t* current_idx = malloc(sizeof(size_t) * sub_arr_dims_len);
     size_t total_combinations = 1;
@@ -20,10 +21,10 @@ void print(array* arr, size_t* sub_arr_dims, size_t sub_arr_dims_len)
         switch (arr->dtype)
         {
             case INT32:
-                printf("%d ", *(int32_t*)arr_at(arr, current_idx));
+                fprintf(stream, "%d ", *(int32_t*)arr_at(arr, current_idx));
                 break;
             case FLOAT:
-                printf("%f ", *(float*)arr_at(arr, current_idx));
+                fprintf(stream, "%f ", *(float*)arr_at(arr, current_idx));
                 break;
         }
 
@@ -36,7 +37,7 @@ void print(array* arr, size_t* sub_arr_dims, size_t sub_arr_dims_len)
                 if (i == 0)
                     break;
                 current_idx[i-1]++;
-                printf("\n");
+                fputc('\n', stream);
             }
         }
 
@@ -46,10 +47,16 @@ void print(array* arr, size_t* sub_arr_dims, size_t sub_arr_dims_len)
 
     free(bounds);
     free(current_idx);
+    STATS_END(STAT_ARR_PRINT, total_combinations * arr->type_size);
 }
 
 // a wrapper on print() to expose to the C API
 void arr_print(array* arr)
 {
-    print(arr, arr->arr_shape, arr->shape_size);
+    print(arr, arr->arr_shape, arr->shape_size, stdout);
+}
+
+void arr_fprint(array* arr, FILE* stream)
+{
+    print(arr, arr->arr_shape, arr->shape_size, stream);
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <math.h>
+
+// Random fills on top of xoshiro256++ (Blackman & Vigna).
+//
+// The generator state is 32 bytes and lives with the caller, so every thread can own an independent stream:
+// seed one generator and give each thread a copy advanced by arr_rng_jump() a different number of times. Each
+// jump skips 2^128 outputs, so streams never overlap in practice.
+//
+// The fills draw raw 64-bit outputs a block at a time with the state held in locals, then convert the block in a
+// separate loop the compiler can vectorize.
+
+#define RNG_BLOCK 256
+#define TWO_PI 6.283185307179586
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64, used to expand a 64-bit seed into a full state as recommended by the xoshiro authors
+static uint64_t splitmix64(uint64_t* x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15u);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+void arr_rng_seed(arr_rng* rng, uint64_t seed)
+{
+    for (size_t i = 0; i < 4; ++i)
+        rng->s[i] = splitmix64(&seed);
+}
+
+uint64_t arr_rng_next(arr_rng* rng)
+{
+    uint64_t* s = rng->s;
+    uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+void arr_rng_jump(arr_rng* rng)
+{
+    static const uint64_t jump[] = { 0x180ec6d33cfd0abau, 0xd5a61266f0c9392cu, 0xa9582618e03fc9aau, 0x39abdc4529b1661cu };
+
+    uint64_t s[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < 4; ++i)
+        for (int b = 0; b < 64; ++b)
+        {
+            if (jump[i] & ((uint64_t)1 << b))
+                for (size_t j = 0; j < 4; ++j)
+                    s[j] ^= rng->s[j];
+            arr_rng_next(rng);
+        }
+    for (size_t j = 0; j < 4; ++j)
+        rng->s[j] = s[j];
+}
+
+void arr_rng_stream(arr_rng* rng, uint64_t seed, size_t stream)
+{
+    arr_rng_seed(rng, seed);
+    for (size_t i = 0; i < stream; ++i)
+        arr_rng_jump(rng);
+}
+
+// internal function to draw n raw outputs; the state stays in registers for the whole block
+static void next_block(arr_rng* rng, uint64_t* out, size_t n)
+{
+    uint64_t s0 = rng->s[0], s1 = rng->s[1], s2 = rng->s[2], s3 = rng->s[3];
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = rotl(s0 + s3, 23) + s0;
+        uint64_t t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = rotl(s3, 45);
+    }
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+    rng->s[2] = s2;
+    rng->s[3] = s3;
+}
+
+// uniform double in [0, 1) from the top 53 bits
+static inline double to_unit(uint64_t x)
+{
+    return (double)(x >> 11) * 0x1.0p-53;
+}
+
+// internal function to get the array ready for writing every element; false if there is nothing to write
+static bool prepare_fill(array* arr)
+{
+    arr_decompress(arr);
+    buffer_make_unique(arr);
+    return arr->data != NULL;
+}
+
+void arr_random_int(array* arr, arr_rng* rng, int32_t low, int32_t high)
+{
+    if (low > high || !prepare_fill(arr))
+        return;
+
+    STATS_BEGIN();
+    // unbiased bounded integers (Lemire's multiply-shift with rejection) on the top 32 bits of each output
+    uint64_t range = (uint64_t)((int64_t)high - low) + 1;
+    uint32_t threshold = range > UINT32_MAX ? 0 : (uint32_t)((0x100000000u - range) % range);
+
+    uint64_t raw[RNG_BLOCK];
+    for (size_t start = 0; start < arr->total_size; start += RNG_BLOCK)
+    {
+        size_t n = arr->total_size - start < RNG_BLOCK ? arr->total_size - start : RNG_BLOCK;
+        next_block(rng, raw, n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            int64_t value;
+            if (range > UINT32_MAX)
+                value = (int64_t)low + (int64_t)(raw[i] >> 32);
+            else
+            {
+                uint64_t m = (raw[i] >> 32) * range;
+                while ((uint32_t)m < threshold) // rare: only when the low bits land in the biased sliver
+                    m = (arr_rng_next(rng) >> 32) * range;
+                value = (int64_t)low + (int64_t)(m >> 32);
+            }
+
+            switch (arr->dtype)
+            {
+                case INT32:
+                    ((int32_t*)arr->data)[start + i] = (int32_t)value;
+                    break;
+                case FLOAT:
+                    ((float*)arr->data)[start + i] = (float)value;
+                    break;
+            }
+        }
+    }
+    zone_map_invalidate_all(arr);
+    STATS_END(STAT_ARR_RANDOM, arr->total_size * arr->type_size);
+}
+
+void arr_random_uniform(array* arr, arr_rng* rng, double low, double high)
+{
+    if (!prepare_fill(arr))
+        return;
+
+    STATS_BEGIN();
+    double scale = high - low;
+    uint64_t raw[RNG_BLOCK];
+    for (size_t start = 0; start < arr->total_size; start += RNG_BLOCK)
+    {
+        size_t n = arr->total_size - start < RNG_BLOCK ? arr->total_size - start : RNG_BLOCK;
+        next_block(rng, raw, n);
+        switch (arr->dtype)
+        {
+            case INT32:
+            {
+                int32_t* out = (int32_t*)arr->data + start;
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = (int32_t)floor(low + to_unit(raw[i]) * scale);
+                break;
+            }
+            case FLOAT:
+            {
+                float* out = (float*)arr->data + start;
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = (float)(low + to_unit(raw[i]) * scale);
+                break;
+            }
+        }
+    }
+    zone_map_invalidate_all(arr);
+    STATS_END(STAT_ARR_RANDOM, arr->total_size * arr->type_size);
+}
+
+void arr_random_normal(array* arr, arr_rng* rng, double mean, double stddev)
+{
+    if (!prepare_fill(arr))
+        return;
+
+    STATS_BEGIN();
+    // Box-Muller: every pair of outputs gives two independent normals
+    uint64_t raw[RNG_BLOCK];
+    double values[RNG_BLOCK];
+    for (size_t start = 0; start < arr->total_size; start += RNG_BLOCK)
+    {
+        size_t n = arr->total_size - start < RNG_BLOCK ? arr->total_size - start : RNG_BLOCK;
+        next_block(rng, raw, RNG_BLOCK);
+        for (size_t i = 0; i < RNG_BLOCK; i += 2)
+        {
+            double u1 = 1.0 - to_unit(raw[i]); // (0, 1] so the log is finite
+            double u2 = to_unit(raw[i + 1]);
+            double r = sqrt(-2.0 * log(u1)) * stddev;
+            values[i] = mean + r * cos(TWO_PI * u2);
+            values[i + 1] = mean + r * sin(TWO_PI * u2);
+        }
+
+        switch (arr->dtype)
+        {
+            case INT32:
+                for (size_t i = 0; i < n; ++i)
+                    ((int32_t*)arr->data)[start + i] = (int32_t)lround(values[i]);
+                break;
+            case FLOAT:
+                for (size_t i = 0; i < n; ++i)
+                    ((float*)arr->data)[start + i] = (float)values[i];
+                break;
+        }
+    }
+    zone_map_invalidate_all(arr);
+    STATS_END(STAT_ARR_RANDOM, arr->total_size * arr->type_size);
+}
+
+void arr_random_bernoulli(array* arr, arr_rng* rng, double p)
+{
+    if (!prepare_fill(arr))
+        return;
+
+    STATS_BEGIN();
+    // compare the top 53 bits against p scaled to the same range; p <= 0 never hits and p >= 1 always does
+    uint64_t limit = p <= 0.0 ? 0 : p >= 1.0 ? ((uint64_t)1 << 53) : (uint64_t)(p * 0x1.0p53);
+    uint64_t raw[RNG_BLOCK];
+    for (size_t start = 0; start < arr->total_size; start += RNG_BLOCK)
+    {
+        size_t n = arr->total_size - start < RNG_BLOCK ? arr->total_size - start : RNG_BLOCK;
+        next_block(rng, raw, n);
+        switch (arr->dtype)
+        {
+            case INT32:
+            {
+                int32_t* out = (int32_t*)arr->data + start;
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = (raw[i] >> 11) < limit;
+                break;
+            }
+            case FLOAT:
+            {
+                float* out = (float*)arr->data + start;
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = (raw[i] >> 11) < limit ? 1.0f : 0.0f;
+                break;
+            }
+        }
+    }
+    zone_map_invalidate_all(arr);
+    STATS_END(STAT_ARR_RANDOM, arr->total_size * arr->type_size);
+}
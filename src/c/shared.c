@@ -0,0 +1,226 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Arrays in POSIX shared memory segments (shm_open + mmap) so several processes can use one physical copy.
+//
+// A segment starts with a header holding the dtype, shape and a process-shared reader/writer lock; the elements
+// start at the next page boundary. The mapping becomes the array's buffer (kind BUFFER_SHARED), so every other
+// function works on it unchanged. Read-only attachments map the element pages without write access and mark the
+// buffer read-only, so the first write in such a process copies the array into private memory instead of faulting.
+
+// "ZMPSHM01"; written last by the creator so attaching to a half-initialised segment fails
+#define SHM_MAGIC 0x31304d48535a4d5au
+
+struct shm_header
+{
+    uint64_t magic;
+    uint32_t dtype;
+    uint32_t shape_size;
+    uint64_t data_offset;
+    uint64_t data_bytes;
+    uint64_t generation; // bumped by every exclusive unlock
+    pthread_rwlock_t lock;
+    uint64_t shape[];
+};
+
+// internal function to compute where the elements start: the first page boundary after the header and shape
+static size_t data_offset_for(size_t shape_size)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t header = sizeof(struct shm_header) + sizeof(uint64_t) * shape_size;
+    return (header + page - 1) / page * page;
+}
+
+// internal function to point arr at the elements of a mapped segment; false if out of memory
+static bool wrap_segment(array* arr, struct shm_header* header, size_t mapping_bytes, bool read_only)
+{
+    struct arr_buffer* buf = buffer_wrap_mapping(header, mapping_bytes, (char*)header + header->data_offset, header->data_bytes, BUFFER_SHARED, read_only);
+    size_t* shape = malloc(sizeof(size_t) * header->shape_size);
+    if (buf == NULL || shape == NULL)
+    {
+        // the caller still owns the mapping
+        free(buf);
+        free(shape);
+        return false;
+    }
+
+    arr->dtype = (type)header->dtype;
+    arr->type_size = get_type_size(arr->dtype);
+    arr->shape_size = header->shape_size;
+    arr->arr_shape = shape;
+    arr->total_size = 1;
+    for (size_t i = 0; i < arr->shape_size; ++i)
+    {
+        shape[i] = header->shape[i];
+        arr->total_size *= shape[i];
+    }
+    arr->capacity = shape[0];
+    arr->zone_map = NULL;
+    arr->packed = NULL;
+    arr->buffer = buf;
+    arr->data = buf->data;
+    return true;
+}
+
+bool arr_create_shared(array* arr, const char* name, size_t* arr_shape, size_t shape_size, type dtype)
+{
+    if (shape_size == 0)
+        return false;
+
+    size_t total_size = 1;
+    for (size_t i = 0; i < shape_size; ++i)
+        total_size *= arr_shape[i];
+    size_t data_offset = data_offset_for(shape_size);
+    size_t data_bytes = total_size * get_type_size(dtype);
+    size_t bytes = data_offset + data_bytes;
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, (off_t)bytes) != 0)
+    {
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    void* mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return false;
+    }
+
+    // ftruncate zero-filled the segment, so only the header needs writing
+    struct shm_header* header = mapping;
+    header->dtype = (uint32_t)dtype;
+    header->shape_size = (uint32_t)shape_size;
+    header->data_offset = data_offset;
+    header->data_bytes = data_bytes;
+    header->generation = 0;
+    for (size_t i = 0; i < shape_size; ++i)
+        header->shape[i] = arr_shape[i];
+
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_rwlock_init(&header->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+
+    __atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+    if (!wrap_segment(arr, header, bytes, false))
+    {
+        munmap(mapping, bytes);
+        shm_unlink(name);
+        return false;
+    }
+    return true;
+}
+
+// internal function to check that a mapped segment holds a complete, consistent header
+static bool valid_header(struct shm_header* header, size_t bytes)
+{
+    if (bytes < sizeof(struct shm_header) || __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC)
+        return false;
+    if (header->dtype > FLOAT || header->shape_size == 0 || header->data_offset != data_offset_for(header->shape_size))
+        return false;
+    if (header->data_offset > bytes || header->data_bytes > bytes - header->data_offset)
+        return false;
+
+    size_t total_size = 1;
+    for (size_t i = 0; i < header->shape_size; ++i)
+    {
+        if (header->shape[i] != 0 && total_size > SIZE_MAX / header->shape[i])
+            return false;
+        total_size *= header->shape[i];
+    }
+    return total_size <= SIZE_MAX / get_type_size((type)header->dtype) && total_size * get_type_size((type)header->dtype) == header->data_bytes;
+}
+
+bool arr_attach_shared(array* arr, const char* name, bool writable)
+{
+    // always opened for writing: the lock in the header is written even by readers
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+    size_t bytes = (size_t)st.st_size;
+    void* mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    struct shm_header* header = mapping;
+    bool ok = valid_header(header, bytes);
+
+    // read-only attachments protect the element pages, so a stray write through arr->data faults instead of
+    // changing every process's copy
+    if (ok && !writable && header->data_bytes > 0)
+        ok = mprotect((char*)mapping + header->data_offset, bytes - header->data_offset, PROT_READ) == 0;
+
+    if (!ok || !wrap_segment(arr, header, bytes, !writable))
+    {
+        munmap(mapping, bytes);
+        return false;
+    }
+    return true;
+}
+
+bool arr_unlink_shared(const char* name)
+{
+    return shm_unlink(name) == 0;
+}
+
+// internal function to get the segment header behind an array, or NULL if it doesn't live in one
+static struct shm_header* segment_of(array* arr)
+{
+    if (arr->buffer == NULL || arr->buffer->kind != BUFFER_SHARED || arr->data == NULL)
+        return NULL;
+    return arr->buffer->mapping;
+}
+
+bool arr_shared_lock(array* arr, bool exclusive)
+{
+    struct shm_header* header = segment_of(arr);
+    if (header == NULL)
+        return false;
+
+    return (exclusive ? pthread_rwlock_wrlock(&header->lock) : pthread_rwlock_rdlock(&header->lock)) == 0;
+}
+
+void arr_shared_unlock(array* arr, bool exclusive)
+{
+    struct shm_header* header = segment_of(arr);
+    if (header == NULL)
+        return;
+
+    // every process's zone map compares against this, so writes made under the lock are noticed
+    if (exclusive)
+        __atomic_add_fetch(&header->generation, 1, __ATOMIC_RELEASE);
+    pthread_rwlock_unlock(&header->lock);
+}
+
+bool arr_is_shared_memory(array* arr)
+{
+    return segment_of(arr) != NULL;
+}
+
+uint64_t shared_generation(struct arr_buffer* buf)
+{
+    if (buf == NULL || buf->kind != BUFFER_SHARED)
+        return 0;
+    return __atomic_load_n(&((struct shm_header*)buf->mapping)->generation, __ATOMIC_ACQUIRE);
+}
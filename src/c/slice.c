@@ -3,6 +3,7 @@
 
 void arr_slice(array* srcarray, size_t** sub_arr_idx, size_t* sub_arr_dims, size_t sub_arr_dims_len, array* subarray)
 {
+    STATS_BEGIN();
     size_t** indices = get_index_combinations(sub_arr_dims, sub_arr_dims_len, NULL);
 
     size_t total_combinations = 1;
@@ -29,5 +30,5 @@ void arr_slice(array* srcarray, size_t** sub_arr_idx, size_t* sub_arr_dims, size
     for (size_t i = 0; i < total_combinations; ++i)
         free(indices[i]);
     free(indices);
-
+    STATS_END(STAT_ARR_SLICE, 2 * subarray->total_size * subarray->type_size);
 }
\ No newline at end of file
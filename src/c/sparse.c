@@ -0,0 +1,384 @@
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+
+// internal function to read a stored value as a float, the type every sparse computation accumulates in
+static float sparse_value(sparse_array* sp, size_t i)
+{
+    switch (sp->dtype)
+    {
+        case INT32:
+            return ((int32_t*)sp->values)[i];
+        case FLOAT:
+            return ((float*)sp->values)[i];
+    }
+    return 0.0f;
+}
+
+static bool is_zero(type dtype, void* value)
+{
+    switch (dtype)
+    {
+        case INT32:
+            return *(int32_t*)value == 0;
+        case FLOAT:
+            return *(float*)value == 0.0f;
+    }
+    return false;
+}
+
+// internal function to add src onto dst, used to merge duplicate COO entries
+static void add_value(type dtype, void* dst, void* src)
+{
+    switch (dtype)
+    {
+        case INT32:
+            *(int32_t*)dst += *(int32_t*)src;
+            break;
+        case FLOAT:
+            *(float*)dst += *(float*)src;
+            break;
+    }
+}
+
+// internal function to allocate CSR storage for nnz entries; row_indices gets rows + 1 row pointers
+static void alloc_csr(sparse_array* sp, size_t rows, size_t cols, size_t nnz, type dtype)
+{
+    sp->format = CSR;
+    sp->rows = rows;
+    sp->cols = cols;
+    sp->nnz = nnz;
+    sp->capacity = nnz;
+    sp->dtype = dtype;
+    sp->type_size = get_type_size(dtype);
+    sp->row_indices = malloc(sizeof(size_t) * (rows + 1));
+    sp->col_indices = malloc(sizeof(size_t) * (nnz > 0 ? nnz : 1));
+    sp->values = malloc(sp->type_size * (nnz > 0 ? nnz : 1));
+}
+
+void sparse_init(sparse_array* sp, size_t rows, size_t cols, type dtype)
+{
+    sp->format = COO;
+    sp->rows = rows;
+    sp->cols = cols;
+    sp->nnz = 0;
+    sp->capacity = 16;
+    sp->dtype = dtype;
+    sp->type_size = get_type_size(dtype);
+    sp->row_indices = malloc(sizeof(size_t) * sp->capacity);
+    sp->col_indices = malloc(sizeof(size_t) * sp->capacity);
+    sp->values = malloc(sp->type_size * sp->capacity);
+}
+
+void sparse_free(sparse_array* sp)
+{
+    if (sp->values)
+    {
+        free(sp->row_indices);
+        free(sp->col_indices);
+        free(sp->values);
+        sp->row_indices = NULL;
+        sp->col_indices = NULL;
+        sp->values = NULL;
+    }
+}
+
+void sparse_insert(sparse_array* sp, size_t row, size_t col, void* value)
+{
+    if (!sp->values || row >= sp->rows || col >= sp->cols)
+        return;
+
+    // go back to COO to accept new entries; the next compute call converts again
+    if (sp->format == CSR)
+    {
+        size_t* rows = malloc(sizeof(size_t) * (sp->nnz > 0 ? sp->nnz : 1));
+        for (size_t r = 0; r < sp->rows; ++r)
+            for (size_t i = sp->row_indices[r]; i < sp->row_indices[r + 1]; ++i)
+                rows[i] = r;
+        free(sp->row_indices);
+        sp->row_indices = rows;
+        sp->capacity = sp->nnz > 0 ? sp->nnz : 1;
+        sp->format = COO;
+    }
+
+    if (sp->nnz == sp->capacity)
+    {
+        sp->capacity *= 2;
+        sp->row_indices = realloc(sp->row_indices, sizeof(size_t) * sp->capacity);
+        sp->col_indices = realloc(sp->col_indices, sizeof(size_t) * sp->capacity);
+        sp->values = realloc(sp->values, sp->type_size * sp->capacity);
+    }
+
+    sp->row_indices[sp->nnz] = row;
+    sp->col_indices[sp->nnz] = col;
+    memcpy((char*)sp->values + sp->nnz * sp->type_size, value, sp->type_size);
+    sp->nnz++;
+}
+
+// entry of a row being sorted by column during COO -> CSR conversion
+typedef struct
+{
+    size_t col;
+    size_t src;
+} coo_entry;
+
+static int cmp_coo_entry(const void* a, const void* b)
+{
+    size_t x = ((const coo_entry*)a)->col, y = ((const coo_entry*)b)->col;
+    return (x > y) - (x < y);
+}
+
+void sparse_to_csr(sparse_array* sp)
+{
+    if (!sp->values || sp->format == CSR)
+        return;
+
+    // counting sort by row gives every row a contiguous segment
+    size_t* row_ptr = calloc(sp->rows + 1, sizeof(size_t));
+    for (size_t i = 0; i < sp->nnz; ++i)
+        row_ptr[sp->row_indices[i] + 1]++;
+    for (size_t r = 0; r < sp->rows; ++r)
+        row_ptr[r + 1] += row_ptr[r];
+
+    coo_entry* entries = malloc(sizeof(coo_entry) * (sp->nnz > 0 ? sp->nnz : 1));
+    size_t* next = malloc(sizeof(size_t) * (sp->rows > 0 ? sp->rows : 1));
+    memcpy(next, row_ptr, sizeof(size_t) * sp->rows);
+    for (size_t i = 0; i < sp->nnz; ++i)
+    {
+        size_t dst = next[sp->row_indices[i]]++;
+        entries[dst].col = sp->col_indices[i];
+        entries[dst].src = i;
+    }
+
+    // sort each row by column and merge duplicates by adding them
+    size_t* cols = malloc(sizeof(size_t) * (sp->nnz > 0 ? sp->nnz : 1));
+    char* values = malloc(sp->type_size * (sp->nnz > 0 ? sp->nnz : 1));
+    size_t nnz = 0;
+    for (size_t r = 0; r < sp->rows; ++r)
+    {
+        size_t begin = row_ptr[r], end = row_ptr[r + 1];
+        qsort(entries + begin, end - begin, sizeof(coo_entry), cmp_coo_entry);
+        row_ptr[r] = nnz;
+        for (size_t i = begin; i < end; ++i)
+        {
+            char* src = (char*)sp->values + entries[i].src * sp->type_size;
+            if (nnz > row_ptr[r] && cols[nnz - 1] == entries[i].col)
+                add_value(sp->dtype, values + (nnz - 1) * sp->type_size, src);
+            else
+            {
+                cols[nnz] = entries[i].col;
+                memcpy(values + nnz * sp->type_size, src, sp->type_size);
+                nnz++;
+            }
+        }
+    }
+    row_ptr[sp->rows] = nnz;
+
+    free(entries);
+    free(next);
+    free(sp->row_indices);
+    free(sp->col_indices);
+    free(sp->values);
+    sp->row_indices = row_ptr;
+    sp->col_indices = cols;
+    sp->values = values;
+    sp->nnz = nnz;
+    sp->capacity = nnz;
+    sp->format = CSR;
+}
+
+void sparse_from_dense(array* arr, sparse_array* sp)
+{
+    if ((!arr->data && !arr->packed) || arr->shape_size != 2)
+        return;
+
+    size_t rows = arr->arr_shape[0], cols = arr->arr_shape[1];
+    void* scratch = arr->packed ? malloc(arr->type_size * cols) : NULL;
+
+    // first pass counts the non-zeros so CSR can be sized exactly
+    size_t nnz = 0;
+    for (size_t r = 0; r < rows; ++r)
+    {
+        char* row = element_view(arr, r * cols, cols, scratch);
+        for (size_t c = 0; c < cols; ++c)
+            if (!is_zero(arr->dtype, row + c * arr->type_size))
+                nnz++;
+    }
+
+    alloc_csr(sp, rows, cols, nnz, arr->dtype);
+    nnz = 0;
+    for (size_t r = 0; r < rows; ++r)
+    {
+        sp->row_indices[r] = nnz;
+        char* row = element_view(arr, r * cols, cols, scratch);
+        for (size_t c = 0; c < cols; ++c)
+        {
+            if (is_zero(arr->dtype, row + c * arr->type_size))
+                continue;
+            sp->col_indices[nnz] = c;
+            memcpy((char*)sp->values + nnz * sp->type_size, row + c * arr->type_size, sp->type_size);
+            nnz++;
+        }
+    }
+    sp->row_indices[rows] = nnz;
+
+    free(scratch);
+}
+
+void sparse_to_dense(sparse_array* sp, array* arr)
+{
+    if (!sp->values)
+        return;
+
+    sparse_to_csr(sp);
+
+    size_t shape[2] = { sp->rows, sp->cols };
+    arr_init(arr, shape, 2, sp->dtype);
+    memset(arr->data, 0, arr->type_size * arr->total_size);
+    for (size_t r = 0; r < sp->rows; ++r)
+        for (size_t i = sp->row_indices[r]; i < sp->row_indices[r + 1]; ++i)
+            memcpy((char*)arr->data + (r * sp->cols + sp->col_indices[i]) * arr->type_size,
+                   (char*)sp->values + i * sp->type_size, sp->type_size);
+}
+
+float sparse_sum(sparse_array* sp)
+{
+    float sum = 0.0;
+    if (!sp->values)
+        return sum;
+
+    // works on either format since it only looks at the values
+    for (size_t i = 0; i < sp->nnz; ++i)
+        sum += sparse_value(sp, i);
+    return sum;
+}
+
+void sparse_sum_axis(sparse_array* sp, size_t axis, array* dest)
+{
+    if (!sp->values || axis > 1)
+        return;
+
+    sparse_to_csr(sp);
+
+    // axis 0 sums down the rows (one value per column), axis 1 across the columns (one value per row)
+    size_t shape[1] = { axis == 0 ? sp->cols : sp->rows };
+    arr_init(dest, shape, 1, FLOAT);
+    float* out = dest->data;
+    for (size_t i = 0; i < shape[0]; ++i)
+        out[i] = 0.0f;
+
+    for (size_t r = 0; r < sp->rows; ++r)
+        for (size_t i = sp->row_indices[r]; i < sp->row_indices[r + 1]; ++i)
+            out[axis == 0 ? sp->col_indices[i] : r] += sparse_value(sp, i);
+}
+
+void sparse_filter(sparse_array* sp, bool (*filter)(void*), size_t* secondary_indices, size_t secondary_indices_size, filter_type ftype, sparse_array* dest)
+{
+    if (!sp->values)
+        return;
+
+    sparse_to_csr(sp);
+
+    // columns that take part in the filter; same defaults as arr_filter
+    bool* checked = malloc(sizeof(bool) * (sp->cols > 0 ? sp->cols : 1));
+    size_t num_checked = 0;
+    for (size_t c = 0; c < sp->cols; ++c)
+        checked[c] = secondary_indices == NULL;
+    if (secondary_indices == NULL)
+        num_checked = sp->cols;
+    else
+        for (size_t i = 0; i < secondary_indices_size; ++i)
+            if (secondary_indices[i] < sp->cols && !checked[secondary_indices[i]])
+            {
+                checked[secondary_indices[i]] = true;
+                num_checked++;
+            }
+
+    // every implicit zero gives the same answer, so ask the filter once
+    int64_t zero = 0;
+    bool zero_matches = filter(&zero);
+
+    bool* keep = malloc(sizeof(bool) * (sp->rows > 0 ? sp->rows : 1));
+    size_t kept_rows = 0, kept_nnz = 0;
+    for (size_t r = 0; r < sp->rows; ++r)
+    {
+        size_t stored_checked = 0;
+        bool any = false, all = true;
+        for (size_t i = sp->row_indices[r]; i < sp->row_indices[r + 1]; ++i)
+        {
+            if (!checked[sp->col_indices[i]])
+                continue;
+            stored_checked++;
+            bool match = filter((char*)sp->values + i * sp->type_size);
+            any |= match;
+            all &= match;
+        }
+
+        if (stored_checked < num_checked)
+        {
+            any |= zero_matches;
+            all &= zero_matches;
+        }
+
+        keep[r] = ftype == ANY ? any : all;
+        if (keep[r])
+        {
+            kept_rows++;
+            kept_nnz += sp->row_indices[r + 1] - sp->row_indices[r];
+        }
+    }
+
+    if (dest->values != NULL)
+        sparse_free(dest);
+
+    alloc_csr(dest, kept_rows, sp->cols, kept_nnz, sp->dtype);
+    size_t out_row = 0, nnz = 0;
+    for (size_t r = 0; r < sp->rows; ++r)
+    {
+        if (!keep[r])
+            continue;
+        dest->row_indices[out_row++] = nnz;
+        size_t begin = sp->row_indices[r], count = sp->row_indices[r + 1] - begin;
+        memcpy(dest->col_indices + nnz, sp->col_indices + begin, sizeof(size_t) * count);
+        memcpy((char*)dest->values + nnz * dest->type_size, (char*)sp->values + begin * sp->type_size, sp->type_size * count);
+        nnz += count;
+    }
+    dest->row_indices[kept_rows] = nnz;
+
+    free(checked);
+    free(keep);
+}
+
+void sparse_matmul(sparse_array* sp, array* mat, array* dest)
+{
+    if (!sp->values || (!mat->data && !mat->packed) || mat->arr_shape[0] != sp->cols || mat->shape_size > 2)
+        return;
+
+    sparse_to_csr(sp);
+
+    // a 1D right hand side is a vector and gives a 1D result
+    size_t k = mat->shape_size == 2 ? mat->arr_shape[1] : 1;
+    size_t shape[2] = { sp->rows, k };
+    arr_init(dest, shape, mat->shape_size, FLOAT);
+    float* out = dest->data;
+    for (size_t i = 0; i < dest->total_size; ++i)
+        out[i] = 0.0f;
+
+    void* scratch = mat->packed ? malloc(mat->type_size * k) : NULL;
+    for (size_t r = 0; r < sp->rows; ++r)
+    {
+        float* out_row = out + r * k;
+        for (size_t i = sp->row_indices[r]; i < sp->row_indices[r + 1]; ++i)
+        {
+            // out_row += value * (row col_indices[i] of mat)
+            float v = sparse_value(sp, i);
+            void* mat_row = element_view(mat, sp->col_indices[i] * k, k, scratch);
+            if (mat->dtype == FLOAT)
+                for (size_t j = 0; j < k; ++j)
+                    out_row[j] += v * ((float*)mat_row)[j];
+            else
+                for (size_t j = 0; j < k; ++j)
+                    out_row[j] += v * ((int32_t*)mat_row)[j];
+        }
+    }
+    free(scratch);
+}
@@ -0,0 +1,190 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+
+// Instrumentation counters, compiled in with -DZUMPY_STATS (the ZUMPY_STATS CMake option).
+//
+// Every thread counts into a block of its own (found through a thread-local pointer) so the hot paths never
+// contend; arr_stats_get adds the blocks of all threads together. Blocks of threads that have exited are kept so
+// their counts aren't lost. Live/peak bytes and the allocation counts are process wide since memory allocated on
+// one thread may be freed on another; they only change when storage is allocated or freed.
+//
+// Without ZUMPY_STATS the macros in zumpy_internal.h compile to nothing and arr_stats_get reports zeros.
+
+static const char* op_names[STAT_OP_COUNT] = {
+    "arr_init",
+    "arr_free",
+    "arr_at",
+    "arr_set",
+    "arr_fill",
+    "arr_sum",
+    "arr_slice",
+    "arr_filter",
+    "filter_callback",
+    "arr_filter_range",
+    "arr_print",
+    "get_index_combinations",
+    "arr_append_rows",
+    "arr_compress",
+    "arr_random",
+    "arr_get_many",
+    "arr_set_many",
+    "arr_filter_block",
+    "arr_aggregates_get",
+    "arr_histogram",
+    "arr_quantiles",
+};
+
+const char* arr_stats_op_name(size_t op)
+{
+    return op < STAT_OP_COUNT ? op_names[op] : NULL;
+}
+
+size_t arr_stats_op_count(void)
+{
+    return STAT_OP_COUNT;
+}
+
+#ifdef ZUMPY_STATS
+
+#include <pthread.h>
+#include <time.h>
+
+// relaxed atomics so arr_stats_get can read other threads' counters; the owner's update is still a plain add
+#define LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+
+struct stats_block
+{
+    arr_op_stats ops[STAT_OP_COUNT];
+    struct stats_block* next;
+};
+
+static struct stats_block* all_blocks = NULL;
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct stats_block* local_block = NULL;
+
+static uint64_t live_bytes = 0;
+static uint64_t peak_bytes = 0;
+static uint64_t allocations = 0;
+static uint64_t policy_allocations[ALLOC_POLICY_COUNT];
+static uint64_t policy_bytes[ALLOC_POLICY_COUNT];
+
+static struct stats_block* thread_block(void)
+{
+    if (local_block == NULL)
+    {
+        struct stats_block* block = calloc(1, sizeof(struct stats_block));
+        pthread_mutex_lock(&blocks_lock);
+        block->next = all_blocks;
+        all_blocks = block;
+        pthread_mutex_unlock(&blocks_lock);
+        local_block = block;
+    }
+    return local_block;
+}
+
+uint64_t stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void stats_record(stat_op op, uint64_t bytes, uint64_t nanoseconds)
+{
+    arr_op_stats* s = &thread_block()->ops[op];
+    STORE(s->calls, LOAD(s->calls) + 1);
+    STORE(s->bytes, LOAD(s->bytes) + bytes);
+    STORE(s->nanoseconds, LOAD(s->nanoseconds) + nanoseconds);
+}
+
+void stats_alloc(uint64_t bytes)
+{
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    uint64_t live = __atomic_add_fetch(&live_bytes, bytes, __ATOMIC_RELAXED);
+    uint64_t peak = LOAD(peak_bytes);
+    while (live > peak && !__atomic_compare_exchange_n(&peak_bytes, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+void stats_free(uint64_t bytes)
+{
+    __atomic_sub_fetch(&live_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void stats_policy(alloc_policy policy, uint64_t bytes)
+{
+    __atomic_add_fetch(&policy_allocations[policy], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&policy_bytes[policy], bytes, __ATOMIC_RELAXED);
+}
+
+bool arr_stats_enabled(void)
+{
+    return true;
+}
+
+void arr_stats_get(arr_stats* stats)
+{
+    memset(stats, 0, sizeof(arr_stats));
+
+    pthread_mutex_lock(&blocks_lock);
+    for (struct stats_block* block = all_blocks; block != NULL; block = block->next)
+        for (size_t op = 0; op < STAT_OP_COUNT; ++op)
+        {
+            stats->ops[op].calls += LOAD(block->ops[op].calls);
+            stats->ops[op].bytes += LOAD(block->ops[op].bytes);
+            stats->ops[op].nanoseconds += LOAD(block->ops[op].nanoseconds);
+        }
+    pthread_mutex_unlock(&blocks_lock);
+
+    stats->live_bytes = LOAD(live_bytes);
+    stats->peak_bytes = LOAD(peak_bytes);
+    stats->allocations = LOAD(allocations);
+    for (size_t policy = 0; policy < ALLOC_POLICY_COUNT; ++policy)
+    {
+        stats->policy_allocations[policy] = LOAD(policy_allocations[policy]);
+        stats->policy_bytes[policy] = LOAD(policy_bytes[policy]);
+    }
+}
+
+void arr_stats_reset(void)
+{
+    pthread_mutex_lock(&blocks_lock);
+    for (struct stats_block* block = all_blocks; block != NULL; block = block->next)
+        for (size_t op = 0; op < STAT_OP_COUNT; ++op)
+        {
+            STORE(block->ops[op].calls, 0);
+            STORE(block->ops[op].bytes, 0);
+            STORE(block->ops[op].nanoseconds, 0);
+        }
+    pthread_mutex_unlock(&blocks_lock);
+
+    // live bytes describe memory that is still allocated, so only the peak starts over
+    STORE(peak_bytes, LOAD(live_bytes));
+    STORE(allocations, 0);
+    for (size_t policy = 0; policy < ALLOC_POLICY_COUNT; ++policy)
+    {
+        STORE(policy_allocations[policy], 0);
+        STORE(policy_bytes[policy], 0);
+    }
+}
+
+#else
+
+bool arr_stats_enabled(void)
+{
+    return false;
+}
+
+void arr_stats_get(arr_stats* stats)
+{
+    memset(stats, 0, sizeof(arr_stats));
+}
+
+void arr_stats_reset(void)
+{
+}
+
+#endif
@@ -0,0 +1,211 @@
+#include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <math.h>
+
+struct zone_map* zone_map_alloc(array* arr)
+{
+    struct zone_map* zmap = malloc(sizeof(struct zone_map));
+    zmap->block_rows = ZONE_MAP_BLOCK_ROWS;
+    zmap->num_blocks = (arr->arr_shape[0] + zmap->block_rows - 1) / zmap->block_rows;
+    zmap->num_columns = column_count(arr);
+    zmap->min = malloc(sizeof(double) * zmap->num_blocks * zmap->num_columns);
+    zmap->max = malloc(sizeof(double) * zmap->num_blocks * zmap->num_columns);
+    zmap->nan_count = malloc(sizeof(uint64_t) * zmap->num_blocks * zmap->num_columns);
+    zmap->valid = malloc(sizeof(bool) * zmap->num_blocks);
+    for (size_t i = 0; i < zmap->num_blocks; ++i)
+        zmap->valid[i] = false;
+    zmap->sum = NULL;
+    zmap->generation = shared_generation(arr->buffer);
+    return zmap;
+}
+
+// internal function to rescan one block of rows. For 1D arrays every row is a single element
+// so there is just one column; otherwise the column of an element is its last-dimension index.
+// scratch holds one block of rows for compressed arrays. Returns the number of elements scanned.
+static size_t scan_block(array* arr, struct zone_map* zmap, size_t block, void* scratch)
+{
+    size_t ncols = zmap->num_columns;
+    double* bmin = zmap->min + block * ncols;
+    double* bmax = zmap->max + block * ncols;
+    uint64_t* bnan = zmap->nan_count + block * ncols;
+    for (size_t c = 0; c < ncols; ++c)
+    {
+        bmin[c] = INFINITY;
+        bmax[c] = -INFINITY;
+        bnan[c] = 0;
+    }
+
+    size_t row_len = row_length(arr);
+    size_t first_row = block * zmap->block_rows;
+    size_t last_row = first_row + zmap->block_rows;
+    if (last_row > arr->arr_shape[0])
+        last_row = arr->arr_shape[0];
+    size_t start = first_row * row_len;
+    size_t count = (last_row - first_row) * row_len;
+    void* view = element_view(arr, start, count, scratch);
+    double sum = 0.0;
+
+    switch (arr->dtype)
+    {
+        case INT32:
+        {
+            int32_t* data = view;
+            for (size_t i = 0; i < count; ++i)
+            {
+                size_t c = i % ncols;
+                double v = data[i];
+                if (v < bmin[c]) bmin[c] = v;
+                if (v > bmax[c]) bmax[c] = v;
+                sum += v;
+            }
+            break;
+        }
+        case FLOAT:
+        {
+            float* data = view;
+            for (size_t i = 0; i < count; ++i)
+            {
+                size_t c = i % ncols;
+                double v = data[i];
+                // NaN never matches a range so it must not widen the block either, but a block holding one can't
+                // be taken whole by a range filter
+                if (isnan(v)) bnan[c]++;
+                if (v < bmin[c]) bmin[c] = v;
+                if (v > bmax[c]) bmax[c] = v;
+                sum += v;
+            }
+            break;
+        }
+    }
+
+    if (zmap->sum)
+        zmap->sum[block] = sum;
+    zmap->valid[block] = true;
+    return count;
+}
+
+size_t zone_map_refresh(array* arr)
+{
+    if (!arr->data && !arr->packed)
+        return 0;
+
+    if (arr->zone_map == NULL)
+        arr->zone_map = zone_map_alloc(arr);
+
+    // another process wrote to the shared segment since the last refresh, so nothing can be trusted
+    uint64_t generation = shared_generation(arr->buffer);
+    if (generation != arr->zone_map->generation)
+    {
+        zone_map_invalidate_all(arr);
+        arr->zone_map->generation = generation;
+    }
+
+    void* scratch = NULL;
+    if (arr->packed)
+        scratch = malloc(arr->type_size * row_length(arr) * arr->zone_map->block_rows);
+
+    size_t scanned = 0;
+    for (size_t b = 0; b < arr->zone_map->num_blocks; ++b)
+        if (!arr->zone_map->valid[b])
+            scanned += scan_block(arr, arr->zone_map, b, scratch);
+
+    free(scratch);
+    return scanned;
+}
+
+void zone_map_invalidate(array* arr, size_t offset)
+{
+    if (arr->zone_map == NULL || row_length(arr) == 0)
+        return;
+
+    size_t row = offset / row_length(arr);
+    arr->zone_map->valid[row / arr->zone_map->block_rows] = false;
+}
+
+void zone_map_invalidate_all(array* arr)
+{
+    if (arr->zone_map == NULL)
+        return;
+
+    for (size_t i = 0; i < arr->zone_map->num_blocks; ++i)
+        arr->zone_map->valid[i] = false;
+}
+
+void zone_map_resize(array* arr)
+{
+    struct zone_map* zmap = arr->zone_map;
+    if (zmap == NULL)
+        return;
+
+    size_t old_blocks = zmap->num_blocks;
+    size_t new_blocks = (arr->arr_shape[0] + zmap->block_rows - 1) / zmap->block_rows;
+    if (new_blocks != old_blocks)
+    {
+        size_t entries = (new_blocks > 0 ? new_blocks : 1) * zmap->num_columns;
+        zmap->min = realloc(zmap->min, sizeof(double) * entries);
+        zmap->max = realloc(zmap->max, sizeof(double) * entries);
+        zmap->nan_count = realloc(zmap->nan_count, sizeof(uint64_t) * entries);
+        zmap->valid = realloc(zmap->valid, sizeof(bool) * (new_blocks > 0 ? new_blocks : 1));
+        if (zmap->sum)
+            zmap->sum = realloc(zmap->sum, sizeof(double) * (new_blocks > 0 ? new_blocks : 1));
+        zmap->num_blocks = new_blocks;
+    }
+
+    // the last old block may have been partial, so it is rescanned together with the new ones
+    for (size_t b = old_blocks > 0 ? old_blocks - 1 : 0; b < new_blocks; ++b)
+        zmap->valid[b] = false;
+}
+
+void zone_map_free(array* arr)
+{
+    if (arr->zone_map == NULL)
+        return;
+
+    free(arr->zone_map->min);
+    free(arr->zone_map->max);
+    free(arr->zone_map->nan_count);
+    free(arr->zone_map->valid);
+    free(arr->zone_map->sum);
+    free(arr->zone_map);
+    arr->zone_map = NULL;
+}
+
+void arr_zone_map_build(array* arr)
+{
+    zone_map_refresh(arr);
+}
+
+void arr_zone_map_drop(array* arr)
+{
+    zone_map_free(arr);
+}
+
+void arr_aggregate_cache(array* arr, bool enable)
+{
+    if (!arr->data && !arr->packed)
+        return;
+
+    if (!enable)
+    {
+        if (arr->zone_map)
+        {
+            free(arr->zone_map->sum);
+            arr->zone_map->sum = NULL;
+        }
+        return;
+    }
+
+    if (arr->zone_map == NULL)
+        arr->zone_map = zone_map_alloc(arr);
+    if (arr->zone_map->sum == NULL)
+    {
+        // blocks scanned before the cache was on have no sum yet
+        arr->zone_map->sum = malloc(sizeof(double) * (arr->zone_map->num_blocks > 0 ? arr->zone_map->num_blocks : 1));
+        zone_map_invalidate_all(arr);
+    }
+}
+
+bool arr_aggregate_cached(array* arr)
+{
+    return arr->zone_map != NULL && arr->zone_map->sum != NULL;
+}
@@ -1,4 +1,6 @@
 #include "include/zumpy.h"
+#include "include/zumpy_internal.h"
+#include <math.h>
 
 // internal function for getting the size of the data type based off the enum
 int get_type_size(type dtype)
@@ -16,8 +18,10 @@ int get_type_size(type dtype)
     return -1;
 }
 
-void arr_init(array* arr, size_t* arr_shape, size_t shape_size, type dtype)
+// internal function shared by arr_init and arr_zeros
+static void init(array* arr, size_t* arr_shape, size_t shape_size, type dtype, bool zeroed)
 {
+    STATS_BEGIN();
     arr->type_size = get_type_size(dtype);
     arr->arr_shape = malloc(sizeof(size_t) * shape_size);
     for (size_t i = 0; i < shape_size; ++i)
@@ -29,19 +33,179 @@ void arr_init(array* arr, size_t* arr_shape, size_t shape_size, type dtype)
         for (size_t i = 1; i < shape_size; ++i)
             alloc_size *= arr_shape[i];
     arr->total_size = alloc_size;
+    arr->capacity = arr_shape[0];
+    arr->zone_map = NULL;
+    arr->packed = NULL;
 
-    void *alloc = malloc(sizeof(arr->type_size) * alloc_size);
-    if (alloc)
-        arr->data = alloc;
+    arr->buffer = zeroed ? buffer_alloc_zeroed(arr->type_size * alloc_size) : buffer_alloc(arr->type_size * alloc_size);
+    arr->data = arr->buffer ? arr->buffer->data : NULL;
+    STATS_END(STAT_ARR_INIT, arr->type_size * alloc_size);
 }
 
-void arr_free(array* arr)
+void arr_init(array* arr, size_t* arr_shape, size_t shape_size, type dtype)
+{
+    init(arr, arr_shape, shape_size, dtype, false);
+}
+
+void arr_zeros(array* arr, size_t* arr_shape, size_t shape_size, type dtype)
 {
+    // calloc hands large allocations straight from fresh zero pages, so nothing is written up front
+    init(arr, arr_shape, shape_size, dtype, true);
+}
+
+// internal function to write start + i*step into every element of a 1D array
+static void fill_sequence(array* arr, double start, double step)
+{
+    switch (arr->dtype)
+    {
+        case INT32:
+            for (size_t i = 0; i < arr->total_size; ++i)
+                ((int32_t*)arr->data)[i] = (int32_t)(start + i * step);
+            break;
+        case FLOAT:
+            for (size_t i = 0; i < arr->total_size; ++i)
+                ((float*)arr->data)[i] = (float)(start + i * step);
+            break;
+    }
+}
+
+void arr_arange(array* arr, double start, double stop, double step, type dtype)
+{
+    size_t count = 0;
+    if ((step > 0 && stop > start) || (step < 0 && stop < start))
+        count = (size_t)ceil((stop - start) / step);
+
+    arr_init(arr, &count, 1, dtype);
     if (arr->data)
+        fill_sequence(arr, start, step);
+}
+
+void arr_linspace(array* arr, double start, double stop, size_t num, type dtype)
+{
+    arr_init(arr, &num, 1, dtype);
+    if (!arr->data || num == 0)
+        return;
+
+    fill_sequence(arr, start, num > 1 ? (stop - start) / (num - 1) : 0.0);
+    // write the end point exactly rather than accumulating rounding error into it
+    if (num > 1)
+    {
+        switch (dtype)
+        {
+            case INT32:
+                ((int32_t*)arr->data)[num - 1] = (int32_t)stop;
+                break;
+            case FLOAT:
+                ((float*)arr->data)[num - 1] = (float)stop;
+                break;
+        }
+    }
+}
+
+void arr_free(array* arr)
+{
+    if (arr->data || arr->packed)
     {
-        free(arr->data);
+        STATS_BEGIN();
+        zone_map_free(arr);
+        packed_free(arr);
+        // other arrays may still share the buffer; it is freed with the last reference
+        buffer_release(arr->buffer);
         free(arr->arr_shape);
+        arr->buffer = NULL;
         arr->data = NULL;
         arr->arr_shape = NULL;
+        // the element count and size are left as they were, so they still describe what was freed
+        STATS_END(STAT_ARR_FREE, arr->type_size * arr->total_size);
     }
+}
+
+// internal function to reallocate the data for a new row capacity
+static void set_capacity(array* arr, size_t rows)
+{
+    if (buffer_resize(arr, arr->type_size * row_length(arr) * rows))
+        arr->capacity = rows;
+}
+
+void arr_reserve(array* arr, size_t rows)
+{
+    if (!arr->arr_shape || rows <= arr->capacity)
+        return;
+
+    arr_decompress(arr);
+    if (arr->packed)
+        return; // out of memory
+    set_capacity(arr, rows);
+}
+
+void arr_shrink_to_fit(array* arr)
+{
+    if (!arr->data || arr->capacity == arr->arr_shape[0])
+        return;
+
+    set_capacity(arr, arr->arr_shape[0]);
+}
+
+// internal function to check that rows can be appended to arr, i.e everything but index 0 matches
+static bool rows_compatible(array* arr, array* rows)
+{
+    if (arr->dtype != rows->dtype || arr->shape_size != rows->shape_size)
+        return false;
+    for (size_t i = 1; i < arr->shape_size; ++i)
+        if (arr->arr_shape[i] != rows->arr_shape[i])
+            return false;
+    return true;
+}
+
+void arr_append_rows(array* arr, array* rows)
+{
+    if (!arr->arr_shape || !rows->arr_shape || !rows_compatible(arr, rows))
+        return;
+
+    STATS_BEGIN();
+    size_t old_rows = arr->arr_shape[0];
+    size_t new_rows = old_rows + rows->arr_shape[0];
+    if (new_rows > arr->capacity)
+    {
+        // grow geometrically so a stream of appends costs amortized O(1) per row
+        size_t capacity = arr->capacity > 0 ? arr->capacity : 1;
+        while (capacity < new_rows)
+            capacity *= 2;
+        arr_reserve(arr, capacity);
+        if (arr->capacity < new_rows)
+        {
+            STATS_END(STAT_ARR_APPEND_ROWS, 0);
+            return; // out of memory
+        }
+    }
+    arr_decompress(arr);
+    if (arr->packed)
+    {
+        STATS_END(STAT_ARR_APPEND_ROWS, 0);
+        return; // out of memory
+    }
+    buffer_make_unique(arr);
+
+    size_t row_len = row_length(arr);
+    read_elements(rows, 0, rows->total_size, (char*)arr->data + old_rows * row_len * arr->type_size);
+
+    arr->arr_shape[0] = new_rows;
+    arr->total_size = new_rows * row_len;
+    zone_map_resize(arr);
+    STATS_END(STAT_ARR_APPEND_ROWS, rows->total_size * arr->type_size);
+}
+
+void arr_concatenate(array* first, array* second, array* dest)
+{
+    if (!first->arr_shape || !second->arr_shape || !rows_compatible(first, second))
+        return;
+
+    size_t shape[first->shape_size];
+    shape[0] = first->arr_shape[0] + second->arr_shape[0];
+    for (size_t i = 1; i < first->shape_size; ++i)
+        shape[i] = first->arr_shape[i];
+
+    arr_init(dest, shape, first->shape_size, first->dtype);
+    read_elements(first, 0, first->total_size, dest->data);
+    read_elements(second, 0, second->total_size, (char*)dest->data + first->total_size * dest->type_size);
 }
\ No newline at end of file
@@ -36,6 +36,7 @@ bool check_index_zero(size_t* index, size_t len)
 // allocate the memory inside this function.
 size_t** get_index_combinations(size_t* sub_arr_dims, size_t sub_arr_dims_len, size_t** indices)
 {
+    STATS_BEGIN();
     size_t* bounds = malloc(sizeof(size_t) * sub_arr_dims_len);
     size_t* current_idx = malloc(sizeof(size_t) * sub_arr_dims_len);
     size_t total_combinations = 1;
@@ -79,9 +80,28 @@ size_t** get_index_combinations(size_t* sub_arr_dims, size_t sub_arr_dims_len, s
     free(bounds);
     free(current_idx);
 
+    // bytes is what the caller now holds: the pointer table and one index per combination
+    STATS_END(STAT_INDEX_COMBINATIONS, total_combinations * (sizeof(size_t*) + sizeof(size_t) * sub_arr_dims_len));
     return indices;
 }
 
+// number of elements in one row (everything below index 0)
+size_t row_length(array* arr)
+{
+    size_t len = 1;
+    for (size_t i = 1; i < arr->shape_size; ++i)
+        len *= arr->arr_shape[i];
+    return len;
+}
+
+// number of columns used by filters, i.e the size of the last dimension (1 for 1D arrays)
+size_t column_count(array* arr)
+{
+    if (arr->shape_size == 1)
+        return 1;
+    return arr->arr_shape[arr->shape_size - 1];
+}
+
 int cmp(const void* a, const void* b)
 {
     return *(size_t*)a - *(size_t*)b;
@@ -0,0 +1,413 @@
+// Optional native binding for zumpy.py (built with -DZUMPY_PYTHON_EXTENSION=ON).
+//
+// _zumpy.array keeps the library's array struct inline and links against libZumpy.so, so it shares the library
+// (and its global state) with the ctypes binding. zumpy.array derives from it when the module is present: the ctypes
+// code keeps working on a view of the same struct, while element access, fill and sum are served here without
+// ctypes marshalling. Elements are exported read-only through the buffer protocol (memoryview, NumPy); compressed
+// arrays are refused rather than silently decompressed.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "../c/include/zumpy.h"
+#include "../c/include/zumpy_internal.h"
+
+// arrays with more dimensions than this take the Python path for indexing
+#define MAX_FAST_DIMS 32
+
+typedef struct
+{
+    PyObject_HEAD
+    array arr;
+} ArrayObject;
+
+static PyObject* array_new(PyTypeObject* type, PyObject* args, PyObject* kwargs)
+{
+    (void)args;
+    (void)kwargs;
+    // tp_alloc zeroes the object, which is the state of an array that hasn't been created yet
+    return type->tp_alloc(type, 0);
+}
+
+static void array_dealloc(ArrayObject* self)
+{
+    arr_free(&self->arr);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static bool has_elements(array* arr)
+{
+    return arr->data != NULL || arr->packed != NULL;
+}
+
+// internal function to convert key to an index into arr; false (without an exception) if it isn't a full index
+// of plain ints, or with an exception set if it is out of range
+static bool parse_index(array* arr, PyObject* key, size_t* index, bool* failed)
+{
+    *failed = false;
+    if (!has_elements(arr) || arr->shape_size > MAX_FAST_DIMS)
+        return false;
+
+    Py_ssize_t n;
+    PyObject** items;
+    if (PyLong_CheckExact(key))
+    {
+        n = 1;
+        items = &key;
+    }
+    else if (PyTuple_CheckExact(key) || PyList_CheckExact(key))
+    {
+        n = PySequence_Fast_GET_SIZE(key);
+        items = PySequence_Fast_ITEMS(key);
+    }
+    else
+        return false;
+
+    if ((size_t)n != arr->shape_size)
+        return false;
+
+    for (Py_ssize_t i = 0; i < n; ++i)
+    {
+        if (!PyLong_CheckExact(items[i]))
+            return false;
+        Py_ssize_t value = PyLong_AsSsize_t(items[i]);
+        if (value == -1 && PyErr_Occurred())
+        {
+            *failed = true;
+            return false;
+        }
+        if (value < 0 || (size_t)value >= arr->arr_shape[i])
+        {
+            PyErr_SetString(PyExc_IndexError, "zumpy: index out of range");
+            *failed = true;
+            return false;
+        }
+        index[i] = (size_t)value;
+    }
+    return true;
+}
+
+static PyObject* element_to_object(array* arr, void* element)
+{
+    if (element == NULL)
+        Py_RETURN_NONE;
+    switch (arr->dtype)
+    {
+        case INT32:
+            return PyLong_FromLong(*(int32_t*)element);
+        case FLOAT:
+            return PyFloat_FromDouble(*(float*)element);
+    }
+    Py_RETURN_NONE;
+}
+
+// internal function to convert value to the array's element type in out (4 bytes); false with an exception set
+static bool object_to_element(array* arr, PyObject* value, void* out)
+{
+    switch (arr->dtype)
+    {
+        case INT32:
+        {
+            long v = PyLong_AsLong(value);
+            if (v == -1 && PyErr_Occurred())
+                return false;
+            if (v < INT32_MIN || v > INT32_MAX)
+            {
+                PyErr_SetString(PyExc_OverflowError, "zumpy: value out of range for int32");
+                return false;
+            }
+            *(int32_t*)out = (int32_t)v;
+            return true;
+        }
+        case FLOAT:
+        {
+            double v = PyFloat_AsDouble(value);
+            if (v == -1.0 && PyErr_Occurred())
+                return false;
+            *(float*)out = (float)v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// internal function to hand anything the fast path doesn't cover to the Python implementation
+static PyObject* call_fallback(PyObject* self, const char* name, PyObject* key, PyObject* value)
+{
+    PyObject* method = PyObject_GetAttrString(self, name);
+    if (method == NULL)
+        return NULL;
+    PyObject* result = value ? PyObject_CallFunctionObjArgs(method, key, value, NULL) : PyObject_CallFunctionObjArgs(method, key, NULL);
+    Py_DECREF(method);
+    return result;
+}
+
+static PyObject* array_subscript(ArrayObject* self, PyObject* key)
+{
+    size_t index[MAX_FAST_DIMS];
+    bool failed;
+    if (parse_index(&self->arr, key, index, &failed))
+        return element_to_object(&self->arr, arr_at(&self->arr, index));
+    if (failed)
+        return NULL;
+    return call_fallback((PyObject*)self, "_getitem", key, NULL);
+}
+
+static int array_ass_subscript(ArrayObject* self, PyObject* key, PyObject* value)
+{
+    if (value == NULL)
+    {
+        PyErr_SetString(PyExc_TypeError, "zumpy: array elements can't be deleted");
+        return -1;
+    }
+
+    size_t index[MAX_FAST_DIMS];
+    bool failed;
+    if (parse_index(&self->arr, key, index, &failed) && (PyLong_Check(value) || PyFloat_Check(value)))
+    {
+        int32_t element;
+        if (!object_to_element(&self->arr, value, &element))
+            return -1;
+        arr_set(&self->arr, index, &element);
+        return 0;
+    }
+    if (failed)
+        return -1;
+
+    PyObject* result = call_fallback((PyObject*)self, "_setitem", key, value);
+    if (result == NULL)
+        return -1;
+    Py_DECREF(result);
+    return 0;
+}
+
+static PyObject* array_at(ArrayObject* self, PyObject* const* args, Py_ssize_t nargs)
+{
+    if (nargs != 1)
+    {
+        PyErr_SetString(PyExc_TypeError, "at() takes exactly one argument (the index)");
+        return NULL;
+    }
+    size_t index[MAX_FAST_DIMS];
+    bool failed;
+    if (parse_index(&self->arr, args[0], index, &failed))
+        return element_to_object(&self->arr, arr_at(&self->arr, index));
+    if (!failed)
+        PyErr_SetString(PyExc_IndexError, "zumpy: expected one int per dimension");
+    return NULL;
+}
+
+static PyObject* array_set(ArrayObject* self, PyObject* const* args, Py_ssize_t nargs)
+{
+    if (nargs != 2)
+    {
+        PyErr_SetString(PyExc_TypeError, "set() takes exactly two arguments (the index and the value)");
+        return NULL;
+    }
+    size_t index[MAX_FAST_DIMS];
+    bool failed;
+    if (!parse_index(&self->arr, args[0], index, &failed))
+    {
+        if (!failed)
+            PyErr_SetString(PyExc_IndexError, "zumpy: expected one int per dimension");
+        return NULL;
+    }
+    int32_t element;
+    if (!object_to_element(&self->arr, args[1], &element))
+        return NULL;
+    arr_set(&self->arr, index, &element);
+    Py_RETURN_NONE;
+}
+
+static PyObject* array_fill(ArrayObject* self, PyObject* const* args, Py_ssize_t nargs)
+{
+    if (nargs != 1)
+    {
+        PyErr_SetString(PyExc_TypeError, "fill() takes exactly one argument (the value)");
+        return NULL;
+    }
+    int32_t element;
+    if (!object_to_element(&self->arr, args[0], &element))
+        return NULL;
+    arr_fill(&self->arr, &element);
+    Py_RETURN_NONE;
+}
+
+static PyObject* array_sum(ArrayObject* self, PyObject* const* args, Py_ssize_t nargs)
+{
+    (void)args;
+    if (nargs != 0)
+    {
+        PyErr_SetString(PyExc_TypeError, "sum() takes no arguments");
+        return NULL;
+    }
+    // the GIL stays held: arr_sum can write the aggregate cache, and another thread could resize or free the array
+    // under it; sum_async() is the way to sum off the calling thread
+    return PyFloat_FromDouble(arr_sum(&self->arr));
+}
+
+// take over the array struct at the given address (filled in by the library through ctypes). The source is a plain
+// ctypes Structure that never frees anything, so it is left as it is and can still be read afterwards
+static PyObject* array_adopt(ArrayObject* self, PyObject* const* args, Py_ssize_t nargs)
+{
+    if (nargs != 1)
+    {
+        PyErr_SetString(PyExc_TypeError, "_adopt() takes exactly one argument (an address)");
+        return NULL;
+    }
+    array* source = PyLong_AsVoidPtr(args[0]);
+    if (source == NULL)
+    {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "zumpy: NULL array");
+        return NULL;
+    }
+    if (source != &self->arr)
+    {
+        arr_free(&self->arr);
+        self->arr = *source;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* array_address(ArrayObject* self, void* closure)
+{
+    (void)closure;
+    return PyLong_FromVoidPtr(&self->arr);
+}
+
+// what a buffer export owns: the shape and strides it describes, and a reference to the storage so the memory stays
+// valid even if the array is resized or freed while the export lives
+struct export_info
+{
+    struct arr_buffer* buffer;
+    Py_ssize_t dims[];
+};
+
+static int array_getbuffer(ArrayObject* self, Py_buffer* view, int flags)
+{
+    array* arr = &self->arr;
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+    {
+        PyErr_SetString(PyExc_BufferError, "zumpy: arrays are exported read-only; use set()/fill() to write");
+        return -1;
+    }
+    if (arr->packed != NULL)
+    {
+        PyErr_SetString(PyExc_BufferError, "zumpy: array is compressed; call decompress() before exporting it");
+        return -1;
+    }
+    if (arr->data == NULL || arr->buffer == NULL)
+    {
+        PyErr_SetString(PyExc_BufferError, "zumpy: array has no elements");
+        return -1;
+    }
+
+    struct export_info* info = PyMem_Malloc(sizeof(struct export_info) + 2 * arr->shape_size * sizeof(Py_ssize_t));
+    if (info == NULL)
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    Py_ssize_t* shape = info->dims;
+    Py_ssize_t* strides = info->dims + arr->shape_size;
+    Py_ssize_t stride = (Py_ssize_t)arr->type_size;
+    for (size_t i = arr->shape_size; i-- > 0;)
+    {
+        shape[i] = (Py_ssize_t)arr->arr_shape[i];
+        strides[i] = stride;
+        stride *= shape[i];
+    }
+
+    // a later write to the array copies it (copy-on-write), so the export never changes under its reader; arrays in a
+    // writable shared memory segment are the exception and are written in place
+    buffer_retain(arr->buffer);
+    info->buffer = arr->buffer;
+
+    view->obj = (PyObject*)self;
+    Py_INCREF(self);
+    view->buf = arr->data;
+    view->len = (Py_ssize_t)(arr->total_size * arr->type_size);
+    view->readonly = 1;
+    view->itemsize = (Py_ssize_t)arr->type_size;
+    view->format = (flags & PyBUF_FORMAT) ? (arr->dtype == INT32 ? "i" : "f") : NULL;
+    view->ndim = (int)arr->shape_size;
+    view->shape = (flags & PyBUF_ND) ? shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = info;
+    return 0;
+}
+
+static void array_releasebuffer(ArrayObject* self, Py_buffer* view)
+{
+    (void)self;
+    struct export_info* info = view->internal;
+    buffer_release(info->buffer);
+    PyMem_Free(info);
+}
+
+static PyMethodDef array_methods[] = {
+    {"at", (PyCFunction)(void(*)(void))array_at, METH_FASTCALL, "Element at an index (an int per dimension)."},
+    {"set", (PyCFunction)(void(*)(void))array_set, METH_FASTCALL, "Set the element at an index."},
+    {"fill", (PyCFunction)(void(*)(void))array_fill, METH_FASTCALL, "Set every element to a value."},
+    {"sum", (PyCFunction)(void(*)(void))array_sum, METH_FASTCALL, "Sum of all elements."},
+    {"_adopt", (PyCFunction)(void(*)(void))array_adopt, METH_FASTCALL, "Take over the array struct at an address."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef array_getset[] = {
+    {"_address", (getter)array_address, NULL, "Address of the array struct, for ctypes.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyMappingMethods array_as_mapping = {
+    NULL,
+    (binaryfunc)array_subscript,
+    (objobjargproc)array_ass_subscript
+};
+
+static PyBufferProcs array_as_buffer = {
+    (getbufferproc)array_getbuffer,
+    (releasebufferproc)array_releasebuffer
+};
+
+static PyTypeObject ArrayType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_zumpy.array",
+    .tp_basicsize = sizeof(ArrayObject),
+    .tp_dealloc = (destructor)array_dealloc,
+    .tp_as_mapping = &array_as_mapping,
+    .tp_as_buffer = &array_as_buffer,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_doc = "Native storage for zumpy.array.",
+    .tp_methods = array_methods,
+    .tp_getset = array_getset,
+    .tp_new = array_new,
+};
+
+static struct PyModuleDef zumpy_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "_zumpy",
+    .m_doc = "Native binding for zumpy.",
+    .m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit__zumpy(void)
+{
+    if (PyType_Ready(&ArrayType) < 0)
+        return NULL;
+
+    PyObject* module = PyModule_Create(&zumpy_module);
+    if (module == NULL)
+        return NULL;
+
+    Py_INCREF(&ArrayType);
+    if (PyModule_AddObject(module, "array", (PyObject*)&ArrayType) < 0)
+    {
+        Py_DECREF(&ArrayType);
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+}
@@ -1,19 +1,47 @@
 # python binding for libZumpy.so
 from ctypes import *
 import faulthandler
+import os
+import concurrent.futures
+import itertools
+import contextlib
+import builtins
+import importlib.machinery
+import importlib.util
 
 # load library
 _libZumpy = CDLL('./ext/libZumpy.so')
 
+# optional native binding (ext/_zumpy.so, built with -DZUMPY_PYTHON_EXTENSION=ON). It links against the library
+# loaded above and gives array native element access, fill, sum and the buffer protocol; without it (or with
+# ZUMPY_NO_EXTENSION set) everything goes through ctypes.
+def _load_extension():
+    if os.environ.get('ZUMPY_NO_EXTENSION'):
+        return None
+    for suffix in importlib.machinery.EXTENSION_SUFFIXES:
+        path = os.path.join('./ext', '_zumpy' + suffix)
+        if os.path.exists(path):
+            spec = importlib.util.spec_from_file_location('_zumpy', path)
+            module = importlib.util.module_from_spec(spec)
+            spec.loader.exec_module(module)
+            return module
+    return None
+
+_zumpy = _load_extension()
+
 # wrapper class
 class array_wrapper(Structure):
     _fields_ = [
         ("data", c_void_p),
+        ("buffer", c_void_p),
         ("arr_shape", POINTER(c_size_t)),
         ("shape_size", c_size_t),
         ("type_size", c_size_t),
         ("total_size", c_size_t),
-        ("type", c_uint)
+        ("capacity", c_size_t),
+        ("type", c_uint),
+        ("zone_map", c_void_p),
+        ("packed", c_void_p)
     ]
 
 # function prototypes
@@ -39,14 +67,243 @@ _libZumpy.arr_slice.argtypes = [POINTER(array_wrapper), POINTER(POINTER(c_size_t
 _libZumpy.arr_slice.restype = None
 
 _libZumpy.arr_print.argtypes = [POINTER(array_wrapper)]
-_libZumpy.arr_slice.restype = None
+_libZumpy.arr_print.restype = None
 
 _libZumpy.arr_filter.argtypes = [POINTER(array_wrapper), CFUNCTYPE(c_bool, c_void_p), POINTER(c_size_t), c_size_t, c_uint, POINTER(array_wrapper)]
 _libZumpy.arr_filter.restype = None
 
+_libZumpy.arr_filter_range.argtypes = [POINTER(array_wrapper), c_double, c_double, POINTER(c_size_t), c_size_t, c_uint, POINTER(array_wrapper)]
+_libZumpy.arr_filter_range.restype = None
+
+_libZumpy.arr_filter_block.argtypes = [POINTER(array_wrapper), CFUNCTYPE(None, c_void_p, c_size_t, POINTER(c_bool)), POINTER(c_size_t), c_size_t, c_uint, POINTER(array_wrapper)]
+_libZumpy.arr_filter_block.restype = None
+
+class aggregates_wrapper(Structure):
+    _fields_ = [
+        ("sum", c_double),
+        ("min", c_double),
+        ("max", c_double),
+        ("count", c_size_t)
+    ]
+
+_libZumpy.arr_aggregates_get.argtypes = [POINTER(array_wrapper), POINTER(aggregates_wrapper)]
+_libZumpy.arr_aggregates_get.restype = None
+
+_libZumpy.arr_aggregate_cache.argtypes = [POINTER(array_wrapper), c_bool]
+_libZumpy.arr_aggregate_cache.restype = None
+
+_libZumpy.arr_aggregate_cached.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_aggregate_cached.restype = c_bool
+
+_libZumpy.arr_histogram_fixed.argtypes = [POINTER(array_wrapper), c_double, c_double, c_size_t, POINTER(c_uint64)]
+_libZumpy.arr_histogram_fixed.restype = None
+
+_libZumpy.arr_histogram.argtypes = [POINTER(array_wrapper), POINTER(c_double), c_size_t, POINTER(c_uint64)]
+_libZumpy.arr_histogram.restype = None
+
+_libZumpy.arr_quantiles.argtypes = [POINTER(array_wrapper), POINTER(c_double), c_size_t, c_uint, POINTER(c_double)]
+_libZumpy.arr_quantiles.restype = None
+
+_libZumpy.arr_sketch_new.argtypes = [c_size_t]
+_libZumpy.arr_sketch_new.restype = c_void_p
+
+_libZumpy.arr_sketch_free.argtypes = [c_void_p]
+_libZumpy.arr_sketch_free.restype = None
+
+_libZumpy.arr_sketch_add.argtypes = [c_void_p, c_double]
+_libZumpy.arr_sketch_add.restype = None
+
+_libZumpy.arr_sketch_add_array.argtypes = [c_void_p, POINTER(array_wrapper)]
+_libZumpy.arr_sketch_add_array.restype = None
+
+_libZumpy.arr_sketch_merge.argtypes = [c_void_p, c_void_p]
+_libZumpy.arr_sketch_merge.restype = None
+
+_libZumpy.arr_sketch_count.argtypes = [c_void_p]
+_libZumpy.arr_sketch_count.restype = c_uint64
+
+_libZumpy.arr_sketch_quantiles.argtypes = [c_void_p, POINTER(c_double), c_size_t, POINTER(c_double)]
+_libZumpy.arr_sketch_quantiles.restype = None
+
+_libZumpy.arr_zone_map_build.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_zone_map_build.restype = None
+
+_libZumpy.arr_save.argtypes = [POINTER(array_wrapper), c_char_p]
+_libZumpy.arr_save.restype = c_bool
+
+_libZumpy.arr_load.argtypes = [POINTER(array_wrapper), c_char_p]
+_libZumpy.arr_load.restype = c_bool
+
+_libZumpy.arr_compress.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_compress.restype = None
+
+_libZumpy.arr_decompress.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_decompress.restype = None
+
+_libZumpy.arr_storage_bytes.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_storage_bytes.restype = c_size_t
+
+_libZumpy.arr_storage_policy.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_storage_policy.restype = c_uint
+
+_libZumpy.arr_set_alloc_policy.argtypes = [c_uint, c_size_t]
+_libZumpy.arr_set_alloc_policy.restype = None
+
+# allocation policies, in the order of the C alloc_policy enum
+_alloc_policies = ['heap', 'huge_pages', 'hugetlb']
+
+_libZumpy.arr_reserve.argtypes = [POINTER(array_wrapper), c_size_t]
+_libZumpy.arr_reserve.restype = None
+
+_libZumpy.arr_shrink_to_fit.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_shrink_to_fit.restype = None
+
+_libZumpy.arr_append_rows.argtypes = [POINTER(array_wrapper), POINTER(array_wrapper)]
+_libZumpy.arr_append_rows.restype = None
+
+_libZumpy.arr_concatenate.argtypes = [POINTER(array_wrapper), POINTER(array_wrapper), POINTER(array_wrapper)]
+_libZumpy.arr_concatenate.restype = None
+
+_libZumpy.arr_share.argtypes = [POINTER(array_wrapper), POINTER(array_wrapper)]
+_libZumpy.arr_share.restype = None
+
+_libZumpy.arr_view_rows.argtypes = [POINTER(array_wrapper), c_size_t, c_size_t, POINTER(array_wrapper)]
+_libZumpy.arr_view_rows.restype = None
+
+_libZumpy.arr_is_shared.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_is_shared.restype = c_bool
+
+_libZumpy.arr_get_many.argtypes = [POINTER(array_wrapper), POINTER(c_size_t), c_size_t, c_void_p]
+_libZumpy.arr_get_many.restype = c_size_t
+
+_libZumpy.arr_set_many.argtypes = [POINTER(array_wrapper), POINTER(c_size_t), c_size_t, c_void_p]
+_libZumpy.arr_set_many.restype = c_size_t
+
+_libZumpy.arr_get_flat.argtypes = [POINTER(array_wrapper), POINTER(c_size_t), c_size_t, c_void_p]
+_libZumpy.arr_get_flat.restype = c_size_t
+
+_libZumpy.arr_set_flat.argtypes = [POINTER(array_wrapper), POINTER(c_size_t), c_size_t, c_void_p]
+_libZumpy.arr_set_flat.restype = c_size_t
+
+# ctypes element type of each dtype
+_c_types = {'int32': c_int32, 'float': c_float}
+
+# number of elements iteration reads per call into the library
+_ITER_BATCH = 4096
+
+_libZumpy.arr_create_shared.argtypes = [POINTER(array_wrapper), c_char_p, POINTER(c_size_t), c_size_t, c_uint]
+_libZumpy.arr_create_shared.restype = c_bool
+
+_libZumpy.arr_attach_shared.argtypes = [POINTER(array_wrapper), c_char_p, c_bool]
+_libZumpy.arr_attach_shared.restype = c_bool
+
+_libZumpy.arr_unlink_shared.argtypes = [c_char_p]
+_libZumpy.arr_unlink_shared.restype = c_bool
+
+_libZumpy.arr_shared_lock.argtypes = [POINTER(array_wrapper), c_bool]
+_libZumpy.arr_shared_lock.restype = c_bool
+
+_libZumpy.arr_shared_unlock.argtypes = [POINTER(array_wrapper), c_bool]
+_libZumpy.arr_shared_unlock.restype = None
+
+_libZumpy.arr_is_shared_memory.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_is_shared_memory.restype = c_bool
+
+_libZumpy.arr_zeros.argtypes = [POINTER(array_wrapper), POINTER(c_size_t), c_size_t, c_uint]
+_libZumpy.arr_zeros.restype = None
+
+_libZumpy.arr_arange.argtypes = [POINTER(array_wrapper), c_double, c_double, c_double, c_uint]
+_libZumpy.arr_arange.restype = None
+
+_libZumpy.arr_linspace.argtypes = [POINTER(array_wrapper), c_double, c_double, c_size_t, c_uint]
+_libZumpy.arr_linspace.restype = None
+
+# random number generator state (xoshiro256++)
+class rng_wrapper(Structure):
+    _fields_ = [
+        ("s", c_uint64 * 4)
+    ]
+
+_libZumpy.arr_rng_stream.argtypes = [POINTER(rng_wrapper), c_uint64, c_size_t]
+_libZumpy.arr_rng_stream.restype = None
+
+_libZumpy.arr_random_int.argtypes = [POINTER(array_wrapper), POINTER(rng_wrapper), c_int32, c_int32]
+_libZumpy.arr_random_int.restype = None
+
+_libZumpy.arr_random_uniform.argtypes = [POINTER(array_wrapper), POINTER(rng_wrapper), c_double, c_double]
+_libZumpy.arr_random_uniform.restype = None
+
+_libZumpy.arr_random_normal.argtypes = [POINTER(array_wrapper), POINTER(rng_wrapper), c_double, c_double]
+_libZumpy.arr_random_normal.restype = None
+
+_libZumpy.arr_random_bernoulli.argtypes = [POINTER(array_wrapper), POINTER(rng_wrapper), c_double]
+_libZumpy.arr_random_bernoulli.restype = None
+
+_filter_func_type = CFUNCTYPE(c_bool, c_void_p)
+_block_filter_func_type = CFUNCTYPE(None, c_void_p, c_size_t, POINTER(c_bool))
+_future_callback_type = CFUNCTYPE(None, c_void_p, c_void_p)
+
+_libZumpy.arr_pool_init.argtypes = [c_size_t]
+_libZumpy.arr_pool_init.restype = c_bool
+
+_libZumpy.arr_pool_size.argtypes = []
+_libZumpy.arr_pool_size.restype = c_size_t
+
+_libZumpy.arr_sum_async.argtypes = [POINTER(array_wrapper)]
+_libZumpy.arr_sum_async.restype = c_void_p
+
+_libZumpy.arr_filter_async.argtypes = [POINTER(array_wrapper), _filter_func_type, POINTER(c_size_t), c_size_t, c_uint, POINTER(array_wrapper)]
+_libZumpy.arr_filter_async.restype = c_void_p
+
+_libZumpy.arr_filter_range_async.argtypes = [POINTER(array_wrapper), c_double, c_double, POINTER(c_size_t), c_size_t, c_uint, POINTER(array_wrapper)]
+_libZumpy.arr_filter_range_async.restype = c_void_p
+
+_libZumpy.arr_filter_block_async.argtypes = [POINTER(array_wrapper), _block_filter_func_type, POINTER(c_size_t), c_size_t, c_uint, POINTER(array_wrapper)]
+_libZumpy.arr_filter_block_async.restype = c_void_p
+
+_libZumpy.arr_future_on_complete.argtypes = [c_void_p, _future_callback_type, c_void_p]
+_libZumpy.arr_future_on_complete.restype = None
+
+_libZumpy.arr_future_result.argtypes = [c_void_p]
+_libZumpy.arr_future_result.restype = c_float
+
+_libZumpy.arr_future_free.argtypes = [c_void_p]
+_libZumpy.arr_future_free.restype = None
+
+# operations running on the library's worker threads, by id. Each entry keeps everything the C side points to
+# (the array, ctypes arguments, dest) alive until the operation finishes.
+_pending = {}
+_pending_ids = itertools.count(1)
+
+# called by the library when an operation finishes, on the worker thread that ran it (ctypes takes the GIL)
+def _on_future_complete(c_future, user_data):
+    py_future, make_result, keep_alive = _pending.pop(user_data)
+    value = _libZumpy.arr_future_result(c_future)
+    _libZumpy.arr_future_free(c_future)
+    try:
+        py_future.set_result(make_result(value))
+    except Exception as e:
+        py_future.set_exception(e)
+
+# a single callback object for the life of the module so it can never be collected while the library holds it
+_p_on_future_complete = _future_callback_type(_on_future_complete)
+
+# internal helper to turn an operation handle from the library into a concurrent.futures.Future
+def _submit(c_future, make_result, keep_alive):
+    py_future = concurrent.futures.Future()
+    if not c_future:
+        py_future.set_exception(RuntimeError('zumpy: could not queue operation'))
+        return py_future
+    py_future.set_running_or_notify_cancel()
+    key = next(_pending_ids)
+    _pending[key] = (py_future, make_result, keep_alive)
+    _libZumpy.arr_future_on_complete(c_future, _p_on_future_complete, key)
+    return py_future
+
 ## Array Module
 # A simple array class that handles arbitrary dimensions for integer and float types.
-class array():
+# With the native binding loaded the C struct lives in the object itself (see the end of the class).
+class array(_zumpy.array if _zumpy is not None else object):
     def __get_type_enum(self, dtype):
         if dtype == 'int32':
             return 0
@@ -103,9 +360,10 @@ class array():
 
     ## Destructor to deallocate memory from the array. This probably won't ever need to be manually called by the user.
     # This should handle the memory management behind the scenes interacting with the C code to avoid memory leaks.
+    # The C storage is reference counted, so freeing an array that shares it with a view only drops a reference.
     def __del__(self):
-        arr_ptr = pointer(self.arr)
-        _libZumpy.arr_free(arr_ptr)
+        if self.arr is not None:
+            _libZumpy.arr_free(byref(self.arr))
 
     ## Override print() call to print the contents of an array.
     # Calls custom print() function implemented in C to output contents in the console.
@@ -129,7 +387,7 @@ class array():
     # print(myarray)
     # @endcode
     def __repr__(self):
-        self.__str__()
+        return self.__str__()
 
     ## Access an element by index.
     # @param idx A list (or integer for 1D) specifying the index. E.g [1, 2] will access the element at the second row and third column (zero-indexed).
@@ -148,6 +406,7 @@ class array():
             temp_idx.append(idx)
         else:
             temp_idx = idx
+        self.__check_index(temp_idx)
 
         idx_arr = (c_size_t * len(temp_idx))(*temp_idx)
         # dereference different types
@@ -169,8 +428,20 @@ class array():
     # myarray[3]     # access the fourth element in a 1D array
     # myarray[1,2]   # access the (1,2)th element in a 2D array
     # myarray[2,1,1] # so on and so forth...I think you get the idea
+    #
+    # # many elements at once (one call into the library), returned as a list
+    # myarray[[(0,1), (2,1)]]    # a list of indices
+    # myarray[[0,1,2], [1,1,1]]  # one list per dimension; an int is used for every element, e.g myarray[[0,1,2], 1]
+    # myarray[[0,5,7]]           # a list of positions in a 1D array
     # @endcode
     def __getitem__(self, idx):
+        if isinstance(idx, slice):
+            start, stop, step = idx.indices(self.shape[0])
+            if step == 1:
+                return self.rows(start, max(start, stop))
+        batch = self.__batch_indices(idx)
+        if batch is not None:
+            return self.get_many(batch)
         temp_idx = []
         if isinstance(idx, int):
             temp_idx.append(idx)
@@ -195,14 +466,23 @@ class array():
             temp_idx.append(idx)
         else:
             temp_idx = idx
+        self.__check_index(temp_idx)
 
-        idx_arr = (c_size_t * len(idx))(*idx)
+        idx_arr = (c_size_t * len(temp_idx))(*temp_idx)
 
         if self.dtype == 'int32':
             _libZumpy.arr_set(byref(self.arr), idx_arr, byref(c_int32(value)))
         elif self.dtype == 'float':
             _libZumpy.arr_set(byref(self.arr), idx_arr, byref(c_float(value)))
 
+    # internal method to raise IndexError unless idx has one in-range entry per dimension
+    def __check_index(self, idx):
+        if len(idx) != self.arr.shape_size:
+            raise IndexError('zumpy: expected one int per dimension')
+        for d in range(len(idx)):
+            if idx[d] < 0 or idx[d] >= self.arr.arr_shape[d]:
+                raise IndexError('zumpy: index out of range')
+
     ## Set an element by index.
     # This is a wrapper around the zumpy.array.set(self, idx, value) method to use convenient square bracket syntax.
     # @param idx A list specifying the index. E.g [1, 2] will access the element at the second row and third column (zero-indexed).
@@ -215,6 +495,11 @@ class array():
     # myarray[2,1,1] = 10 # 3D array
     # @endcode
     def __setitem__(self, idx, value):
+        batch = self.__batch_indices(idx)
+        if batch is not None:
+            values = value if isinstance(value, (list, tuple, range)) else [value] * len(batch)
+            self.set_many(batch, values)
+            return
         temp_idx = []
         if isinstance(idx, int):
             temp_idx.append(idx)
@@ -222,6 +507,102 @@ class array():
             temp_idx = idx
         self.set(temp_idx, value)
 
+    # internal method to turn the batch forms of [] indexing into a list of indices, or None for a single element
+    def __batch_indices(self, idx):
+        rank = self.arr.shape_size
+        sequence = (list, tuple, range)
+        if isinstance(idx, tuple) and any(isinstance(i, sequence) for i in idx):
+            # one list per dimension, ints broadcast to every element
+            n = max(len(i) for i in idx if isinstance(i, sequence))
+            columns = [i if isinstance(i, sequence) else [i] * n for i in idx]
+            return list(zip(*columns))
+        if isinstance(idx, (list, range)) and len(idx) > 0:
+            if isinstance(idx[0], sequence):
+                return idx
+            # a list of ints is a single index, except a list of positions in a 1D array
+            if rank == 1 and len(idx) > 1:
+                return [(i,) for i in idx]
+        return None
+
+    ## Read many elements with one call into the library.
+    # Much faster than reading the elements one by one from a loop since the cost of calling into C is paid once.
+    # @param indices A list of indices, each a list/tuple with one entry per dimension (or an int for 1D arrays).
+    # @return A list of the values, in the same order as indices. Raises IndexError if any index is out of range.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([3,2], 'int32')
+    # arr.fill(10)
+    # arr.get_many([(0,1), (2,0)]) # [10, 10]
+    # @endcode
+    def get_many(self, indices):
+        flat = self.__flatten_indices(indices)
+        out = (_c_types[self.dtype] * len(indices))()
+        if _libZumpy.arr_get_many(byref(self.arr), (c_size_t * len(flat))(*flat), len(indices), out) != 0:
+            raise IndexError('zumpy: index out of range')
+        return list(out)
+
+    ## Write many elements with one call into the library.
+    # @param indices A list of indices as in get_many().
+    # @param values A list of values, one per index. If any index is out of range nothing is written and IndexError is raised.
+    def set_many(self, indices, values):
+        flat = self.__flatten_indices(indices)
+        vals = (_c_types[self.dtype] * len(indices))(*values)
+        if _libZumpy.arr_set_many(byref(self.arr), (c_size_t * len(flat))(*flat), len(indices), vals) != 0:
+            raise IndexError('zumpy: index out of range')
+
+    # internal method to lay a list of indices out one after another for the library. Every index must have one
+    # entry per dimension and negative entries are out of range, so both raise IndexError here.
+    def __flatten_indices(self, indices):
+        rank = self.arr.shape_size
+        flat = []
+        for idx in indices:
+            idx = [idx] if isinstance(idx, int) else list(idx)
+            if len(idx) != rank or any(i < 0 for i in idx):
+                raise IndexError('zumpy: index out of range')
+            flat.extend(idx)
+        return flat
+
+    ## Read many elements by flat (row-major) position, e.g position 3 of a 3x2 array is index [1, 1].
+    # @param offsets A list (or range) of positions.
+    # @return A list of the values.
+    def get_flat(self, offsets):
+        if any(i < 0 for i in offsets):
+            raise IndexError('zumpy: index out of range')
+        out = (_c_types[self.dtype] * len(offsets))()
+        if _libZumpy.arr_get_flat(byref(self.arr), (c_size_t * len(offsets))(*offsets), len(offsets), out) != 0:
+            raise IndexError('zumpy: index out of range')
+        return list(out)
+
+    ## Write many elements by flat (row-major) position.
+    # @param offsets A list (or range) of positions.
+    # @param values A list of values, one per position.
+    def set_flat(self, offsets, values):
+        if any(i < 0 for i in offsets):
+            raise IndexError('zumpy: index out of range')
+        vals = (_c_types[self.dtype] * len(offsets))(*values)
+        if _libZumpy.arr_set_flat(byref(self.arr), (c_size_t * len(offsets))(*offsets), len(offsets), vals) != 0:
+            raise IndexError('zumpy: index out of range')
+
+    ## Iterate over every element in row-major order. Elements are read from the library a batch at a time.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([3,2], 'int32')
+    # arr.fill(10)
+    # total = sum(x for x in arr) # 60
+    # @endcode
+    def __iter__(self):
+        total = self.arr.total_size
+        for start in range(0, total, _ITER_BATCH):
+            yield from self.get_flat(range(start, min(start + _ITER_BATCH, total)))
+
     ## Fill all cells with a specified value
     # This will set every index of the array to the same value.
     # @param value Value to set all indices to
@@ -243,6 +624,44 @@ class array():
             val_ptr = cast(byref(c_float(value)), c_void_p)
         _libZumpy.arr_fill(byref(self.arr), val_ptr)
 
+    ## Fill with uniformly distributed random integers in [low, high] (both included).
+    # The values are generated in C, which is much faster than setting elements one at a time from Python.
+    # @param low Smallest value.
+    # @param high Largest value.
+    # @param gen A zumpy.rng to draw from. By default the module's generator, which zumpy.seed() reseeds.
+    #
+    # Example:
+    #
+    # @code
+    # import zumpy
+    # from zumpy import array
+    #
+    # zumpy.seed(400)
+    # myarray = array([3,2], 'int32')
+    # myarray.random_int(0, 50)
+    # @endcode
+    def random_int(self, low, high, gen = None):
+        gen = gen if gen is not None else _default_rng
+        _libZumpy.arr_random_int(byref(self.arr), byref(gen.state), c_int32(low), c_int32(high))
+
+    ## Fill with uniformly distributed random values in [low, high). 'int32' arrays get them rounded down.
+    # @param gen A zumpy.rng to draw from. By default the module's generator.
+    def random_uniform(self, low = 0.0, high = 1.0, gen = None):
+        gen = gen if gen is not None else _default_rng
+        _libZumpy.arr_random_uniform(byref(self.arr), byref(gen.state), c_double(low), c_double(high))
+
+    ## Fill with normally distributed random values. 'int32' arrays get them rounded to the nearest integer.
+    # @param gen A zumpy.rng to draw from. By default the module's generator.
+    def random_normal(self, mean = 0.0, stddev = 1.0, gen = None):
+        gen = gen if gen is not None else _default_rng
+        _libZumpy.arr_random_normal(byref(self.arr), byref(gen.state), c_double(mean), c_double(stddev))
+
+    ## Fill with 1 with probability p and 0 otherwise.
+    # @param gen A zumpy.rng to draw from. By default the module's generator.
+    def random_bernoulli(self, p, gen = None):
+        gen = gen if gen is not None else _default_rng
+        _libZumpy.arr_random_bernoulli(byref(self.arr), byref(gen.state), c_double(p))
+
     ## Slice an array to extract subsets
     # @param slice_indices A list of lists containing the indices to slice. First dimension corresponds to the array dimension and second dimension corresponds to the indices to pull from that dimension. See example below.
     #
@@ -351,10 +770,7 @@ class array():
         p_slice_dims = (c_size_t * len(slice_dims))(*slice_dims)
         _libZumpy.arr_slice(byref(self.arr), pp_slice_indices, p_slice_dims, c_size_t(slice_idx_len), byref(ref_arr))
 
-        ret_arr = array(slice_dims, self.dtype)
-        ret_arr.arr = ref_arr
-
-        return ret_arr
+        return _wrap_array(ref_arr, self.dtype)
 
     ## Filter an array based on user-defined condition.
     # @note You will need to use ctypes in the filter function to convert values so the underlying C code knows what to do.
@@ -442,21 +858,339 @@ class array():
 
         _libZumpy.arr_filter(byref(self.arr), p_filter_func, p_secondary_indices, c_size_t(len(secondary_indices)), c_uint(ftype), byref(dest_arr))
 
-        # grab contents from struct pointer and convert array
-        # shape into Python list
-        _shape_size = pointer(dest_arr).contents.shape_size
-        _arr_shape = pointer(dest_arr).contents.arr_shape
-        _total_size = pointer(dest_arr).contents.total_size
-        _arr_shape_list = []
-        for i in range(_shape_size):
-            _arr_shape_list.append(_arr_shape[i])
-        ret_arr = array(_arr_shape_list, self.dtype)
-        ret_arr.arr = dest_arr
-
         # return NULL if filter returned no results
-        if _total_size == 0:
+        if dest_arr.total_size == 0:
+            _libZumpy.arr_free(byref(dest_arr))
             return None
-        return ret_arr
+
+        # the C library already allocated the result; wrap it without allocating another array
+        return _wrap_array(dest_arr, self.dtype)
+
+    ## Filter an array's rows by an inclusive value range.
+    # This is the native counterpart to filter() for "low <= value <= high" conditions. It runs entirely in C and uses the
+    # array's zone map (min/max per block of rows, built on first use) to skip blocks that can't match, so selective
+    # queries on sorted columns only cost as much as the number of rows they return.
+    # @param low Lower bound (inclusive).
+    # @param high Upper bound (inclusive).
+    # @param secondary_indices The columns to check, same as in filter(). An empty list checks all columns.
+    # @param filter_type A string specifying 'ANY' or 'ALL', same as in filter().
+    # @return The filtered array, or None if no rows matched.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([1000, 2], 'int32')
+    # for i in range(arr.shape[0]):
+    #     arr[i,0] = i      # sorted "timestamp" column
+    #     arr[i,1] = i % 7
+    #
+    # print(arr.filter_range(100, 104, [0], 'ANY'))
+    # @endcode
+    #
+    # Output:
+    #
+    # @code
+    # 100 2
+    # 101 3
+    # 102 4
+    # 103 5
+    # 104 6
+    # @endcode
+    def filter_range(self, low, high, secondary_indices, filter_type):
+        p_secondary_indices = None
+        if len(secondary_indices) != 0:
+            p_secondary_indices = (c_size_t * len(secondary_indices))(*secondary_indices)
+
+        ftype = None
+        if (filter_type == 'ANY'):
+            ftype = 0
+        elif (filter_type == 'ALL'):
+            ftype = 1
+
+        dest_arr = array_wrapper()
+
+        _libZumpy.arr_filter_range(byref(self.arr), c_double(low), c_double(high), p_secondary_indices, c_size_t(len(secondary_indices)), c_uint(ftype), byref(dest_arr))
+
+        if dest_arr.total_size == 0:
+            _libZumpy.arr_free(byref(dest_arr))
+            return None
+
+        return _wrap_array(dest_arr, self.dtype)
+
+    ## Filter rows with a function that is called once per block of rows instead of once per element.
+    # This is the fast way to filter with a custom condition from Python: the function sees thousands of elements per
+    # call through memoryviews, so the cost of calling into Python is paid once per block.
+    # @param filter_func A function taking (values, nrows, mask). values is a flat memoryview of the block's
+    # nrows rows (row-major, read only) and mask a memoryview of bools of the same length, all False; set mask[i]
+    # to True for every element that matches.
+    # @param secondary_indices The columns to check, same as in filter(). An empty list checks all columns.
+    # @param filter_type A string specifying 'ANY' or 'ALL', same as in filter().
+    # @return The filtered array, or None if no rows matched.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # def myfilter(values, nrows, mask):
+    #     for i, v in enumerate(values):
+    #         mask[i] = v > 10
+    #
+    # arr = array([1000, 2], 'int32')
+    # arr.random_int(0, 50)
+    # filtered = arr.filter_block(myfilter, [], 'ALL')
+    # @endcode
+    def filter_block(self, filter_func, secondary_indices, filter_type):
+        p_filter_func = self.__block_filter_func(filter_func)
+
+        p_secondary_indices = None
+        if len(secondary_indices) != 0:
+            p_secondary_indices = (c_size_t * len(secondary_indices))(*secondary_indices)
+
+        ftype = 0 if filter_type == 'ANY' else 1
+
+        dest_arr = array_wrapper()
+
+        _libZumpy.arr_filter_block(byref(self.arr), p_filter_func, p_secondary_indices, c_size_t(len(secondary_indices)), c_uint(ftype), byref(dest_arr))
+
+        if dest_arr.total_size == 0:
+            _libZumpy.arr_free(byref(dest_arr))
+            return None
+
+        return _wrap_array(dest_arr, self.dtype)
+
+    # internal helper to wrap a filter_block() function into the C callback, which hands it memoryviews
+    def __block_filter_func(self, filter_func):
+        c_type = _c_types[self.dtype]
+        row_len = self.arr.total_size // self.arr.arr_shape[0] if self.arr.arr_shape[0] > 0 else 0
+
+        def block_func(rows, nrows, mask):
+            count = nrows * row_len
+            values = memoryview((c_type * count).from_address(rows)).cast('B').cast(c_type._type_)
+            mask_view = memoryview((c_bool * count).from_address(addressof(mask.contents))).cast('B').cast('?')
+            filter_func(values.toreadonly(), nrows, mask_view)
+
+        return _block_filter_func_type(block_func)
+
+    # internal helper to submit one of the asynchronous filters; c_call queues it given (secondary indices, ftype, dest)
+    def __filter_async(self, c_call, secondary_indices, filter_type, keep_alive):
+        p_secondary_indices = None
+        if len(secondary_indices) != 0:
+            p_secondary_indices = (c_size_t * len(secondary_indices))(*secondary_indices)
+        ftype = 0 if filter_type == 'ANY' else 1
+        dest_arr = array_wrapper()
+
+        def make_result(value):
+            if dest_arr.total_size == 0:
+                _libZumpy.arr_free(byref(dest_arr))
+                return None
+            return _wrap_array(dest_arr, self.dtype)
+
+        c_future = c_call(p_secondary_indices, c_size_t(len(secondary_indices)), c_uint(ftype), byref(dest_arr))
+        return _submit(c_future, make_result, (self, p_secondary_indices, dest_arr, keep_alive))
+
+    ## Asynchronous filter(): the filtering runs on the library's worker threads and this returns right away.
+    # The array must not be modified until the returned future is done.
+    # @return A concurrent.futures.Future whose result is the filtered array (or None). In asyncio code use
+    # "await asyncio.wrap_future(future)".
+    def filter_async(self, filter_func, secondary_indices, filter_type):
+        p_filter_func = _filter_func_type(filter_func)
+        return self.__filter_async(lambda *args: _libZumpy.arr_filter_async(byref(self.arr), p_filter_func, *args),
+                                   secondary_indices, filter_type, p_filter_func)
+
+    ## Asynchronous filter_range(). Since it runs entirely in C it doesn't hold the GIL, so other Python threads
+    # (or the asyncio event loop) keep running while it works. See filter_async().
+    #
+    # Example:
+    #
+    # @code
+    # import asyncio
+    # from zumpy import array
+    #
+    # async def main():
+    #     arr = array([1000000, 2], 'int32')
+    #     arr.random_int(0, 100)
+    #     filtered = await asyncio.wrap_future(arr.filter_range_async(10, 20, [0], 'ANY'))
+    #     print(filtered.shape)
+    #
+    # asyncio.run(main())
+    # @endcode
+    def filter_range_async(self, low, high, secondary_indices, filter_type):
+        return self.__filter_async(lambda *args: _libZumpy.arr_filter_range_async(byref(self.arr), c_double(low), c_double(high), *args),
+                                   secondary_indices, filter_type, None)
+
+    ## Asynchronous filter_block(). See filter_async().
+    def filter_block_async(self, filter_func, secondary_indices, filter_type):
+        p_filter_func = self.__block_filter_func(filter_func)
+        return self.__filter_async(lambda *args: _libZumpy.arr_filter_block_async(byref(self.arr), p_filter_func, *args),
+                                   secondary_indices, filter_type, p_filter_func)
+
+    ## Save the array to a Zumpy (.zmp) file.
+    # If the array has a zone map (see filter_range()) it is saved with it.
+    # @param path Path of the file to write.
+    # @return True on success.
+    def save(self, path):
+        return _libZumpy.arr_save(byref(self.arr), path.encode())
+
+    ## Load an array from a Zumpy (.zmp) file written by save().
+    # @param path Path of the file to read.
+    # @return True on success.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([3,2], 'int32')
+    # arr.fill(10)
+    # arr.save('myarr.zmp')
+    #
+    # loaded = array()
+    # loaded.load('myarr.zmp')
+    # print(loaded.sum()) # 60.0
+    # @endcode
+    def load(self, path):
+        ref_arr = array_wrapper()
+        if not _libZumpy.arr_load(byref(ref_arr), path.encode()):
+            return False
+
+        if self.arr is not None:
+            _libZumpy.arr_free(byref(self.arr))
+        self.arr = ref_arr
+        self.dtype = 'int32' if ref_arr.type == 0 else 'float'
+        self.shape = [ref_arr.arr_shape[i] for i in range(ref_arr.shape_size)]
+        return True
+
+    ## Compress an 'int32' array in place to save memory.
+    # Each block of 1024 elements is stored with frame-of-reference bit-packing, delta or dictionary encoding,
+    # whichever is smallest. Reading (indexing, sum(), filter(), filter_range(), slice(), print) works directly on the
+    # compressed array; writing decompresses it first, so this is meant for read-mostly arrays.
+    # 'float' arrays, and arrays that wouldn't get any smaller, are left as they are.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([100000], 'int32')
+    # for i in range(arr.shape[0]):
+    #     arr[i] = i % 16
+    #
+    # print(arr.storage_bytes()) # 400000
+    # arr.compress()
+    # print(arr.storage_bytes()) # roughly 50000
+    # print(arr.sum())           # 750000.0
+    # @endcode
+    def compress(self):
+        _libZumpy.arr_compress(byref(self.arr))
+
+    ## Decompress an array compressed by compress() back to plain storage.
+    def decompress(self):
+        _libZumpy.arr_decompress(byref(self.arr))
+
+    ## Number of bytes used to store the elements of the array, compressed or not.
+    def storage_bytes(self):
+        return _libZumpy.arr_storage_bytes(byref(self.arr))
+
+    ## The allocation policy this array's storage got (see set_alloc_policy()): 'heap', 'huge_pages' or 'hugetlb'.
+    def storage_policy(self):
+        return _alloc_policies[_libZumpy.arr_storage_policy(byref(self.arr))]
+
+    ## Append the rows of another array to this one, in place.
+    # Capacity grows geometrically, so appending a stream of batches costs amortized O(1) per row instead of
+    # building a new array every time.
+    # @param other An array with the same dtype and the same shape apart from the first dimension.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([0, 2], 'int32') # start with no rows
+    # batch = array([3, 2], 'int32')
+    # for i in range(1000):
+    #     batch.fill(i)
+    #     arr.append_rows(batch)
+    #
+    # print(arr.shape) # [3000, 2]
+    # @endcode
+    def append_rows(self, other):
+        _libZumpy.arr_append_rows(byref(self.arr), byref(other.arr))
+        self.shape = [self.arr.arr_shape[i] for i in range(self.arr.shape_size)]
+
+    ## Concatenate this array and another along the first dimension into a new array.
+    # @param other An array with the same dtype and the same shape apart from the first dimension.
+    # @return The concatenated array.
+    def concatenate(self, other):
+        ref_arr = array_wrapper()
+        _libZumpy.arr_concatenate(byref(self.arr), byref(other.arr), byref(ref_arr))
+        return _wrap_array(ref_arr, self.dtype)
+
+    ## Make room for at least the given number of rows so later append_rows() calls don't reallocate.
+    # @param rows Number of rows to make room for.
+    def reserve(self, rows):
+        _libZumpy.arr_reserve(byref(self.arr), rows)
+
+    ## Release spare capacity left by reserve() or append_rows().
+    def shrink_to_fit(self):
+        _libZumpy.arr_shrink_to_fit(byref(self.arr))
+
+    ## Create a view of the whole array that shares its storage instead of copying it.
+    # Writing to either array gives it a copy of its own first (copy-on-write), so the other never sees the change.
+    # @return The view.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([3,3], 'int32')
+    # arr.fill(10)
+    #
+    # view = arr.view()    # no copy
+    # view.fill(20)        # view gets its own copy first
+    # print(arr.sum(), view.sum()) # 90.0 180.0
+    # @endcode
+    def view(self):
+        ref_arr = array_wrapper()
+        _libZumpy.arr_share(byref(self.arr), byref(ref_arr))
+        return _wrap_array(ref_arr, self.dtype)
+
+    ## Create a view of rows [start, stop) that shares storage with this array. Also available as arr[start:stop].
+    # @param start First row.
+    # @param stop One past the last row.
+    # @return The view.
+    def rows(self, start, stop):
+        ref_arr = array_wrapper()
+        _libZumpy.arr_view_rows(byref(self.arr), start, stop, byref(ref_arr))
+        return _wrap_array(ref_arr, self.dtype)
+
+    ## Check whether this array currently shares its storage with another array.
+    def is_shared(self):
+        return _libZumpy.arr_is_shared(byref(self.arr))
+
+    ## Check whether this array's elements live in a shared memory segment (see create_shared()).
+    def is_shared_memory(self):
+        return _libZumpy.arr_is_shared_memory(byref(self.arr))
+
+    ## Hold the lock of this array's shared memory segment for the duration of a with block.
+    # The lock is shared by every process attached to the segment. Writers should hold it exclusively while writing.
+    # @param exclusive True for writing, False for reading.
+    #
+    # @code
+    # with arr.shared_lock():
+    #     arr[0,0] = 5
+    # @endcode
+    @contextlib.contextmanager
+    def shared_lock(self, exclusive = True):
+        if not _libZumpy.arr_shared_lock(byref(self.arr), exclusive):
+            raise ValueError('array does not live in shared memory')
+        try:
+            yield self
+        finally:
+            _libZumpy.arr_shared_unlock(byref(self.arr), exclusive)
 
     ## Sum all indices of an array
     # @return A float value representing the sum of all the elements
@@ -499,6 +1233,119 @@ class array():
     def sum(self):
         return _libZumpy.arr_sum(byref(self.arr))
 
+    ## Compute the sum, min, max and number of elements in one pass.
+    # With the aggregate cache on (see aggregate_cache()) only blocks written since the last call are rescanned.
+    # @return A dict with 'sum', 'min', 'max' and 'count'.
+    def aggregates(self):
+        ref_agg = aggregates_wrapper()
+        _libZumpy.arr_aggregates_get(byref(self.arr), byref(ref_agg))
+        return {'sum': ref_agg.sum, 'min': ref_agg.min, 'max': ref_agg.max, 'count': ref_agg.count}
+
+    ## Turn the aggregate cache on or off.
+    # The cache keeps the sum, min and max of every block of rows and writes mark their blocks dirty, so repeated
+    # sum() and aggregates() calls only rescan what changed since the last call.
+    # @param enable True to keep the cache, False to release it.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([1000000, 4], 'float')
+    # arr.random_uniform()
+    # arr.aggregate_cache()
+    # arr.sum()          # full scan, fills the cache
+    # arr[10, 0] = 5.0
+    # arr.sum()          # rescans one block of rows
+    # @endcode
+    def aggregate_cache(self, enable = True):
+        _libZumpy.arr_aggregate_cache(byref(self.arr), enable)
+
+    ## Check whether the aggregate cache is on.
+    def aggregate_cached(self):
+        return _libZumpy.arr_aggregate_cached(byref(self.arr))
+
+    ## Count the elements falling into each bin of a histogram. Elements outside the bins and NaNs aren't counted.
+    # @param bins Either the number of equal-width bins, or a list of increasing bin edges (one more than the
+    # number of bins). Every bin is [left, right) except the last, which also includes its right edge.
+    # @param range (low, high) spanned by equal-width bins. By default the min and max of the array.
+    # @return A tuple (counts, edges) of lists.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([100000], 'float')
+    # arr.random_normal()
+    # counts, edges = arr.histogram(4, (-2, 2))
+    # print(counts)
+    # @endcode
+    def histogram(self, bins = 10, range = None):
+        if isinstance(bins, int):
+            if range is None:
+                agg = self.aggregates()
+                range = (agg['min'], agg['max']) if agg['count'] > 0 else (0.0, 1.0)
+            low, high = float(range[0]), float(range[1])
+            if high <= low:
+                high = low + 1.0
+            counts = (c_uint64 * bins)()
+            _libZumpy.arr_histogram_fixed(byref(self.arr), low, high, bins, counts)
+            edges = [low + (high - low) * i / bins for i in builtins.range(bins)] + [high]
+        else:
+            edges = [float(e) for e in bins]
+            counts = (c_uint64 * (len(edges) - 1))()
+            _libZumpy.arr_histogram(byref(self.arr), (c_double * len(edges))(*edges), len(edges) - 1, counts)
+        return list(counts), edges
+
+    ## Compute quantiles of all elements. NaNs are ignored.
+    # @param q A quantile in [0, 1] (0.5 for the median) or a list of them.
+    # @param exact True for exact values (interpolated like NumPy's default), False for a fast estimate from a
+    # sketch (see sketch) using a few kilobytes instead of a copy of the array.
+    # @return The quantile, or a list of them if q is a list.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # arr = array([1000000], 'float')
+    # arr.random_uniform()
+    # print(arr.quantiles([0.5, 0.99]))
+    # @endcode
+    def quantiles(self, q, exact = True):
+        qs = list(q) if isinstance(q, (list, tuple)) else [q]
+        out = (c_double * len(qs))()
+        _libZumpy.arr_quantiles(byref(self.arr), (c_double * len(qs))(*qs), len(qs), 0 if exact else 1, out)
+        return list(out) if isinstance(q, (list, tuple)) else out[0]
+
+    ## Sum all elements on the library's worker threads; see sum().
+    # The array must not be modified until the returned future is done.
+    # @return A concurrent.futures.Future whose result is the sum. In asyncio code use
+    # "await asyncio.wrap_future(arr.sum_async())".
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array
+    #
+    # a = array([1000, 1000], 'float')
+    # b = array([1000, 1000], 'float')
+    # a.fill(1)
+    # b.fill(2)
+    #
+    # futures = [a.sum_async(), b.sum_async()]
+    # print([f.result() for f in futures])
+    # @endcode
+    #
+    # Output:
+    #
+    # @code
+    # [1000000.0, 2000000.0]
+    # @endcode
+    def sum_async(self):
+        return _submit(_libZumpy.arr_sum_async(byref(self.arr)), lambda value: value, self)
+
     def __get_list_shape(self, _list, shape = []):
         if (isinstance(_list, list)):
             shape.append(len(_list))
@@ -587,4 +1434,551 @@ class array():
             idx_list = self.__get_index_combinations(list_arr_shape)
             for idx in idx_list:
                 r_idx = list(reversed(idx))
-                self.set(idx, self.__elem_at(list_arr, r_idx))
\ No newline at end of file
+                self.set(idx, self.__elem_at(list_arr, r_idx))
+
+    # With the native binding, element access, fill() and sum() come from _zumpy.array (which calls back into the
+    # methods below for slices and batches), and arr is a ctypes view of the struct held by the object, so every
+    # other method keeps passing byref(self.arr) to the library. Assigning an array_wrapper to arr moves the array
+    # into the object, which frees it when it is collected.
+    if _zumpy is not None:
+        _getitem = __getitem__
+        _setitem = __setitem__
+        del at, set, fill, sum, __getitem__, __setitem__, __del__
+
+        def __get_arr(self):
+            view = self.__dict__.get('_arr_view')
+            if view is None:
+                view = self.__dict__['_arr_view'] = array_wrapper.from_address(self._address)
+            return view
+
+        def __set_arr(self, ref_arr):
+            self._adopt(addressof(ref_arr))
+
+        arr = property(__get_arr, __set_arr)
+
+# wrapper class for sparse arrays
+class sparse_array_wrapper(Structure):
+    _fields_ = [
+        ("format", c_uint),
+        ("rows", c_size_t),
+        ("cols", c_size_t),
+        ("nnz", c_size_t),
+        ("capacity", c_size_t),
+        ("row_indices", POINTER(c_size_t)),
+        ("col_indices", POINTER(c_size_t)),
+        ("values", c_void_p),
+        ("type_size", c_size_t),
+        ("type", c_uint)
+    ]
+
+_libZumpy.sparse_init.argtypes = [POINTER(sparse_array_wrapper), c_size_t, c_size_t, c_uint]
+_libZumpy.sparse_init.restype = None
+
+_libZumpy.sparse_free.argtypes = [POINTER(sparse_array_wrapper)]
+_libZumpy.sparse_free.restype = None
+
+_libZumpy.sparse_insert.argtypes = [POINTER(sparse_array_wrapper), c_size_t, c_size_t, c_void_p]
+_libZumpy.sparse_insert.restype = None
+
+_libZumpy.sparse_to_csr.argtypes = [POINTER(sparse_array_wrapper)]
+_libZumpy.sparse_to_csr.restype = None
+
+_libZumpy.sparse_from_dense.argtypes = [POINTER(array_wrapper), POINTER(sparse_array_wrapper)]
+_libZumpy.sparse_from_dense.restype = None
+
+_libZumpy.sparse_to_dense.argtypes = [POINTER(sparse_array_wrapper), POINTER(array_wrapper)]
+_libZumpy.sparse_to_dense.restype = None
+
+_libZumpy.sparse_sum.argtypes = [POINTER(sparse_array_wrapper)]
+_libZumpy.sparse_sum.restype = c_float
+
+_libZumpy.sparse_sum_axis.argtypes = [POINTER(sparse_array_wrapper), c_size_t, POINTER(array_wrapper)]
+_libZumpy.sparse_sum_axis.restype = None
+
+_libZumpy.sparse_filter.argtypes = [POINTER(sparse_array_wrapper), CFUNCTYPE(c_bool, c_void_p), POINTER(c_size_t), c_size_t, c_uint, POINTER(sparse_array_wrapper)]
+_libZumpy.sparse_filter.restype = None
+
+_libZumpy.sparse_matmul.argtypes = [POINTER(sparse_array_wrapper), POINTER(array_wrapper), POINTER(array_wrapper)]
+_libZumpy.sparse_matmul.restype = None
+
+# internal helper to wrap an array_wrapper filled in by the C library into an array
+def _wrap_array(ref_arr, dtype):
+    ret_arr = array()
+    ret_arr.arr = ref_arr
+    ret_arr.dtype = dtype
+    ret_arr.shape = [ref_arr.arr_shape[i] for i in range(ref_arr.shape_size)]
+    return ret_arr
+
+_type_enums = {'int32': 0, 'float': 1}
+
+## Create an array with every element set to zero. Cheaper than filling with 0 since the memory comes zeroed.
+# @param shape A list specifying the shape, e.g [3, 2].
+# @param dtype One of ('int32', 'float'). By default, it's 'int32'.
+def zeros(shape, dtype = 'int32'):
+    ref_arr = array_wrapper()
+    _libZumpy.arr_zeros(byref(ref_arr), (c_size_t * len(shape))(*shape), len(shape), _type_enums[dtype])
+    return _wrap_array(ref_arr, dtype)
+
+## Create a 1D array of evenly spaced values start, start + step, ... up to but not including stop.
+#
+# Example:
+#
+# @code
+# import zumpy
+#
+# print(zumpy.arange(0, 10, 2)) # 0 2 4 6 8
+# @endcode
+def arange(start, stop, step = 1, dtype = 'int32'):
+    ref_arr = array_wrapper()
+    _libZumpy.arr_arange(byref(ref_arr), c_double(start), c_double(stop), c_double(step), _type_enums[dtype])
+    return _wrap_array(ref_arr, dtype)
+
+## Create a 1D array of num evenly spaced values from start to stop (both included).
+#
+# Example:
+#
+# @code
+# import zumpy
+#
+# print(zumpy.linspace(0, 1, 5)) # 0.000000 0.250000 0.500000 0.750000 1.000000
+# @endcode
+def linspace(start, stop, num, dtype = 'float'):
+    ref_arr = array_wrapper()
+    _libZumpy.arr_linspace(byref(ref_arr), c_double(start), c_double(stop), c_size_t(num), _type_enums[dtype])
+    return _wrap_array(ref_arr, dtype)
+
+## Mergeable quantile sketch (KLL)
+# Estimates quantiles of a stream of values in a few kilobytes. Build one per chunk or per worker and merge them.
+#
+# Example:
+#
+# @code
+# import zumpy
+#
+# total = zumpy.sketch()
+# for path in ['part0.zmp', 'part1.zmp']:
+#     part = zumpy.array()
+#     part.load(path)
+#     total.add(part)
+# print(total.quantiles([0.5, 0.99]), total.count())
+# @endcode
+class sketch():
+    ## @param k Accuracy parameter; larger is more accurate and uses more memory. 0 for the default (200).
+    def __init__(self, k = 0):
+        self.sk = _libZumpy.arr_sketch_new(k)
+
+    def __del__(self):
+        if getattr(self, 'sk', None):
+            _libZumpy.arr_sketch_free(self.sk)
+            self.sk = None
+
+    ## Add an array (every element) or a single number. NaNs are ignored.
+    def add(self, values):
+        if isinstance(values, array):
+            _libZumpy.arr_sketch_add_array(self.sk, byref(values.arr))
+        else:
+            _libZumpy.arr_sketch_add(self.sk, float(values))
+
+    ## Merge another sketch into this one.
+    def merge(self, other):
+        _libZumpy.arr_sketch_merge(self.sk, other.sk)
+
+    ## Number of values added (including through merges).
+    def count(self):
+        return _libZumpy.arr_sketch_count(self.sk)
+
+    ## Estimate quantiles. 0 and 1 give the exact min and max.
+    # @param q A quantile in [0, 1] or a list of them.
+    # @return The estimate, or a list of them if q is a list.
+    def quantiles(self, q):
+        qs = list(q) if isinstance(q, (list, tuple)) else [q]
+        out = (c_double * len(qs))()
+        _libZumpy.arr_sketch_quantiles(self.sk, (c_double * len(qs))(*qs), len(qs), out)
+        return list(out) if isinstance(q, (list, tuple)) else out[0]
+
+## Create an array in a named shared memory segment that other processes can attach to with attach_shared().
+# The elements start zeroed. The segment lives until unlink_shared() is called.
+# @param name Segment name, e.g '/weights'.
+# @param shape A list specifying the shape, e.g [3, 2].
+# @param dtype One of ('int32', 'float'). By default, it's 'int32'.
+# @return The array, or None if the segment already exists or couldn't be created.
+#
+# Example:
+#
+# @code
+# import multiprocessing
+# import zumpy
+#
+# def work(i):
+#     weights = zumpy.attach_shared('/weights')  # no copy: every worker reads the same memory
+#     return weights.sum()
+#
+# weights = zumpy.create_shared('/weights', [100000, 64], 'float')
+# weights.random_uniform()
+# with multiprocessing.Pool(4) as pool:
+#     print(pool.map(work, range(4)))
+# zumpy.unlink_shared('/weights')
+# @endcode
+def create_shared(name, shape, dtype = 'int32'):
+    ref_arr = array_wrapper()
+    if not _libZumpy.arr_create_shared(byref(ref_arr), name.encode(), (c_size_t * len(shape))(*shape), len(shape), _type_enums[dtype]):
+        return None
+    return _wrap_array(ref_arr, dtype)
+
+## Attach to an array created with create_shared(), possibly by another process.
+# Read-only attachments share the memory until this process writes to the array; the write then goes to a private
+# copy. Writable attachments write into the shared copy (see array.shared_lock()).
+# @param name Segment name given to create_shared().
+# @param writable Whether writes should go to the shared copy.
+# @return The array, or None if there is no such segment.
+def attach_shared(name, writable = False):
+    ref_arr = array_wrapper()
+    if not _libZumpy.arr_attach_shared(byref(ref_arr), name.encode(), writable):
+        return None
+    dtype = [k for k, v in _type_enums.items() if v == ref_arr.type][0]
+    return _wrap_array(ref_arr, dtype)
+
+## Remove a shared memory segment's name. Attached arrays keep working until they are freed.
+# @return False if there is no segment with that name.
+def unlink_shared(name):
+    return _libZumpy.arr_unlink_shared(name.encode())
+
+## Random Number Generator
+# A seedable generator for the random_* fills on arrays. Generators with the same seed and different streams give
+# independent sequences, e.g one per thread.
+class rng():
+    state = None
+
+    ## @param seed Seed for the generator. If None, it's seeded from the operating system.
+    # @param stream Index of the stream to use for this seed.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array, rng
+    #
+    # gens = [rng(42, t) for t in range(4)] # one independent stream per worker
+    # arr = array([1000], 'float')
+    # arr.random_normal(0.0, 1.0, gens[0])
+    # @endcode
+    def __init__(self, seed = None, stream = 0):
+        self.state = rng_wrapper()
+        self.seed(seed, stream)
+
+    ## Reseed the generator; see the constructor.
+    def seed(self, seed = None, stream = 0):
+        if seed is None:
+            seed = int.from_bytes(os.urandom(8), 'little')
+        _libZumpy.arr_rng_stream(byref(self.state), c_uint64(seed), c_size_t(stream))
+
+_default_rng = rng()
+
+## Reseed the module's default generator used by the array random_* methods, for reproducible results.
+def seed(value):
+    _default_rng.seed(value)
+
+## Sparse Array Module
+# A 2D array that only stores its non-zero entries. Entries are inserted in coordinate (COO) form and the
+# computations run on compressed sparse rows (CSR), so they cost O(nnz) instead of O(rows * cols).
+class sparse_array():
+    sp = None
+    dtype = None
+    shape = None
+
+    ## Create an empty rows x cols sparse array.
+    # @param shape A list [rows, cols]. If None, the array is left empty (e.g for from_dense()).
+    # @param dtype A string specifying the data type of the array. One of ('int32', 'float'). By default, it's 'int32'.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import sparse_array
+    #
+    # sp = sparse_array([1000, 1000], 'int32')
+    # sp.insert(3, 7, 5)
+    # sp.insert(999, 0, 5)
+    # print(sp.sum()) # 10.0
+    # @endcode
+    def __init__(self, shape = None, dtype = 'int32'):
+        self.sp = sparse_array_wrapper()
+        self.dtype = dtype
+        if shape != None:
+            self.shape = shape
+            _libZumpy.sparse_init(byref(self.sp), shape[0], shape[1], 0 if dtype == 'int32' else 1)
+
+    def __del__(self):
+        _libZumpy.sparse_free(byref(self.sp))
+
+    ## Number of stored (non-zero) entries.
+    def nnz(self):
+        _libZumpy.sparse_to_csr(byref(self.sp))
+        return self.sp.nnz
+
+    ## Add an entry. Entries inserted at the same position are added together.
+    # @param row Row of the entry.
+    # @param col Column of the entry.
+    # @param value Value to store.
+    def insert(self, row, col, value):
+        if self.dtype == 'int32':
+            _libZumpy.sparse_insert(byref(self.sp), row, col, byref(c_int32(value)))
+        elif self.dtype == 'float':
+            _libZumpy.sparse_insert(byref(self.sp), row, col, byref(c_float(value)))
+
+    ## Build a sparse array from the non-zero entries of a 2D array.
+    # @param arr The 2D zumpy array to convert.
+    def from_dense(self, arr):
+        _libZumpy.sparse_free(byref(self.sp))
+        _libZumpy.sparse_from_dense(byref(arr.arr), byref(self.sp))
+        self.dtype = arr.dtype
+        self.shape = [self.sp.rows, self.sp.cols]
+
+    ## Expand into a regular 2D array.
+    # @return A zumpy array.
+    def to_dense(self):
+        ref_arr = array_wrapper()
+        _libZumpy.sparse_to_dense(byref(self.sp), byref(ref_arr))
+        return _wrap_array(ref_arr, self.dtype)
+
+    ## Sum all elements.
+    # @return A float value representing the sum of all the elements.
+    def sum(self):
+        return _libZumpy.sparse_sum(byref(self.sp))
+
+    ## Sum along an axis.
+    # @param axis 0 to sum each column or 1 to sum each row.
+    # @return A 1D 'float' zumpy array with the sums.
+    def sum_axis(self, axis):
+        ref_arr = array_wrapper()
+        _libZumpy.sparse_sum_axis(byref(self.sp), axis, byref(ref_arr))
+        return _wrap_array(ref_arr, 'float')
+
+    ## Filter rows with a user-defined condition, with the same parameters and ANY/ALL semantics as array.filter().
+    # The filter is only called for stored entries plus once for zero.
+    # @return A sparse_array with the kept rows.
+    def filter(self, filter_func, secondary_indices, filter_type):
+        proto_filter_func = CFUNCTYPE(c_bool, c_void_p)
+        p_filter_func = proto_filter_func(filter_func)
+
+        p_secondary_indices = None
+        if len(secondary_indices) != 0:
+            p_secondary_indices = (c_size_t * len(secondary_indices))(*secondary_indices)
+
+        ftype = 0 if filter_type == 'ANY' else 1
+
+        ret = sparse_array(None, self.dtype)
+        _libZumpy.sparse_filter(byref(self.sp), p_filter_func, p_secondary_indices, c_size_t(len(secondary_indices)), c_uint(ftype), byref(ret.sp))
+        ret.shape = [ret.sp.rows, ret.sp.cols]
+        return ret
+
+    ## Multiply by a dense vector (1D array) or matrix (2D array).
+    # @param other A zumpy array with shape [cols] or [cols, k].
+    # @return A 'float' zumpy array with shape [rows] or [rows, k].
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import array, sparse_array
+    #
+    # sp = sparse_array([2, 2], 'float')
+    # sp.insert(0, 1, 2.0)
+    #
+    # vec = array([2], 'float')
+    # vec.fill(1.5)
+    # print(sp.matmul(vec)) # 3.000000 0.000000
+    # @endcode
+    def matmul(self, other):
+        ref_arr = array_wrapper()
+        _libZumpy.sparse_matmul(byref(self.sp), byref(other.arr), byref(ref_arr))
+        return _wrap_array(ref_arr, 'float')
+
+# wrapper class for chunked (out-of-core) arrays
+class chunked_array_wrapper(Structure):
+    _fields_ = [
+        ("file", c_void_p),
+        ("arr_shape", POINTER(c_size_t)),
+        ("shape_size", c_size_t),
+        ("type_size", c_size_t),
+        ("total_size", c_size_t),
+        ("type", c_uint),
+        ("data_offset", c_size_t),
+        ("memory_budget", c_size_t)
+    ]
+
+_libZumpy.chunked_open.argtypes = [POINTER(chunked_array_wrapper), c_char_p, c_size_t]
+_libZumpy.chunked_open.restype = c_bool
+
+_libZumpy.chunked_close.argtypes = [POINTER(chunked_array_wrapper)]
+_libZumpy.chunked_close.restype = None
+
+_libZumpy.chunked_sum.argtypes = [POINTER(chunked_array_wrapper), POINTER(c_float)]
+_libZumpy.chunked_sum.restype = c_bool
+
+_libZumpy.chunked_sum_axis.argtypes = [POINTER(chunked_array_wrapper), c_size_t, c_char_p]
+_libZumpy.chunked_sum_axis.restype = c_bool
+
+_libZumpy.chunked_filter_range.argtypes = [POINTER(chunked_array_wrapper), c_double, c_double, POINTER(c_size_t), c_size_t, c_uint, c_char_p]
+_libZumpy.chunked_filter_range.restype = c_bool
+
+_libZumpy.chunked_scalar_op.argtypes = [POINTER(chunked_array_wrapper), c_uint, c_double, c_char_p]
+_libZumpy.chunked_scalar_op.restype = c_bool
+
+_libZumpy.chunked_elementwise.argtypes = [POINTER(chunked_array_wrapper), POINTER(chunked_array_wrapper), c_uint, c_char_p]
+_libZumpy.chunked_elementwise.restype = c_bool
+
+_elementwise_ops = {'add': 0, 'subtract': 1, 'multiply': 2, 'divide': 3}
+
+## Chunked Array Module
+# An array in a Zumpy (.zmp) file (see array.save()) that is processed a chunk of rows at a time, for data larger
+# than memory. Results the size of the input are written to another .zmp file, which can be opened as a
+# chunked_array again or loaded with array.load().
+class chunked_array():
+    carr = None
+    dtype = None
+    shape = None
+
+    ## Open a .zmp file.
+    # @param path Path of the file.
+    # @param memory_budget Bytes an operation may use for its chunk buffers. By default, 64 MiB.
+    #
+    # Example:
+    #
+    # @code
+    # from zumpy import chunked_array
+    #
+    # big = chunked_array('big.zmp')
+    # print(big.sum())
+    # big.filter_range(0, 100, [0], 'ANY', 'filtered.zmp')
+    # big.apply('multiply', 2, 'doubled.zmp')
+    # @endcode
+    def __init__(self, path, memory_budget = 64 << 20):
+        carr = chunked_array_wrapper()
+        if not _libZumpy.chunked_open(byref(carr), path.encode(), memory_budget):
+            raise IOError('could not open ' + path + ' as a Zumpy file')
+        self.carr = carr
+        self.dtype = 'int32' if carr.type == 0 else 'float'
+        self.shape = [carr.arr_shape[i] for i in range(carr.shape_size)]
+
+    def __del__(self):
+        if self.carr is not None:
+            _libZumpy.chunked_close(byref(self.carr))
+
+    ## Sum of all elements. Raises IOError if the file can't be read.
+    def sum(self):
+        total = c_float()
+        if not _libZumpy.chunked_sum(byref(self.carr), byref(total)):
+            raise IOError('could not read the chunked array')
+        return total.value
+
+    ## Sum along an axis into a 'float' .zmp file with the shape of this array without that axis.
+    # @return True on success.
+    def sum_axis(self, axis, path):
+        return _libZumpy.chunked_sum_axis(byref(self.carr), axis, path.encode())
+
+    ## Range filter (see array.filter_range()) writing the kept rows to a .zmp file.
+    # @return True on success.
+    def filter_range(self, low, high, secondary_indices, filter_type, path):
+        p_secondary_indices = None
+        if len(secondary_indices) != 0:
+            p_secondary_indices = (c_size_t * len(secondary_indices))(*secondary_indices)
+        ftype = 0 if filter_type == 'ANY' else 1
+        return _libZumpy.chunked_filter_range(byref(self.carr), c_double(low), c_double(high), p_secondary_indices, c_size_t(len(secondary_indices)), c_uint(ftype), path.encode())
+
+    ## Apply an operation with a scalar to every element, writing the result to a .zmp file.
+    # @param op One of ('add', 'subtract', 'multiply', 'divide').
+    # @return True on success.
+    def apply(self, op, scalar, path):
+        return _libZumpy.chunked_scalar_op(byref(self.carr), _elementwise_ops[op], c_double(scalar), path.encode())
+
+    ## Apply an operation to the elements of this array and another chunked_array of the same shape and type.
+    # @param op One of ('add', 'subtract', 'multiply', 'divide').
+    # @return True on success.
+    def elementwise(self, other, op, path):
+        return _libZumpy.chunked_elementwise(byref(self.carr), byref(other.carr), _elementwise_ops[op], path.encode())
+
+# instrumentation counters; the ops array is sized from the library so it always matches the C enum
+class op_stats_wrapper(Structure):
+    _fields_ = [
+        ("calls", c_uint64),
+        ("bytes", c_uint64),
+        ("nanoseconds", c_uint64)
+    ]
+
+_libZumpy.arr_stats_op_count.argtypes = []
+_libZumpy.arr_stats_op_count.restype = c_size_t
+
+_libZumpy.arr_stats_op_name.argtypes = [c_size_t]
+_libZumpy.arr_stats_op_name.restype = c_char_p
+
+class stats_wrapper(Structure):
+    _fields_ = [
+        ("ops", op_stats_wrapper * _libZumpy.arr_stats_op_count()),
+        ("live_bytes", c_uint64),
+        ("peak_bytes", c_uint64),
+        ("allocations", c_uint64),
+        ("policy_allocations", c_uint64 * len(_alloc_policies)),
+        ("policy_bytes", c_uint64 * len(_alloc_policies))
+    ]
+
+_libZumpy.arr_stats_get.argtypes = [POINTER(stats_wrapper)]
+_libZumpy.arr_stats_get.restype = None
+
+_libZumpy.arr_stats_reset.argtypes = []
+_libZumpy.arr_stats_reset.restype = None
+
+_libZumpy.arr_stats_enabled.argtypes = []
+_libZumpy.arr_stats_enabled.restype = c_bool
+
+## Read the library's instrumentation counters.
+# The counters are only compiled in when libZumpy is built with -DZUMPY_STATS=ON; otherwise 'enabled' is False
+# and every count is zero.
+# @return A dict with 'enabled', 'live_bytes', 'peak_bytes', 'allocations', 'policies', which maps each allocation
+# policy (see set_alloc_policy()) to a dict of 'allocations' and 'bytes', and 'ops', which maps each operation name
+# (e.g 'arr_sum') to a dict of 'calls', 'bytes' and 'nanoseconds'.
+#
+# Example:
+#
+# @code
+# import zumpy
+#
+# zumpy.reset_stats()
+# arr = zumpy.array([1000, 10], 'int32')
+# arr.fill(1)
+# arr.sum()
+# s = zumpy.stats()
+# print(s['ops']['arr_sum']['calls']) # 1 (when built with ZUMPY_STATS)
+# @endcode
+def stats():
+    ref_stats = stats_wrapper()
+    _libZumpy.arr_stats_get(byref(ref_stats))
+    ops = {}
+    for i in range(len(ref_stats.ops)):
+        op = ref_stats.ops[i]
+        ops[_libZumpy.arr_stats_op_name(i).decode()] = {'calls': op.calls, 'bytes': op.bytes, 'nanoseconds': op.nanoseconds}
+    return {
+        'enabled': _libZumpy.arr_stats_enabled(),
+        'live_bytes': ref_stats.live_bytes,
+        'peak_bytes': ref_stats.peak_bytes,
+        'allocations': ref_stats.allocations,
+        'policies': {name: {'allocations': ref_stats.policy_allocations[i], 'bytes': ref_stats.policy_bytes[i]} for i, name in enumerate(_alloc_policies)},
+        'ops': ops
+    }
+
+## Reset the instrumentation counters. Live bytes are kept since that memory is still allocated.
+def reset_stats():
+    _libZumpy.arr_stats_reset()
+
+## Choose how the storage of large arrays is allocated from now on. Existing arrays keep their storage.
+# Huge pages cut TLB misses when scanning multi-gigabyte arrays; their pages are faulted in up front by the worker
+# threads (see pool_init()) when the array is allocated.
+# @param policy 'heap' (plain malloc, the default), 'huge_pages' (transparent huge pages) or 'hugetlb' (the reserved
+# hugetlb pool, falling back to 'huge_pages').
+# @param min_bytes Smallest storage size the policy applies to.
+def set_alloc_policy(policy, min_bytes = 64 << 20):
+    _libZumpy.arr_set_alloc_policy(_alloc_policies.index(policy), min_bytes)
+
+## Set the number of worker threads used by the *_async methods.
+# Optional: by default they start on first use with one thread per CPU. Has no effect once they are running.
+# @param threads Number of threads; 0 for one per CPU.
+# @return True if this call started the worker threads.
+def pool_init(threads = 0):
+    return _libZumpy.arr_pool_init(threads)
@@ -0,0 +1,104 @@
+// Batched element access: arr_get_many/arr_set_many and their flat-offset forms, with out-of-range positions in
+// any dimension.
+
+#include "test_util.h"
+
+// a 4 x 3 x 2 int32 array holding 0..23
+static void make_cube(array* arr)
+{
+    size_t shape[] = {4, 3, 2};
+    arr_init(arr, shape, 3, INT32);
+    for (size_t i = 0; i < arr->total_size; ++i)
+        ((int32_t*)arr->data)[i] = (int32_t)i;
+}
+
+static void test_get_many(void)
+{
+    array arr;
+    make_cube(&arr);
+
+    size_t indices[] = {
+        0, 0, 0,
+        3, 2, 1,
+        1, 5, 0, // index 1 past its dimension, although the flat offset (10) would be inside the array
+        2, 1, 2, // last index past its dimension
+        4, 0, 0, // first index past its dimension
+        2, 1, 0,
+    };
+    int32_t out[6];
+    memset(out, 0xff, sizeof(out));
+    CHECK(arr_get_many(&arr, indices, 6, out) == 3);
+    CHECK(out[0] == 0 && out[1] == 23 && out[5] == 14);
+    CHECK(out[2] == 0 && out[3] == 0 && out[4] == 0);
+
+    // compressed arrays read the same
+    arr_compress(&arr);
+    memset(out, 0xff, sizeof(out));
+    CHECK(arr_get_many(&arr, indices, 6, out) == 3);
+    CHECK(out[0] == 0 && out[1] == 23 && out[5] == 14 && out[2] == 0);
+    CHECK(arr_get_many(&arr, indices, 0, out) == 0);
+    arr_free(&arr);
+
+    // an array without storage has nothing in range
+    array empty = {.data = NULL, .packed = NULL, .type_size = sizeof(int32_t)};
+    CHECK(arr_get_many(&empty, indices, 2, out) == 2);
+}
+
+static void test_set_many(void)
+{
+    array arr;
+    make_cube(&arr);
+
+    // one bad position and nothing is written
+    size_t indices[] = {0, 0, 1, 1, 3, 0};
+    int32_t values[] = {-1, -2};
+    CHECK(arr_set_many(&arr, indices, 2, values) == 1);
+    CHECK(((int32_t*)arr.data)[1] == 1);
+
+    indices[4] = 2;
+    CHECK(arr_set_many(&arr, indices, 2, values) == 0);
+    CHECK(((int32_t*)arr.data)[1] == -1 && ((int32_t*)arr.data)[6 + 4] == -2);
+
+    // writes decompress and invalidate the zone map
+    arr_zone_map_build(&arr);
+    arr_compress(&arr);
+    int32_t big = 1000;
+    size_t last[] = {3, 2, 1};
+    CHECK(arr_set_many(&arr, last, 1, &big) == 0);
+    CHECK(arr.packed == NULL);
+    array filtered = {.data = NULL};
+    arr_filter_range(&arr, 1000, 1000, NULL, 0, ANY, &filtered);
+    CHECK(filtered.arr_shape[0] == 1);
+    arr_free(&filtered);
+
+    arr_free(&arr);
+}
+
+static void test_flat(void)
+{
+    array arr;
+    make_cube(&arr);
+
+    size_t offsets[] = {23, 24, 5, (size_t)-1};
+    int32_t out[4];
+    CHECK(arr_get_flat(&arr, offsets, 4, out) == 2);
+    CHECK(out[0] == 23 && out[1] == 0 && out[2] == 5 && out[3] == 0);
+
+    int32_t values[] = {100, 101, 102, 103};
+    CHECK(arr_set_flat(&arr, offsets, 4, values) == 2);
+    CHECK(((int32_t*)arr.data)[23] == 23 && ((int32_t*)arr.data)[5] == 5);
+    offsets[1] = 0;
+    offsets[3] = 1;
+    CHECK(arr_set_flat(&arr, offsets, 4, values) == 0);
+    CHECK(((int32_t*)arr.data)[23] == 100 && ((int32_t*)arr.data)[0] == 101 && ((int32_t*)arr.data)[1] == 103);
+
+    arr_free(&arr);
+}
+
+int main(void)
+{
+    test_get_many();
+    test_set_many();
+    test_flat();
+    return TEST_RESULT();
+}
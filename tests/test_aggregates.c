@@ -0,0 +1,124 @@
+// The aggregate cache: sums and min/max with the cache on are identical to a full scan, stay correct through every
+// kind of write, and turning the cache on or off never changes a result.
+
+#include "test_util.h"
+#include <math.h>
+
+// the aggregates of arr computed without the cache (on a share, which has no zone map of its own)
+static void uncached(array* arr, arr_aggregates* agg, float* sum)
+{
+    array view;
+    arr_share(arr, &view);
+    arr_aggregates_get(&view, agg);
+    *sum = arr_sum(&view);
+    arr_free(&view);
+}
+
+static bool matches_uncached(array* arr)
+{
+    arr_aggregates expected, actual;
+    float expected_sum;
+    uncached(arr, &expected, &expected_sum);
+    float sum = arr_sum(arr);
+    arr_aggregates_get(arr, &actual);
+    // bitwise, so a float sum that is off in the last place fails too
+    return memcmp(&sum, &expected_sum, sizeof(sum)) == 0 && memcmp(&actual, &expected, sizeof(actual)) == 0;
+}
+
+static void test_writes(void)
+{
+    size_t shape[] = {5000, 3};
+    array arr;
+    arr_init(&arr, shape, 2, FLOAT);
+    arr_rng rng;
+    arr_rng_seed(&rng, 8);
+    arr_random_uniform(&arr, &rng, -1e4, 1e4);
+
+    arr_aggregate_cache(&arr, true);
+    CHECK(arr_aggregate_cached(&arr));
+    CHECK(matches_uncached(&arr));
+
+    size_t idx[] = {4999, 2};
+    float v = 1e6f;
+    arr_set(&arr, idx, &v);
+    CHECK(matches_uncached(&arr));
+
+    size_t indices[] = {0, 0, 2500, 1};
+    float values[] = {-1e6f, 123.5f};
+    arr_set_many(&arr, indices, 2, values);
+    CHECK(matches_uncached(&arr));
+
+    size_t offsets[] = {1024 * 3};
+    arr_set_flat(&arr, offsets, 1, &v);
+    CHECK(matches_uncached(&arr));
+
+    array rows;
+    size_t row_shape[] = {1500, 3};
+    arr_init(&rows, row_shape, 2, FLOAT);
+    arr_random_normal(&rows, &rng, 0, 100);
+    arr_append_rows(&arr, &rows);
+    arr_free(&rows);
+    CHECK(matches_uncached(&arr));
+
+    // NaNs poison the sum but not min/max, with or without the cache
+    float nan = NAN;
+    arr_set(&arr, idx, &nan);
+    arr_aggregates agg;
+    arr_aggregates_get(&arr, &agg);
+    CHECK(isnan(agg.sum) && !isnan(agg.min) && !isnan(agg.max));
+    CHECK(matches_uncached(&arr));
+
+    arr_random_uniform(&arr, &rng, 0, 1);
+    CHECK(matches_uncached(&arr));
+    v = 0.25f;
+    arr_fill(&arr, &v);
+    CHECK(matches_uncached(&arr));
+
+    // off and on again
+    arr_aggregate_cache(&arr, false);
+    CHECK(!arr_aggregate_cached(&arr));
+    v = 3;
+    arr_fill(&arr, &v);
+    arr_aggregate_cache(&arr, true);
+    CHECK(matches_uncached(&arr));
+    CHECK(arr_sum(&arr) == 3.0f * arr.total_size);
+
+    arr_free(&arr);
+}
+
+static void test_shapes(void)
+{
+    arr_rng rng;
+    arr_rng_seed(&rng, 9);
+    size_t shapes[][3] = {{1, 1, 1}, {1023, 1, 1}, {1025, 1, 1}, {3000, 7, 2}};
+    for (size_t s = 0; s < 4; ++s)
+    {
+        array arr;
+        arr_init(&arr, shapes[s], 3, INT32);
+        arr_random_int(&arr, &rng, -1000000, 1000000);
+        arr_aggregate_cache(&arr, true);
+        CHECK(matches_uncached(&arr));
+
+        // compressed arrays keep the cache
+        arr_compress(&arr);
+        CHECK(matches_uncached(&arr));
+        arr_free(&arr);
+    }
+
+    // an empty array
+    array empty;
+    arr_arange(&empty, 0, 0, 1, FLOAT);
+    arr_aggregate_cache(&empty, true);
+    arr_aggregates agg;
+    arr_aggregates_get(&empty, &agg);
+    CHECK(agg.count == 0 && agg.sum == 0 && agg.min == INFINITY && agg.max == -INFINITY);
+    CHECK(arr_sum(&empty) == 0);
+    arr_free(&empty);
+}
+
+int main(void)
+{
+    test_writes();
+    test_shapes();
+    return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+// Allocation policies: which arrays get huge page storage, the fallback from hugetlb, and that the storage behaves
+// like heap storage through fills, growth, sharing and compression.
+
+#include "test_util.h"
+
+#define MIN_BYTES (1 << 20)
+
+// a rows x 256 float array (1 KiB rows) holding 0, 1, 2, ...
+static void make_big(array* arr, size_t rows)
+{
+    size_t shape[] = {rows, 256};
+    arr_init(arr, shape, 2, FLOAT);
+    for (size_t i = 0; i < arr->total_size; ++i)
+        ((float*)arr->data)[i] = (float)i;
+}
+
+static bool holds_sequence(array* arr, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        if (((float*)arr->data)[i] != (float)i)
+            return false;
+    return true;
+}
+
+static void test_policies(void)
+{
+    array small, big, zeros;
+    size_t zero_shape[] = {4096, 256};
+
+    // the default is the heap for everything
+    make_big(&big, 4096);
+    CHECK(arr_storage_policy(&big) == ALLOC_HEAP);
+    arr_free(&big);
+
+    for (alloc_policy policy = ALLOC_HUGE_PAGES; policy <= ALLOC_HUGETLB; ++policy)
+    {
+        arr_set_alloc_policy(policy, MIN_BYTES);
+
+        make_big(&small, 16);
+        CHECK(arr_storage_policy(&small) == ALLOC_HEAP);
+
+        // hugetlb falls back to transparent huge pages when the pool is empty
+        make_big(&big, 4096);
+        alloc_policy got = arr_storage_policy(&big);
+        CHECK(got == policy || (policy == ALLOC_HUGETLB && got == ALLOC_HUGE_PAGES));
+        CHECK(holds_sequence(&big, big.total_size));
+
+        arr_zeros(&zeros, zero_shape, 2, FLOAT);
+        CHECK(arr_storage_policy(&zeros) != ALLOC_HEAP);
+        arr_aggregates agg;
+        arr_aggregates_get(&zeros, &agg);
+        CHECK(agg.min == 0 && agg.max == 0);
+        float v = 2;
+        arr_fill(&zeros, &v);
+        CHECK(arr_sum(&zeros) == 2.0f * zeros.total_size);
+
+        // growing and copying on write keep the contents
+        size_t old_size = big.total_size;
+        arr_append_rows(&big, &small);
+        CHECK(holds_sequence(&big, old_size));
+        array view;
+        arr_share(&big, &view);
+        size_t idx[] = {0, 0};
+        float minus = -1;
+        arr_set(&view, idx, &minus);
+        CHECK(holds_sequence(&big, old_size));
+        CHECK(*(float*)arr_at(&view, idx) == -1);
+
+        arr_free(&view);
+        arr_free(&small);
+        arr_free(&big);
+        arr_free(&zeros);
+    }
+
+    // compressed arrays live on the heap
+    arr_set_alloc_policy(ALLOC_HUGE_PAGES, MIN_BYTES);
+    array ints;
+    size_t int_shape[] = {1 << 20};
+    arr_zeros(&ints, int_shape, 1, INT32);
+    arr_compress(&ints);
+    CHECK(ints.packed != NULL && arr_storage_policy(&ints) == ALLOC_HEAP);
+    arr_free(&ints);
+
+    arr_set_alloc_policy(ALLOC_HEAP, 64 << 20);
+}
+
+int main(void)
+{
+    test_policies();
+    return TEST_RESULT();
+}
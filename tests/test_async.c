@@ -0,0 +1,208 @@
+// Asynchronous operations on the worker pool: results match the synchronous calls, concurrent operations on one
+// array (plain, compressed and with the aggregate cache) agree, and completion callbacks run exactly once.
+
+#include "test_util.h"
+
+#define ARRAYS 4
+#define FILTERS 8
+
+static int callbacks = 0;
+static int tasks = 0;
+
+static void count_callback(arr_future* future, void* user_data)
+{
+    (void)future;
+    __atomic_add_fetch((int*)user_data, 1, __ATOMIC_SEQ_CST);
+}
+
+static void free_in_callback(arr_future* future, void* user_data)
+{
+    count_callback(future, user_data);
+    arr_future_free(future);
+}
+
+static int started = 0;
+static int freed = 0;
+
+// waits until the main thread has registered its callback
+static void gated_task(void* arg)
+{
+    (void)arg;
+    while (!__atomic_load_n(&started, __ATOMIC_SEQ_CST))
+        ;
+}
+
+// reads the result only after the thread that started the operation has freed the future
+static void slow_result_callback(arr_future* future, void* user_data)
+{
+    while (!__atomic_load_n(&freed, __ATOMIC_SEQ_CST))
+        ;
+    CHECK(arr_future_result(future) == 0);
+    count_callback(future, user_data);
+}
+
+static void count_task(void* arg)
+{
+    __atomic_add_fetch((int*)arg, 1, __ATOMIC_SEQ_CST);
+}
+
+static bool is_odd(void* value)
+{
+    return *(int32_t*)value % 2 != 0;
+}
+
+static void is_odd_block(void* rows, size_t nrows, bool* mask)
+{
+    int32_t* values = rows;
+    for (size_t i = 0; i < nrows * 2; ++i)
+        mask[i] = values[i] % 2 != 0;
+}
+
+static void make_array(array* arr, uint64_t seed)
+{
+    size_t shape[] = {20000, 2};
+    arr_init(arr, shape, 2, INT32);
+    arr_rng rng;
+    arr_rng_seed(&rng, seed);
+    arr_random_int(arr, &rng, 0, 1000);
+}
+
+static void test_pool(void)
+{
+    CHECK(arr_pool_init(4));
+    CHECK(!arr_pool_init(2));
+    CHECK(arr_pool_size() == 4);
+}
+
+static void test_sums(void)
+{
+    array arrays[ARRAYS];
+    arr_future* futures[ARRAYS];
+    for (size_t i = 0; i < ARRAYS; ++i)
+    {
+        make_array(&arrays[i], i);
+        futures[i] = arr_sum_async(&arrays[i]);
+        CHECK(futures[i] != NULL);
+    }
+    for (size_t i = 0; i < ARRAYS; ++i)
+    {
+        CHECK(arr_future_result(futures[i]) == arr_sum(&arrays[i]));
+        CHECK(arr_future_poll(futures[i]));
+        arr_future_free(futures[i]);
+        arr_free(&arrays[i]);
+    }
+}
+
+// several range filters and sums at once on one array; aggregate_cache turns the cache on first and compress
+// compresses it first
+static void check_concurrent_filters(bool aggregate_cache, bool compress)
+{
+    array arr;
+    make_array(&arr, 42);
+    if (aggregate_cache)
+        arr_aggregate_cache(&arr, true);
+    if (compress)
+        arr_compress(&arr);
+
+    array expected[FILTERS], actual[FILTERS];
+    arr_future* filters[FILTERS];
+    arr_future* sums[FILTERS];
+    for (size_t i = 0; i < FILTERS; ++i)
+    {
+        actual[i] = (array){.data = NULL};
+        filters[i] = arr_filter_range_async(&arr, i * 100, i * 100 + 150, NULL, 0, ANY, &actual[i]);
+        sums[i] = arr_sum_async(&arr);
+    }
+
+    // the queuing thread may keep reading while they run
+    float sum = arr_sum(&arr);
+    for (size_t i = 0; i < FILTERS; ++i)
+    {
+        expected[i] = (array){.data = NULL};
+        arr_filter_range(&arr, i * 100, i * 100 + 150, NULL, 0, ANY, &expected[i]);
+    }
+
+    for (size_t i = 0; i < FILTERS; ++i)
+    {
+        CHECK(arr_future_result(sums[i]) == sum);
+        arr_future_wait(filters[i]);
+        CHECK(test_arrays_equal(&expected[i], &actual[i]));
+        arr_future_free(filters[i]);
+        arr_future_free(sums[i]);
+        arr_free(&expected[i]);
+        arr_free(&actual[i]);
+    }
+    arr_free(&arr);
+}
+
+static void test_filters(void)
+{
+    check_concurrent_filters(false, false);
+    check_concurrent_filters(true, false);
+    check_concurrent_filters(false, true);
+    check_concurrent_filters(true, true);
+
+    array arr, expected = {.data = NULL}, actual = {.data = NULL}, actual_block = {.data = NULL};
+    make_array(&arr, 7);
+    arr_future* filter = arr_filter_async(&arr, &is_odd, NULL, 0, ALL, &actual);
+    arr_future* block = arr_filter_block_async(&arr, &is_odd_block, NULL, 0, ALL, &actual_block);
+    arr_filter(&arr, &is_odd, NULL, 0, ALL, &expected);
+    CHECK(arr_future_result(filter) == 0);
+    arr_future_wait(block);
+    CHECK(test_arrays_equal(&expected, &actual));
+    CHECK(test_arrays_equal(&expected, &actual_block));
+    arr_future_free(filter);
+    arr_future_free(block);
+    arr_free(&arr);
+    arr_free(&expected);
+    arr_free(&actual);
+    arr_free(&actual_block);
+}
+
+static void test_callbacks(void)
+{
+    arr_future* futures[16];
+    for (size_t i = 0; i < 16; ++i)
+    {
+        futures[i] = arr_async(&count_task, &tasks);
+        arr_future_on_complete(futures[i], &count_callback, &callbacks);
+    }
+    for (size_t i = 0; i < 16; ++i)
+    {
+        arr_future_wait(futures[i]);
+        arr_future_free(futures[i]);
+    }
+    CHECK(__atomic_load_n(&tasks, __ATOMIC_SEQ_CST) == 16);
+    CHECK(__atomic_load_n(&callbacks, __ATOMIC_SEQ_CST) == 16);
+
+    // a callback on a finished operation runs right away, and may free the future
+    arr_future* done = arr_async(&count_task, &tasks);
+    arr_future_wait(done);
+    arr_future_on_complete(done, &free_in_callback, &callbacks);
+    CHECK(__atomic_load_n(&callbacks, __ATOMIC_SEQ_CST) == 17);
+
+    // or when the operation finishes on a worker
+    arr_future* pending = arr_async(&count_task, &tasks);
+    arr_future_on_complete(pending, &free_in_callback, &callbacks);
+    while (__atomic_load_n(&callbacks, __ATOMIC_SEQ_CST) < 18)
+        ;
+    CHECK(__atomic_load_n(&tasks, __ATOMIC_SEQ_CST) == 18);
+
+    // freeing the future while its callback still runs on a worker leaves it valid until the callback returns
+    arr_future* running = arr_async(&gated_task, NULL);
+    arr_future_on_complete(running, &slow_result_callback, &callbacks);
+    __atomic_store_n(&started, 1, __ATOMIC_SEQ_CST);
+    arr_future_free(running);
+    __atomic_store_n(&freed, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&callbacks, __ATOMIC_SEQ_CST) < 19)
+        ;
+}
+
+int main(void)
+{
+    test_pool();
+    test_sums();
+    test_filters();
+    test_callbacks();
+    return TEST_RESULT();
+}
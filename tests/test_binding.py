@@ -0,0 +1,155 @@
+# Tests of the Python binding (zumpy.py), run by ctest once through ctypes only and, when the native extension is
+# built, once more with it loaded.
+#
+# usage: test_binding.py --lib path/to/libZumpy.so [--extension path/to/_zumpy.so]
+#
+# zumpy.py loads its libraries from ./ext, so they are copied into a scratch directory which becomes the working
+# directory.
+
+import argparse
+import math
+import os
+import shutil
+import sys
+import tempfile
+import unittest
+
+def _setup():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--lib', required=True)
+    parser.add_argument('--extension')
+    args, rest = parser.parse_known_args()
+
+    scratch = tempfile.mkdtemp(prefix='zumpy_binding_')
+    os.mkdir(os.path.join(scratch, 'ext'))
+    shutil.copy(args.lib, os.path.join(scratch, 'ext', 'libZumpy.so'))
+    if args.extension:
+        shutil.copy(args.extension, os.path.join(scratch, 'ext', os.path.basename(args.extension)))
+    else:
+        os.environ['ZUMPY_NO_EXTENSION'] = '1'
+    os.chdir(scratch)
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src', 'python'))
+    return args, scratch, [sys.argv[0]] + rest
+
+ARGS, SCRATCH, ARGV = _setup()
+
+import zumpy
+from zumpy import array
+
+class BindingTest(unittest.TestCase):
+    def test_extension_loaded(self):
+        self.assertEqual(zumpy._zumpy is not None, ARGS.extension is not None)
+
+    def test_indexing(self):
+        a = array([3, 2], 'int32')
+        a.fill(1)
+        a[1, 1] = 5
+        a[[(0, 0), (2, 1)]] = [7, 8]
+        self.assertEqual(a[1, 1], 5)
+        self.assertEqual(a[[(0, 0), (2, 1), (1, 0)]], [7, 8, 1])
+        self.assertEqual(a.get_flat([0, 5]), [7, 8])
+        self.assertEqual(a.sum(), 7 + 8 + 5 + 3)
+
+        f = array([4], 'float')
+        f.fill(1.5)
+        f[2] = 3
+        self.assertEqual(f[2], 3.0)
+        self.assertEqual(list(f), [1.5, 1.5, 3.0, 1.5])
+
+    def test_index_errors(self):
+        a = array([3, 2], 'int32')
+        a.fill(1)
+        # (0, 5) would alias element (2, 1) if only the flat offset were checked
+        for key in [(0, 5), (3, 0), (-1, 0)]:
+            with self.assertRaises(IndexError):
+                a[key]
+            with self.assertRaises(IndexError):
+                a[key] = 2
+        with self.assertRaises(IndexError):
+            a[[(0, 1), (0, 2)]]
+        with self.assertRaises(IndexError):
+            a[[(0, 1), (0, 2)]] = [4, 4]
+        with self.assertRaises(IndexError):
+            a.get_flat([6])
+        with self.assertRaises(IndexError):
+            a.set_flat([0, -1], [1, 1])
+        # failed writes write nothing
+        self.assertEqual(a.sum(), 6)
+
+    def test_filter_range_nan(self):
+        a = array([3000, 1], 'float')
+        for r in range(3000):
+            a[r, 0] = r
+        self.assertEqual(a.filter_range(1024, 2047, [0], 'ANY').shape[0], 1024)
+        a[1500, 0] = float('nan')
+        self.assertEqual(a.filter_range(1024, 2047, [0], 'ANY').shape[0], 1023)
+
+    def test_compress(self):
+        a = zumpy.arange(0, 100000, 1, 'int32')
+        before = a.storage_bytes()
+        total = a.sum()
+        a.compress()
+        self.assertLess(a.storage_bytes(), before)
+        self.assertEqual(a.sum(), total)
+        self.assertEqual(a[12345], 12345)
+        a[0] = -1
+        self.assertEqual(a[0], -1)
+        self.assertEqual(a[99999], 99999)
+
+    def test_copy_on_write(self):
+        a = array([10, 2], 'int32')
+        a.fill(10)
+        v = a.view()
+        self.assertTrue(a.is_shared())
+        v.fill(20)
+        self.assertEqual((a.sum(), v.sum()), (200, 400))
+        r = a.rows(2, 5)
+        r[0, 0] = 0
+        self.assertEqual(a[2, 0], 10)
+
+    def test_save_load_and_chunked(self):
+        a = array([5000, 3], 'int32')
+        a.random_int(-100, 100, zumpy.rng(3))
+        a.save('binding.zmp')
+        loaded = array()
+        loaded.load('binding.zmp')
+        self.assertEqual(loaded.sum(), a.sum())
+        self.assertEqual(zumpy.chunked_array('binding.zmp', 4096).sum(), a.sum())
+
+    def test_quantiles(self):
+        a = array([1001], 'float')
+        a.random_uniform(0, 10, zumpy.rng(4))
+        values = sorted(a)
+        self.assertEqual(a.quantiles([0.0, 0.5, 1.0]), [values[0], values[500], values[1000]])
+        estimate = a.quantiles(0.5, exact = False)
+        self.assertLess(abs(sum(v <= estimate for v in values) / 1001 - 0.5), 0.02)
+
+    def test_async(self):
+        a = array([1000, 10], 'float')
+        a.fill(2)
+        self.assertEqual(a.sum_async().result(), 20000.0)
+
+    @unittest.skipIf(zumpy._zumpy is None, 'needs the native extension')
+    def test_memoryview(self):
+        a = array([2, 2], 'int32')
+        a.fill(3)
+        m = memoryview(a)
+        self.assertTrue(m.readonly)
+        self.assertEqual(m.tolist(), [[3, 3], [3, 3]])
+        m.release()
+
+    @unittest.skipIf(zumpy._zumpy is None, 'needs the native extension')
+    def test_memoryview_compressed(self):
+        a = zumpy.arange(0, 10000, 1, 'int32')
+        a.compress()
+        with self.assertRaises(BufferError):
+            memoryview(a)
+        a.decompress()
+        self.assertEqual(memoryview(a)[9999], 9999)
+
+if __name__ == '__main__':
+    try:
+        unittest.main(argv = ARGV)
+    finally:
+        os.chdir('/')
+        shutil.rmtree(SCRATCH, ignore_errors = True)
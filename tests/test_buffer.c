@@ -0,0 +1,172 @@
+// Shared storage: arr_share() and arr_view_rows() share without copying, and every kind of write copies first so
+// the other arrays never see it.
+
+#include "test_util.h"
+
+static void make_sequence(array* arr, size_t rows)
+{
+    size_t shape[] = {rows, 2};
+    arr_init(arr, shape, 2, INT32);
+    for (size_t i = 0; i < arr->total_size; ++i)
+        ((int32_t*)arr->data)[i] = (int32_t)i;
+}
+
+static bool is_sequence(array* arr, size_t first)
+{
+    for (size_t i = 0; i < arr->total_size; ++i)
+    {
+        size_t offset = i;
+        int32_t v;
+        arr_get_flat(arr, &offset, 1, &v);
+        if (v != (int32_t)(first + i))
+            return false;
+    }
+    return true;
+}
+
+static void test_share(void)
+{
+    array arr, view;
+    make_sequence(&arr, 100);
+    arr_share(&arr, &view);
+    CHECK(view.data == arr.data);
+    CHECK(arr_is_shared(&arr) && arr_is_shared(&view));
+
+    size_t idx[] = {5, 1};
+    int32_t v = -1;
+    arr_set(&view, idx, &v);
+    CHECK(view.data != arr.data);
+    CHECK(!arr_is_shared(&arr) && !arr_is_shared(&view));
+    CHECK(is_sequence(&arr, 0));
+    CHECK(*(int32_t*)arr_at(&view, idx) == -1);
+
+    arr_free(&arr);
+    arr_free(&view);
+}
+
+// every write path gives the written array its own copy; write(arr) is applied to a share of a sequence
+static void check_write_copies(void (*write)(array*))
+{
+    array arr, view;
+    make_sequence(&arr, 100);
+    arr_share(&arr, &view);
+    write(&view);
+    CHECK(view.data != arr.data);
+    CHECK(is_sequence(&arr, 0));
+    arr_free(&view);
+
+    // the original goes on to own the storage alone
+    CHECK(!arr_is_shared(&arr));
+    arr_free(&arr);
+}
+
+static void write_fill(array* arr)
+{
+    int32_t v = 7;
+    arr_fill(arr, &v);
+}
+
+static void write_set_many(array* arr)
+{
+    size_t indices[] = {0, 0, 99, 1};
+    int32_t values[] = {-1, -2};
+    CHECK(arr_set_many(arr, indices, 2, values) == 0);
+}
+
+static void write_set_flat(array* arr)
+{
+    size_t offsets[] = {3};
+    int32_t v = -3;
+    CHECK(arr_set_flat(arr, offsets, 1, &v) == 0);
+}
+
+static void write_random(array* arr)
+{
+    arr_rng rng;
+    arr_rng_seed(&rng, 1);
+    arr_random_int(arr, &rng, 1000, 2000);
+}
+
+static void write_append(array* arr)
+{
+    array rows;
+    make_sequence(&rows, 3);
+    arr_append_rows(arr, &rows);
+    arr_free(&rows);
+}
+
+static void test_write_paths(void)
+{
+    check_write_copies(&write_fill);
+    check_write_copies(&write_set_many);
+    check_write_copies(&write_set_flat);
+    check_write_copies(&write_random);
+    check_write_copies(&write_append);
+}
+
+static void test_view_rows(void)
+{
+    array arr, view;
+    make_sequence(&arr, 100);
+    arr_view_rows(&arr, 10, 20, &view);
+    CHECK(view.arr_shape[0] == 10 && view.total_size == 20);
+    CHECK(view.data == (int32_t*)arr.data + 20);
+    CHECK(is_sequence(&view, 20));
+
+    // the source can go away first
+    arr_free(&arr);
+    CHECK(is_sequence(&view, 20));
+
+    make_sequence(&arr, 100);
+    array view2;
+    arr_view_rows(&arr, 50, 100, &view2);
+    write_fill(&view2);
+    CHECK(is_sequence(&arr, 0));
+    arr_free(&arr);
+    arr_free(&view);
+    arr_free(&view2);
+}
+
+static void test_zone_map_not_shared(void)
+{
+    // a write to a share must not leave the other array's zone map stale, or vice versa
+    array arr, view, filtered = {.data = NULL};
+    make_sequence(&arr, 3000);
+    arr_zone_map_build(&arr);
+    arr_share(&arr, &view);
+    arr_filter_range(&view, 0, 100, NULL, 0, ALL, &filtered);
+    arr_free(&filtered);
+    write_fill(&view);
+
+    arr_filter_range(&arr, 0, 100, NULL, 0, ALL, &filtered);
+    CHECK(filtered.arr_shape[0] == 50);
+    arr_free(&filtered);
+    arr_filter_range(&view, 7, 7, NULL, 0, ALL, &filtered);
+    CHECK(filtered.arr_shape[0] == 3000);
+    arr_free(&filtered);
+
+    arr_free(&arr);
+    arr_free(&view);
+}
+
+static void test_compressed_share(void)
+{
+    array arr, view;
+    make_sequence(&arr, 5000);
+    arr_compress(&arr);
+    arr_share(&arr, &view);
+    CHECK(view.packed == NULL && view.data != NULL);
+    CHECK(is_sequence(&view, 0));
+    arr_free(&arr);
+    arr_free(&view);
+}
+
+int main(void)
+{
+    test_share();
+    test_write_paths();
+    test_view_rows();
+    test_zone_map_not_shared();
+    test_compressed_share();
+    return TEST_RESULT();
+}
@@ -0,0 +1,193 @@
+// Chunked (out-of-core) operations against the same operations on the array in memory, with budgets from a few rows
+// per chunk to the whole file in one chunk, and read failures.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "test_util.h"
+#include <unistd.h>
+
+#define INPUT "test_chunked_input.zmp"
+#define OTHER "test_chunked_other.zmp"
+#define OUTPUT "test_chunked_output.zmp"
+
+static const size_t budgets[] = {1, 256, 4096, 1 << 24};
+
+static void odd_block(void* rows, size_t nrows, bool* mask)
+{
+    int32_t* values = rows;
+    for (size_t i = 0; i < nrows * 3; ++i)
+        mask[i] = values[i] % 2 != 0;
+}
+
+// a 5000 x 3 int32 array of small values, so every sum is exact in float
+static void make_input(array* arr, uint64_t seed)
+{
+    size_t shape[] = {5000, 3};
+    arr_init(arr, shape, 2, INT32);
+    arr_rng rng;
+    arr_rng_seed(&rng, seed);
+    arr_random_int(arr, &rng, -100, 100);
+}
+
+static bool load_output(array* out)
+{
+    return arr_load(out, OUTPUT);
+}
+
+static void test_sum(array* arr, chunked_array* carr)
+{
+    float sum;
+    CHECK(chunked_sum(carr, &sum));
+    CHECK(sum == arr_sum(arr));
+
+    array out;
+    for (size_t axis = 0; axis < 2; ++axis)
+    {
+        CHECK(chunked_sum_axis(carr, axis, OUTPUT));
+        CHECK(load_output(&out));
+        size_t expected_len = arr->arr_shape[1 - axis];
+        CHECK(out.dtype == FLOAT && out.shape_size == 1 && out.total_size == expected_len);
+        for (size_t i = 0; i < expected_len && out.total_size == expected_len; ++i)
+        {
+            float expected = 0;
+            for (size_t j = 0; j < arr->arr_shape[axis]; ++j)
+                expected += ((int32_t*)arr->data)[axis == 0 ? j * 3 + i : i * 3 + j];
+            CHECK(((float*)out.data)[i] == expected);
+        }
+        arr_free(&out);
+    }
+}
+
+static void test_filters(array* arr, chunked_array* carr)
+{
+    array expected = {.data = NULL}, out;
+    size_t cols[] = {0, 2};
+
+    arr_filter_range(arr, -10, 50, cols, 2, ALL, &expected);
+    CHECK(chunked_filter_range(carr, -10, 50, cols, 2, ALL, OUTPUT));
+    CHECK(load_output(&out));
+    CHECK(test_arrays_equal(&expected, &out));
+    arr_free(&expected);
+    arr_free(&out);
+
+    arr_filter_block(arr, &odd_block, NULL, 0, ANY, &expected);
+    CHECK(chunked_filter_block(carr, &odd_block, NULL, 0, ANY, OUTPUT));
+    CHECK(load_output(&out));
+    CHECK(test_arrays_equal(&expected, &out));
+    arr_free(&expected);
+    arr_free(&out);
+}
+
+static void test_elementwise(array* arr, array* other, chunked_array* carr, chunked_array* cother)
+{
+    array out;
+    CHECK(chunked_scalar_op(carr, MULTIPLY, 3, OUTPUT));
+    CHECK(load_output(&out));
+    bool same = out.total_size == arr->total_size;
+    for (size_t i = 0; same && i < out.total_size; ++i)
+        same = ((int32_t*)out.data)[i] == 3 * ((int32_t*)arr->data)[i];
+    CHECK(same);
+    arr_free(&out);
+
+    CHECK(chunked_elementwise(carr, cother, SUBTRACT, OUTPUT));
+    CHECK(load_output(&out));
+    same = out.total_size == arr->total_size;
+    for (size_t i = 0; same && i < out.total_size; ++i)
+        same = ((int32_t*)out.data)[i] == ((int32_t*)arr->data)[i] - ((int32_t*)other->data)[i];
+    CHECK(same);
+    arr_free(&out);
+}
+
+static void test_budgets(void)
+{
+    array arr, other;
+    make_input(&arr, 1);
+    make_input(&other, 2);
+    CHECK(arr_save(&arr, INPUT));
+    CHECK(arr_save(&other, OTHER));
+
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); ++b)
+    {
+        chunked_array carr, cother;
+        CHECK(chunked_open(&carr, INPUT, budgets[b]));
+        CHECK(chunked_open(&cother, OTHER, budgets[b]));
+        test_sum(&arr, &carr);
+        test_filters(&arr, &carr);
+        test_elementwise(&arr, &other, &carr, &cother);
+        chunked_close(&carr);
+        chunked_close(&cother);
+    }
+
+    arr_free(&arr);
+    arr_free(&other);
+}
+
+// float sums round differently depending on how the elements are grouped, so the chunked sum has to match arr_sum
+// exactly whether the chunks are smaller than, larger than or misaligned with its blocks of rows
+static void test_float_sum(void)
+{
+    size_t shape[] = {5000, 3};
+    array arr;
+    arr_init(&arr, shape, 2, FLOAT);
+    arr_rng rng;
+    arr_rng_seed(&rng, 3);
+    arr_random_normal(&arr, &rng, 0.0, 1e6);
+    CHECK(arr_save(&arr, INPUT));
+    float expected = arr_sum(&arr);
+
+    const size_t float_budgets[] = {1, 256, 4096, 24000, 100000, 1 << 24};
+    for (size_t b = 0; b < sizeof(float_budgets) / sizeof(float_budgets[0]); ++b)
+    {
+        chunked_array carr;
+        CHECK(chunked_open(&carr, INPUT, float_budgets[b]));
+        float sum;
+        CHECK(chunked_sum(&carr, &sum));
+        CHECK(sum == expected);
+        chunked_close(&carr);
+    }
+    arr_free(&arr);
+}
+
+static void test_read_errors(void)
+{
+    array arr, small;
+    make_input(&arr, 3);
+    CHECK(arr_save(&arr, INPUT));
+    size_t shape[] = {10, 3};
+    arr_zeros(&small, shape, 2, INT32);
+    CHECK(arr_save(&small, OTHER));
+
+    chunked_array carr, cother;
+    CHECK(!chunked_open(&carr, "test_chunked_missing.zmp", 4096));
+    CHECK(chunked_open(&carr, INPUT, 4096));
+    CHECK(chunked_open(&cother, OTHER, 4096));
+
+    // mismatched shapes fail and leave no output behind
+    remove(OUTPUT);
+    CHECK(!chunked_elementwise(&carr, &cother, ADD, OUTPUT));
+    CHECK(access(OUTPUT, F_OK) != 0);
+
+    // the file shrinking under an open chunked array is a read error, not a short sum
+    CHECK(truncate(INPUT, 4096) == 0);
+    float sum = 1;
+    CHECK(!chunked_sum(&carr, &sum));
+    CHECK(sum == 0);
+    CHECK(!chunked_sum_axis(&carr, 0, OUTPUT));
+    CHECK(access(OUTPUT, F_OK) != 0);
+
+    chunked_close(&carr);
+    chunked_close(&cother);
+    arr_free(&arr);
+    arr_free(&small);
+}
+
+int main(void)
+{
+    test_budgets();
+    test_float_sum();
+    test_read_errors();
+    remove(INPUT);
+    remove(OTHER);
+    remove(OUTPUT);
+    return TEST_RESULT();
+}
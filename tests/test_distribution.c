@@ -0,0 +1,219 @@
+// Histograms and quantiles: counts against a direct count, exact quantiles against a sorted copy, and the KLL sketch
+// (alone, merged and through arr_quantiles) within its rank error bound.
+
+#include "test_util.h"
+#include <math.h>
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// the non-NaN elements of arr, sorted; returns how many there are
+static size_t sorted_values(array* arr, double** out)
+{
+    *out = malloc(sizeof(double) * (arr->total_size > 0 ? arr->total_size : 1));
+    size_t n = 0;
+    for (size_t i = 0; i < arr->total_size; ++i)
+    {
+        size_t offset = i;
+        double v;
+        if (arr->dtype == INT32)
+        {
+            int32_t x;
+            arr_get_flat(arr, &offset, 1, &x);
+            v = x;
+        }
+        else
+        {
+            float x;
+            arr_get_flat(arr, &offset, 1, &x);
+            v = x;
+        }
+        if (!isnan(v))
+            (*out)[n++] = v;
+    }
+    qsort(*out, n, sizeof(double), &compare_doubles);
+    return n;
+}
+
+// linear interpolation between the closest ranks, like NumPy's default
+static double reference_quantile(double* sorted, size_t n, double q)
+{
+    double position = q * (n - 1);
+    size_t below = (size_t)floor(position);
+    size_t above = below + 1 < n ? below + 1 : below;
+    return sorted[below] + (sorted[above] - sorted[below]) * (position - below);
+}
+
+// fraction of the sorted values at or below v
+static double rank_of(double* sorted, size_t n, double v)
+{
+    size_t count = 0;
+    while (count < n && sorted[count] <= v)
+        count++;
+    return (double)count / n;
+}
+
+static void test_histograms(void)
+{
+    size_t shape[] = {10000};
+    array arr;
+    arr_init(&arr, shape, 1, FLOAT);
+    arr_rng rng;
+    arr_rng_seed(&rng, 21);
+    arr_random_normal(&arr, &rng, 0, 2);
+    float special[] = {NAN, 4.0f, -4.0f, 100.0f};
+    size_t offsets[] = {0, 1, 2, 3};
+    arr_set_flat(&arr, offsets, 4, special);
+
+    // equal-width bins: [low + i * width, low + (i + 1) * width), the last one closed
+    uint64_t counts[16], expected[16] = {0};
+    arr_histogram_fixed(&arr, -4, 4, 16, counts);
+    for (size_t i = 0; i < arr.total_size; ++i)
+    {
+        double v = ((float*)arr.data)[i];
+        if (v >= -4 && v <= 4)
+            expected[v == 4 ? 15 : (size_t)((v + 4) / 0.5)]++;
+    }
+    CHECK(memcmp(counts, expected, sizeof(counts)) == 0);
+
+    double edges[] = {-10, -1, 0, 0.5, 4};
+    uint64_t edge_counts[4], edge_expected[4] = {0};
+    arr_histogram(&arr, edges, 4, edge_counts);
+    for (size_t i = 0; i < arr.total_size; ++i)
+    {
+        double v = ((float*)arr.data)[i];
+        for (size_t b = 0; b < 4; ++b)
+            if (v >= edges[b] && (v < edges[b + 1] || (b == 3 && v == edges[4])))
+            {
+                edge_expected[b]++;
+                break;
+            }
+    }
+    CHECK(memcmp(edge_counts, edge_expected, sizeof(edge_counts)) == 0);
+    arr_free(&arr);
+}
+
+static void check_exact(array* arr)
+{
+    double quantiles[] = {0.5, 0, 1, 0.25, 0.999, 0.001, 0.5, 0.75, 1.0 / 3};
+    size_t nq = sizeof(quantiles) / sizeof(quantiles[0]);
+    double out[sizeof(quantiles) / sizeof(quantiles[0])];
+    double* sorted;
+    size_t n = sorted_values(arr, &sorted);
+    arr_quantiles(arr, quantiles, nq, QUANTILE_EXACT, out);
+    for (size_t i = 0; i < nq; ++i)
+        CHECK(out[i] == reference_quantile(sorted, n, quantiles[i]));
+    free(sorted);
+}
+
+static void test_exact(void)
+{
+    arr_rng rng;
+    arr_rng_seed(&rng, 22);
+
+    size_t shape[] = {1001, 3};
+    array arr;
+    arr_init(&arr, shape, 2, FLOAT);
+    arr_random_uniform(&arr, &rng, -5, 5);
+    check_exact(&arr);
+    float nan = NAN;
+    size_t offsets[] = {17, 500};
+    float nans[] = {nan, nan};
+    arr_set_flat(&arr, offsets, 2, nans);
+    check_exact(&arr);
+    arr_free(&arr);
+
+    // many duplicates, compressed
+    size_t int_shape[] = {20000};
+    arr_init(&arr, int_shape, 1, INT32);
+    arr_random_int(&arr, &rng, 0, 9);
+    arr_compress(&arr);
+    check_exact(&arr);
+    arr_free(&arr);
+
+    size_t one[] = {1};
+    arr_init(&arr, one, 1, INT32);
+    int32_t seven = 7;
+    arr_fill(&arr, &seven);
+    check_exact(&arr);
+    arr_free(&arr);
+
+    // NaN for empty arrays
+    arr_arange(&arr, 0, 0, 1, FLOAT);
+    double q = 0.5, out = 0;
+    arr_quantiles(&arr, &q, 1, QUANTILE_EXACT, &out);
+    CHECK(isnan(out));
+    arr_quantiles(&arr, &q, 1, QUANTILE_SKETCH, &out);
+    CHECK(isnan(out));
+    arr_free(&arr);
+}
+
+static void test_sketch(void)
+{
+    size_t shape[] = {200000};
+    array arr;
+    arr_init(&arr, shape, 1, FLOAT);
+    arr_rng rng;
+    arr_rng_seed(&rng, 23);
+    arr_random_normal(&arr, &rng, 50, 10);
+    double* sorted;
+    size_t n = sorted_values(&arr, &sorted);
+
+    double quantiles[] = {0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 1};
+    size_t nq = sizeof(quantiles) / sizeof(quantiles[0]);
+    double out[sizeof(quantiles) / sizeof(quantiles[0])];
+
+    // arr_quantiles with a sketch: ranks within 2% and exact extremes
+    arr_quantiles(&arr, quantiles, nq, QUANTILE_SKETCH, out);
+    for (size_t i = 0; i < nq; ++i)
+        CHECK(fabs(rank_of(sorted, n, out[i]) - quantiles[i]) < 0.02);
+    CHECK(out[0] == sorted[0] && out[nq - 1] == sorted[n - 1]);
+
+    // four sketches over quarters of the array, merged, behave like one
+    arr_sketch* parts[4];
+    array quarters[4];
+    for (size_t p = 0; p < 4; ++p)
+    {
+        parts[p] = arr_sketch_new(0);
+        CHECK(parts[p] != NULL);
+        arr_view_rows(&arr, p * n / 4, (p + 1) * n / 4, &quarters[p]);
+        arr_sketch_add_array(parts[p], &quarters[p]);
+        arr_free(&quarters[p]);
+    }
+    for (size_t p = 1; p < 4; ++p)
+        arr_sketch_merge(parts[0], parts[p]);
+    CHECK(arr_sketch_count(parts[0]) == n);
+    CHECK(arr_sketch_count(parts[1]) == n / 4);
+    arr_sketch_quantiles(parts[0], quantiles, nq, out);
+    for (size_t i = 0; i < nq; ++i)
+        CHECK(fabs(rank_of(sorted, n, out[i]) - quantiles[i]) < 0.02);
+    CHECK(out[0] == sorted[0] && out[nq - 1] == sorted[n - 1]);
+    for (size_t p = 0; p < 4; ++p)
+        arr_sketch_free(parts[p]);
+
+    // single values, with NaN ignored
+    arr_sketch* sketch = arr_sketch_new(8);
+    for (int i = 1; i <= 100; ++i)
+        arr_sketch_add(sketch, i);
+    arr_sketch_add(sketch, NAN);
+    CHECK(arr_sketch_count(sketch) == 100);
+    double median;
+    double half = 0.5;
+    arr_sketch_quantiles(sketch, &half, 1, &median);
+    CHECK(median >= 35 && median <= 65);
+    arr_sketch_free(sketch);
+
+    free(sorted);
+    arr_free(&arr);
+}
+
+int main(void)
+{
+    test_histograms();
+    test_exact();
+    test_sketch();
+    return TEST_RESULT();
+}
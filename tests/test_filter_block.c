@@ -0,0 +1,123 @@
+// Block-callback filters (arr_filter_block) against the per-element arr_filter.
+
+#include "test_util.h"
+
+static size_t block_calls;
+static size_t block_rows;
+static size_t row_len;
+static bool masks_cleared;
+
+static bool is_even(void* value)
+{
+    return *(int32_t*)value % 2 == 0;
+}
+
+static void is_even_block(void* rows, size_t nrows, bool* mask)
+{
+    int32_t* values = rows;
+    block_calls++;
+    block_rows += nrows;
+    for (size_t i = 0; i < nrows * row_len; ++i)
+    {
+        masks_cleared &= !mask[i];
+        mask[i] = values[i] % 2 == 0;
+    }
+}
+
+static bool is_positive_float(void* value)
+{
+    return *(float*)value > 0;
+}
+
+static void is_positive_float_block(void* rows, size_t nrows, bool* mask)
+{
+    float* values = rows;
+    for (size_t i = 0; i < nrows * row_len; ++i)
+        mask[i] = values[i] > 0;
+}
+
+static void check_int(array* arr, size_t* cols, size_t ncols, filter_type ftype)
+{
+    array expected = {.data = NULL};
+    array actual = {.data = NULL};
+    row_len = arr->total_size / arr->arr_shape[0];
+    block_calls = 0;
+    block_rows = 0;
+    masks_cleared = true;
+    arr_filter(arr, &is_even, cols, ncols, ftype, &expected);
+    arr_filter_block(arr, &is_even_block, cols, ncols, ftype, &actual);
+    CHECK(test_arrays_equal(&expected, &actual));
+    CHECK(masks_cleared);
+    CHECK(block_rows == arr->arr_shape[0]);
+    // a callback per block of rows, not per element
+    CHECK(block_calls <= 1 + arr->total_size / 1024);
+
+    // a compressed destination is released and replaced like a plain one
+    arr_compress(&expected);
+    arr_compress(&actual);
+    CHECK(expected.packed != NULL && actual.packed != NULL);
+    arr_filter(arr, &is_even, cols, ncols, ftype, &expected);
+    arr_filter_block(arr, &is_even_block, cols, ncols, ftype, &actual);
+    CHECK(expected.packed == NULL && actual.packed == NULL);
+    CHECK(test_arrays_equal(&expected, &actual));
+    arr_free(&expected);
+    arr_free(&actual);
+}
+
+static void test_int(void)
+{
+    size_t shape[] = {10000, 4};
+    array arr;
+    arr_init(&arr, shape, 2, INT32);
+    arr_rng rng;
+    arr_rng_seed(&rng, 3);
+    arr_random_int(&arr, &rng, 0, 9);
+
+    size_t cols[] = {1, 3};
+    check_int(&arr, NULL, 0, ANY);
+    check_int(&arr, NULL, 0, ALL);
+    check_int(&arr, cols, 2, ANY);
+    check_int(&arr, cols, 2, ALL);
+
+    arr_compress(&arr);
+    check_int(&arr, cols, 2, ALL);
+    arr_free(&arr);
+
+    size_t shape1[] = {3001};
+    arr_init(&arr, shape1, 1, INT32);
+    arr_random_int(&arr, &rng, -50, 50);
+    check_int(&arr, NULL, 0, ANY);
+    arr_free(&arr);
+
+    size_t shape3[] = {500, 3, 2};
+    arr_init(&arr, shape3, 3, INT32);
+    arr_random_int(&arr, &rng, 0, 100);
+    check_int(&arr, NULL, 0, ANY);
+    check_int(&arr, cols, 1, ALL);
+    arr_free(&arr);
+}
+
+static void test_float(void)
+{
+    size_t shape[] = {2500, 3};
+    array arr, expected = {.data = NULL}, actual = {.data = NULL};
+    arr_init(&arr, shape, 2, FLOAT);
+    arr_rng rng;
+    arr_rng_seed(&rng, 4);
+    arr_random_uniform(&arr, &rng, -1.0, 3.0);
+    row_len = 3;
+    arr_filter(&arr, &is_positive_float, NULL, 0, ALL, &expected);
+    arr_filter_block(&arr, &is_positive_float_block, NULL, 0, ALL, &actual);
+    CHECK(expected.arr_shape[0] > 0);
+    CHECK(test_arrays_equal(&expected, &actual));
+    arr_free(&arr);
+    arr_free(&expected);
+    arr_free(&actual);
+}
+
+int main(void)
+{
+    test_int();
+    test_float();
+    return TEST_RESULT();
+}
@@ -0,0 +1,156 @@
+// Growable arrays: appends, reserved and geometric capacity, concatenation, and the zone map following new rows.
+
+#include "test_util.h"
+
+// a rows x 3 int32 array whose element (r, c) is (first + r) * 10 + c
+static void make_rows(array* arr, size_t rows, size_t first)
+{
+    size_t shape[] = {rows, 3};
+    arr_init(arr, shape, 2, INT32);
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t c = 0; c < 3; ++c)
+            ((int32_t*)arr->data)[r * 3 + c] = (int32_t)((first + r) * 10 + c);
+}
+
+static bool rows_in_order(array* arr)
+{
+    for (size_t i = 0; i < arr->total_size; ++i)
+    {
+        size_t offset = i;
+        int32_t v;
+        arr_get_flat(arr, &offset, 1, &v);
+        if (v != (int32_t)((i / 3) * 10 + i % 3))
+            return false;
+    }
+    return true;
+}
+
+static void test_append(void)
+{
+    array arr, row;
+    make_rows(&arr, 1, 0);
+
+    // one row at a time: the capacity at least doubles, so it changes only a logarithmic number of times
+    size_t growths = 0;
+    for (size_t r = 1; r < 1000; ++r)
+    {
+        size_t capacity = arr.capacity;
+        make_rows(&row, 1, r);
+        arr_append_rows(&arr, &row);
+        arr_free(&row);
+        growths += arr.capacity != capacity;
+        CHECK(arr.capacity >= arr.arr_shape[0]);
+    }
+    CHECK(arr.arr_shape[0] == 1000 && arr.total_size == 3000);
+    CHECK(growths <= 11);
+    CHECK(rows_in_order(&arr));
+
+    // several rows at once
+    make_rows(&row, 500, 1000);
+    arr_append_rows(&arr, &row);
+    arr_free(&row);
+    CHECK(arr.arr_shape[0] == 1500);
+    CHECK(rows_in_order(&arr));
+
+    arr_shrink_to_fit(&arr);
+    CHECK(arr.capacity == 1500);
+    CHECK(rows_in_order(&arr));
+
+    // rows of the wrong shape or type are ignored
+    size_t bad_shape[] = {2, 4};
+    array bad;
+    arr_zeros(&bad, bad_shape, 2, INT32);
+    arr_append_rows(&arr, &bad);
+    arr_free(&bad);
+    size_t float_shape[] = {2, 3};
+    arr_zeros(&bad, float_shape, 2, FLOAT);
+    arr_append_rows(&arr, &bad);
+    arr_free(&bad);
+    CHECK(arr.arr_shape[0] == 1500);
+
+    arr_free(&arr);
+}
+
+static void test_reserve(void)
+{
+    array arr, row;
+    make_rows(&arr, 2, 0);
+    arr_reserve(&arr, 100);
+    CHECK(arr.capacity >= 100 && arr.arr_shape[0] == 2);
+    CHECK(rows_in_order(&arr));
+
+    // appends within the reserved capacity don't move the data
+    void* data = arr.data;
+    for (size_t r = 2; r < 100; ++r)
+    {
+        make_rows(&row, 1, r);
+        arr_append_rows(&arr, &row);
+        arr_free(&row);
+    }
+    CHECK(arr.data == data);
+    CHECK(rows_in_order(&arr));
+    arr_free(&arr);
+}
+
+static void test_compressed(void)
+{
+    // appending to and from compressed arrays
+    array arr, rows;
+    make_rows(&arr, 1000, 0);
+    arr_compress(&arr);
+    make_rows(&rows, 1000, 1000);
+    arr_compress(&rows);
+    arr_append_rows(&arr, &rows);
+    CHECK(arr.arr_shape[0] == 2000);
+    CHECK(rows_in_order(&arr));
+    arr_free(&arr);
+    arr_free(&rows);
+}
+
+static void test_concatenate(void)
+{
+    array first, second, joined, expected;
+    make_rows(&first, 700, 0);
+    make_rows(&second, 300, 700);
+    make_rows(&expected, 1000, 0);
+    arr_concatenate(&first, &second, &joined);
+    CHECK(test_arrays_equal(&joined, &expected));
+    arr_free(&first);
+    arr_free(&second);
+    arr_free(&joined);
+    arr_free(&expected);
+}
+
+static void test_zone_map_follows(void)
+{
+    // the partial last block and the new blocks are rescanned after an append
+    array arr, rows, filtered = {.data = NULL};
+    make_rows(&arr, 1500, 0);
+    arr_zone_map_build(&arr);
+    arr_aggregate_cache(&arr, true);
+    arr_sum(&arr);
+    make_rows(&rows, 1500, 1500);
+    arr_append_rows(&arr, &rows);
+
+    size_t col0[] = {0};
+    arr_filter_range(&arr, 14000, 16000, col0, 1, ANY, &filtered);
+    CHECK(filtered.arr_shape[0] == 201);
+    arr_free(&filtered);
+
+    array expected;
+    make_rows(&expected, 3000, 0);
+    CHECK(arr_sum(&arr) == arr_sum(&expected));
+    arr_free(&expected);
+    arr_free(&arr);
+    arr_free(&rows);
+}
+
+int main(void)
+{
+    test_append();
+    test_reserve();
+    test_compressed();
+    test_concatenate();
+    test_zone_map_follows();
+    return TEST_RESULT();
+}
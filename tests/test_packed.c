@@ -0,0 +1,151 @@
+// Compressed (packed) int32 storage: round trips for every encoding, reads straight from compressed arrays, and
+// writes and saves that go through decompression.
+
+#include "test_util.h"
+
+// fills arr with one of these patterns, each favouring a different block encoding: 0 small range, 1 sorted,
+// 2 few distinct values, 3 full width, 4 constant, 5 random
+static void fill_pattern(array* arr, int pattern)
+{
+    int32_t distinct[] = {-1000000000, 7, 123456789};
+    arr_rng rng;
+    arr_rng_seed(&rng, 42);
+    for (size_t i = 0; i < arr->total_size; ++i)
+    {
+        int32_t v = 0;
+        switch (pattern)
+        {
+            case 0: v = (int32_t)(i % 16); break;
+            case 1: v = 1000000 + 3 * (int32_t)i; break;
+            case 2: v = distinct[arr_rng_next(&rng) % 3]; break;
+            case 3: v = i % 2 ? INT32_MAX : INT32_MIN; break;
+            case 4: v = -5; break;
+            case 5: v = (int32_t)arr_rng_next(&rng); break;
+        }
+        ((int32_t*)arr->data)[i] = v;
+    }
+}
+
+static void make_pattern(array* arr, size_t* shape, size_t shape_size, int pattern)
+{
+    arr_init(arr, shape, shape_size, INT32);
+    fill_pattern(arr, pattern);
+}
+
+static void check_pattern(size_t* shape, size_t shape_size, int pattern)
+{
+    array plain, packed;
+    make_pattern(&plain, shape, shape_size, pattern);
+    make_pattern(&packed, shape, shape_size, pattern);
+    arr_compress(&packed);
+
+    // patterns that can't shrink stay plain; everything else is compressed and smaller
+    if (pattern != 3 && pattern != 5 && plain.total_size >= 64)
+    {
+        CHECK(packed.packed != NULL && packed.data == NULL);
+        CHECK(arr_storage_bytes(&packed) < arr_storage_bytes(&plain));
+    }
+
+    CHECK(test_arrays_equal(&plain, &packed));
+    CHECK(arr_sum(&plain) == arr_sum(&packed));
+
+    // random access, visiting the blocks out of order
+    size_t* index = malloc(sizeof(size_t) * shape_size);
+    for (size_t k = 0; k < 200; ++k)
+    {
+        size_t offset = (k * 7919) % plain.total_size;
+        for (size_t d = shape_size; d-- > 0;)
+        {
+            index[d] = offset % shape[d];
+            offset /= shape[d];
+        }
+        CHECK(*(int32_t*)arr_at(&plain, index) == *(int32_t*)arr_at(&packed, index));
+    }
+    free(index);
+
+    array expected = {.data = NULL};
+    array actual = {.data = NULL};
+    arr_filter_range(&plain, 0, 1000000000, NULL, 0, ANY, &expected);
+    arr_filter_range(&packed, 0, 1000000000, NULL, 0, ANY, &actual);
+    CHECK(test_arrays_equal(&expected, &actual));
+    arr_free(&expected);
+    arr_free(&actual);
+
+    arr_decompress(&packed);
+    CHECK(packed.packed == NULL && packed.data != NULL);
+    CHECK(test_arrays_equal(&plain, &packed));
+
+    arr_free(&plain);
+    arr_free(&packed);
+}
+
+static void test_round_trips(void)
+{
+    size_t sizes[] = {1, 63, 1024, 2500, 10000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        for (int pattern = 0; pattern < 6; ++pattern)
+        {
+            size_t shape1[] = {sizes[s]};
+            check_pattern(shape1, 1, pattern);
+            size_t shape3[] = {sizes[s], 3, 2};
+            check_pattern(shape3, 3, pattern);
+        }
+}
+
+static void test_writes_decompress(void)
+{
+    size_t shape[] = {5000, 2};
+    array arr;
+    make_pattern(&arr, shape, 2, 0);
+    arr_compress(&arr);
+    CHECK(arr.packed != NULL);
+
+    size_t idx[] = {4000, 1};
+    int32_t v = 99;
+    arr_set(&arr, idx, &v);
+    CHECK(arr.packed == NULL);
+    CHECK(*(int32_t*)arr_at(&arr, idx) == 99);
+    idx[0] = 3999;
+    CHECK(*(int32_t*)arr_at(&arr, idx) == (int32_t)((3999 * 2 + 1) % 16));
+
+    arr_compress(&arr);
+    v = 3;
+    arr_fill(&arr, &v);
+    CHECK(arr.packed == NULL);
+    CHECK(arr_sum(&arr) == 3.0f * 10000);
+
+    // FLOAT arrays are left as they are
+    array floats;
+    arr_zeros(&floats, shape, 2, FLOAT);
+    arr_compress(&floats);
+    CHECK(floats.packed == NULL && floats.data != NULL);
+
+    arr_free(&arr);
+    arr_free(&floats);
+}
+
+static void test_save_load(void)
+{
+    const char* path = "test_packed.zmp";
+    size_t shape[] = {3000, 4};
+    array plain, packed, loaded;
+    make_pattern(&plain, shape, 2, 1);
+    make_pattern(&packed, shape, 2, 1);
+    arr_compress(&packed);
+    arr_zone_map_build(&packed);
+    CHECK(arr_save(&packed, path));
+    CHECK(arr_load(&loaded, path));
+    CHECK(test_arrays_equal(&plain, &loaded));
+    arr_free(&plain);
+    arr_free(&packed);
+    arr_free(&loaded);
+    remove(path);
+}
+
+int main(void)
+{
+    test_round_trips();
+    test_writes_decompress();
+    test_save_load();
+    return TEST_RESULT();
+}
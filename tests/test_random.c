@@ -0,0 +1,186 @@
+// Random fills (reproducibility, streams, ranges and distribution moments), the zeros/arange/linspace constructors
+// and arr_fill.
+
+#include "test_util.h"
+#include <math.h>
+
+#define SAMPLES 100001 // not a multiple of the generator's block size
+
+static double mean_of(array* arr)
+{
+    arr_aggregates agg;
+    arr_aggregates_get(arr, &agg);
+    return agg.sum / agg.count;
+}
+
+static double stddev_of(array* arr)
+{
+    double mean = mean_of(arr);
+    double sq = 0.0;
+    for (size_t i = 0; i < arr->total_size; ++i)
+    {
+        double d = (arr->dtype == INT32 ? ((int32_t*)arr->data)[i] : ((float*)arr->data)[i]) - mean;
+        sq += d * d;
+    }
+    return sqrt(sq / arr->total_size);
+}
+
+static void test_generator(void)
+{
+    arr_rng a, b;
+    arr_rng_seed(&a, 123);
+    arr_rng_seed(&b, 123);
+    bool same = true;
+    for (int i = 0; i < 1000; ++i)
+        same &= arr_rng_next(&a) == arr_rng_next(&b);
+    CHECK(same);
+
+    arr_rng_seed(&b, 124);
+    CHECK(arr_rng_next(&a) != arr_rng_next(&b));
+
+    // stream n is the seeded generator jumped n times
+    arr_rng_seed(&a, 9);
+    arr_rng_jump(&a);
+    arr_rng_jump(&a);
+    arr_rng_stream(&b, 9, 2);
+    CHECK(memcmp(&a, &b, sizeof(arr_rng)) == 0);
+    arr_rng_stream(&a, 9, 3);
+    CHECK(arr_rng_next(&a) != arr_rng_next(&b));
+}
+
+static void test_random_int(void)
+{
+    size_t shape[] = {SAMPLES};
+    array arr, again;
+    arr_init(&arr, shape, 1, INT32);
+    arr_init(&again, shape, 1, INT32);
+    arr_rng rng;
+    arr_rng_seed(&rng, 5);
+    arr_random_int(&arr, &rng, -2, 1);
+    arr_rng_seed(&rng, 5);
+    arr_random_int(&again, &rng, -2, 1);
+    CHECK(test_arrays_equal(&arr, &again));
+
+    // both bounds are included and every value is about equally likely
+    size_t counts[4] = {0};
+    bool in_range = true;
+    for (size_t i = 0; i < arr.total_size; ++i)
+    {
+        int32_t v = ((int32_t*)arr.data)[i];
+        in_range &= v >= -2 && v <= 1;
+        if (v >= -2 && v <= 1)
+            counts[v + 2]++;
+    }
+    CHECK(in_range);
+    for (int i = 0; i < 4; ++i)
+        CHECK(fabs(counts[i] / (double)SAMPLES - 0.25) < 0.01);
+
+    // the full int32 range, and low > high leaving the array as it was
+    arr_random_int(&arr, &rng, INT32_MIN, INT32_MAX);
+    CHECK(fabs(mean_of(&arr)) < 0.02 * (double)INT32_MAX);
+    int32_t seven = 7;
+    arr_fill(&arr, &seven);
+    arr_random_int(&arr, &rng, 10, 9);
+    CHECK(arr_sum(&arr) == 7.0f * SAMPLES);
+
+    // FLOAT arrays get whole numbers
+    array floats;
+    arr_init(&floats, shape, 1, FLOAT);
+    arr_random_int(&floats, &rng, 0, 10);
+    bool whole = true;
+    for (size_t i = 0; i < floats.total_size; ++i)
+        whole &= ((float*)floats.data)[i] == floorf(((float*)floats.data)[i]) && ((float*)floats.data)[i] <= 10;
+    CHECK(whole);
+
+    arr_free(&arr);
+    arr_free(&again);
+    arr_free(&floats);
+}
+
+static void test_distributions(void)
+{
+    size_t shape[] = {SAMPLES};
+    array arr;
+    arr_init(&arr, shape, 1, FLOAT);
+    arr_rng rng;
+    arr_rng_seed(&rng, 77);
+
+    arr_random_uniform(&arr, &rng, -1.0, 3.0);
+    arr_aggregates agg;
+    arr_aggregates_get(&arr, &agg);
+    CHECK(agg.min >= -1.0 && agg.max < 3.0);
+    CHECK(fabs(agg.sum / agg.count - 1.0) < 0.02);
+    CHECK(fabs(stddev_of(&arr) - 4.0 / sqrt(12.0)) < 0.02);
+
+    arr_random_normal(&arr, &rng, 10.0, 2.0);
+    CHECK(fabs(mean_of(&arr) - 10.0) < 0.03);
+    CHECK(fabs(stddev_of(&arr) - 2.0) < 0.03);
+
+    arr_random_bernoulli(&arr, &rng, 0.3);
+    bool binary = true;
+    for (size_t i = 0; i < arr.total_size; ++i)
+        binary &= ((float*)arr.data)[i] == 0.0f || ((float*)arr.data)[i] == 1.0f;
+    CHECK(binary);
+    CHECK(fabs(mean_of(&arr) - 0.3) < 0.01);
+
+    // p is clamped
+    arr_random_bernoulli(&arr, &rng, 2.0);
+    CHECK(arr_sum(&arr) == SAMPLES);
+    arr_random_bernoulli(&arr, &rng, -1.0);
+    CHECK(arr_sum(&arr) == 0.0f);
+
+    // fills decompress compressed arrays first
+    array ints;
+    arr_zeros(&ints, shape, 1, INT32);
+    arr_compress(&ints);
+    arr_random_uniform(&ints, &rng, 0.0, 5.0);
+    CHECK(ints.packed == NULL);
+    arr_aggregates_get(&ints, &agg);
+    CHECK(agg.min == 0.0 && agg.max == 4.0);
+
+    arr_free(&arr);
+    arr_free(&ints);
+}
+
+static void test_constructors(void)
+{
+    size_t shape[] = {300, 7};
+    array arr;
+    arr_zeros(&arr, shape, 2, FLOAT);
+    arr_aggregates agg;
+    arr_aggregates_get(&arr, &agg);
+    CHECK(agg.count == 2100 && agg.min == 0.0 && agg.max == 0.0);
+    float v = 1.5f;
+    arr_fill(&arr, &v);
+    CHECK(arr_sum(&arr) == 1.5f * 2100);
+    arr_free(&arr);
+
+    arr_arange(&arr, 0, 10, 2, INT32);
+    int32_t expected_ints[] = {0, 2, 4, 6, 8};
+    CHECK(arr.shape_size == 1 && arr.total_size == 5 && memcmp(arr.data, expected_ints, sizeof(expected_ints)) == 0);
+    arr_free(&arr);
+
+    arr_arange(&arr, 1, -1, -0.5, FLOAT);
+    float expected_floats[] = {1.0f, 0.5f, 0.0f, -0.5f};
+    CHECK(arr.total_size == 4 && memcmp(arr.data, expected_floats, sizeof(expected_floats)) == 0);
+    arr_free(&arr);
+
+    // a step away from stop gives an empty array
+    arr_arange(&arr, 0, 10, -1, INT32);
+    CHECK(arr.shape_size == 1 && arr.arr_shape[0] == 0 && arr.total_size == 0);
+    arr_free(&arr);
+
+    arr_linspace(&arr, 0, 1, 5, FLOAT);
+    float expected_space[] = {0.0f, 0.25f, 0.5f, 0.75f, 1.0f};
+    CHECK(arr.total_size == 5 && memcmp(arr.data, expected_space, sizeof(expected_space)) == 0);
+    arr_free(&arr);
+}
+
+int main(void)
+{
+    test_generator();
+    test_random_int();
+    test_distributions();
+    test_constructors();
+    return TEST_RESULT();
+}
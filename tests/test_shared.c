@@ -0,0 +1,198 @@
+// Shared-memory arrays across processes: create/attach, writes seen by the other process, read-only attachments
+// copying on write, the cross-process lock, and zone maps noticing another process's writes.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "test_util.h"
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static char name[64];
+
+// runs child(arg) in a forked process and returns whether it exited with 0
+static bool run_child(bool (*child)(void*), void* arg)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(child(arg) ? 0 : 1);
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool child_fill(void* arg)
+{
+    (void)arg;
+    array arr;
+    if (!arr_attach_shared(&arr, name, true) || !arr_is_shared_memory(&arr))
+        return false;
+    arr_shared_lock(&arr, true);
+    float v = 5;
+    arr_fill(&arr, &v);
+    arr_shared_unlock(&arr, true);
+    arr_free(&arr);
+    return true;
+}
+
+static bool child_read_only_write(void* arg)
+{
+    (void)arg;
+    array arr;
+    if (!arr_attach_shared(&arr, name, false))
+        return false;
+    size_t idx[] = {0, 0};
+    float v = -100;
+    arr_set(&arr, idx, &v);
+    bool ok = !arr_is_shared_memory(&arr) && *(float*)arr_at(&arr, idx) == -100;
+    arr_free(&arr);
+    return ok;
+}
+
+// takes the lock shared, then reports the sum it saw through the pipe
+static bool child_locked_sum(void* arg)
+{
+    int* fds = arg;
+    array arr;
+    if (!arr_attach_shared(&arr, name, false))
+        return false;
+    arr_shared_lock(&arr, false);
+    float sum = arr_sum(&arr);
+    arr_shared_unlock(&arr, false);
+    arr_free(&arr);
+    return write(fds[1], &sum, sizeof(sum)) == sizeof(sum);
+}
+
+static void test_attach(void)
+{
+    size_t shape[] = {3000, 4};
+    array arr;
+    CHECK(arr_create_shared(&arr, name, shape, 2, FLOAT));
+    CHECK(arr_is_shared_memory(&arr));
+    CHECK(arr_sum(&arr) == 0);
+
+    array again;
+    CHECK(!arr_create_shared(&again, name, shape, 2, FLOAT));
+    CHECK(!arr_attach_shared(&again, "/zumpy_test_missing", false));
+
+    // the parent's zone map is built before the other process writes
+    array filtered = {.data = NULL};
+    arr_filter_range(&arr, 5, 5, NULL, 0, ALL, &filtered);
+    CHECK(filtered.total_size == 0);
+    arr_free(&filtered);
+
+    CHECK(run_child(&child_fill, NULL));
+    CHECK(arr_sum(&arr) == 5.0f * 12000);
+    arr_filter_range(&arr, 5, 5, NULL, 0, ALL, &filtered);
+    CHECK(filtered.arr_shape[0] == 3000);
+    arr_free(&filtered);
+
+    // a read-only attachment writes to a private copy
+    CHECK(run_child(&child_read_only_write, NULL));
+    size_t idx[] = {0, 0};
+    CHECK(*(float*)arr_at(&arr, idx) == 5);
+
+    // attachments keep working after the name is removed
+    array attached;
+    CHECK(arr_attach_shared(&attached, name, false));
+    CHECK(arr_unlink_shared(name));
+    CHECK(!arr_unlink_shared(name));
+    CHECK(arr_sum(&attached) == 5.0f * 12000);
+    arr_free(&attached);
+
+    // growing moves the array into private memory
+    array rows;
+    size_t row_shape[] = {1, 4};
+    arr_zeros(&rows, row_shape, 2, FLOAT);
+    arr_append_rows(&arr, &rows);
+    CHECK(!arr_is_shared_memory(&arr) && arr.arr_shape[0] == 3001);
+    CHECK(!arr_shared_lock(&arr, true));
+    arr_free(&rows);
+    arr_free(&arr);
+}
+
+static void test_lock(void)
+{
+    size_t shape[] = {100};
+    array arr;
+    CHECK(arr_create_shared(&arr, name, shape, 1, FLOAT));
+
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    // the reader can't get in while this process holds the lock exclusively
+    CHECK(arr_shared_lock(&arr, true));
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(child_locked_sum(fds) ? 0 : 1);
+
+    struct timespec pause = {0, 100 * 1000 * 1000};
+    nanosleep(&pause, NULL);
+    float sum;
+    CHECK(read(fds[0], &sum, sizeof(sum)) < 0);
+    float v = 2;
+    arr_fill(&arr, &v);
+    arr_shared_unlock(&arr, true);
+
+    int status;
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(read(fds[0], &sum, sizeof(sum)) == sizeof(sum) && sum == 200);
+
+    // readers share the lock, so the child gets it while this process holds it too
+    CHECK(arr_shared_lock(&arr, false));
+    CHECK(run_child(&child_locked_sum, fds));
+    arr_shared_unlock(&arr, false);
+    CHECK(read(fds[0], &sum, sizeof(sum)) == sizeof(sum) && sum == 200);
+    close(fds[0]);
+    close(fds[1]);
+
+    arr_free(&arr);
+    arr_unlink_shared(name);
+}
+
+static void test_write_after_share(void)
+{
+    // writes through a share or a row view of a writable segment go to the segment, not to a private copy
+    size_t shape[] = {100, 2};
+    array arr, view, rows, attached;
+    CHECK(arr_create_shared(&arr, name, shape, 2, INT32));
+    arr_share(&arr, &view);
+    arr_view_rows(&arr, 50, 100, &rows);
+
+    CHECK(arr_shared_lock(&arr, true));
+    size_t idx[] = {0, 0};
+    int32_t v = 42;
+    arr_set(&arr, idx, &v);
+    v = 7;
+    arr_fill(&rows, &v);
+    size_t offsets[] = {1};
+    int32_t w = 9;
+    CHECK(arr_set_flat(&view, offsets, 1, &w) == 0);
+    arr_shared_unlock(&arr, true);
+    CHECK(arr_is_shared_memory(&arr) && arr_is_shared_memory(&view) && arr_is_shared_memory(&rows));
+    CHECK(arr.data == view.data);
+
+    CHECK(arr_attach_shared(&attached, name, false));
+    CHECK(*(int32_t*)arr_at(&attached, idx) == 42);
+    idx[1] = 1;
+    CHECK(*(int32_t*)arr_at(&attached, idx) == 9);
+    CHECK(arr_sum(&attached) == 42 + 9 + 7 * 100);
+    CHECK(arr_sum(&view) == 42 + 9 + 7 * 100);
+
+    arr_free(&attached);
+    arr_free(&rows);
+    arr_free(&view);
+    arr_free(&arr);
+    arr_unlink_shared(name);
+}
+
+int main(void)
+{
+    snprintf(name, sizeof(name), "/zumpy_test_%ld", (long)getpid());
+    test_attach();
+    test_lock();
+    test_write_after_share();
+    arr_unlink_shared(name);
+    return TEST_RESULT();
+}
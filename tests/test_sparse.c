@@ -0,0 +1,178 @@
+// Sparse arrays against the dense arrays they represent: conversions, sums, row filters and matmul.
+
+#include "test_util.h"
+
+#define ROWS 50
+#define COLS 30
+
+// a ROWS x COLS int32 array with roughly one entry in ten non-zero
+static void make_dense(array* arr)
+{
+    size_t shape[] = {ROWS, COLS};
+    arr_zeros(arr, shape, 2, INT32);
+    arr_rng rng;
+    arr_rng_seed(&rng, 11);
+    for (size_t i = 0; i < arr->total_size; ++i)
+        if (arr_rng_next(&rng) % 10 == 0)
+            ((int32_t*)arr->data)[i] = (int32_t)(arr_rng_next(&rng) % 201) - 100;
+}
+
+static bool positive(void* value)
+{
+    return *(int32_t*)value > 0;
+}
+
+static bool not_positive(void* value)
+{
+    return *(int32_t*)value <= 0;
+}
+
+static void test_conversions(void)
+{
+    array dense, back;
+    sparse_array sp;
+    make_dense(&dense);
+    sparse_from_dense(&dense, &sp);
+    CHECK(sp.format == CSR);
+
+    size_t nnz = 0;
+    for (size_t i = 0; i < dense.total_size; ++i)
+        nnz += ((int32_t*)dense.data)[i] != 0;
+    CHECK(sp.nnz == nnz);
+
+    sparse_to_dense(&sp, &back);
+    CHECK(test_arrays_equal(&dense, &back));
+    CHECK(sparse_sum(&sp) == arr_sum(&dense));
+
+    // duplicates inserted in COO are added together by the CSR conversion
+    sparse_array coo;
+    sparse_init(&coo, 3, 3, INT32);
+    int32_t values[] = {4, 5, -2};
+    sparse_insert(&coo, 2, 1, &values[0]);
+    sparse_insert(&coo, 0, 0, &values[1]);
+    sparse_insert(&coo, 2, 1, &values[2]);
+    sparse_to_csr(&coo);
+    CHECK(coo.nnz == 2);
+    array small;
+    sparse_to_dense(&coo, &small);
+    size_t idx[] = {2, 1};
+    CHECK(*(int32_t*)arr_at(&small, idx) == 2);
+    idx[0] = 0;
+    idx[1] = 0;
+    CHECK(*(int32_t*)arr_at(&small, idx) == 5);
+
+    arr_free(&dense);
+    arr_free(&back);
+    arr_free(&small);
+    sparse_free(&sp);
+    sparse_free(&coo);
+}
+
+static void test_sum_axis(void)
+{
+    array dense, col_sums, row_sums;
+    sparse_array sp;
+    make_dense(&dense);
+    sparse_from_dense(&dense, &sp);
+    sparse_sum_axis(&sp, 0, &col_sums);
+    sparse_sum_axis(&sp, 1, &row_sums);
+    CHECK(col_sums.total_size == COLS && row_sums.total_size == ROWS);
+
+    for (size_t c = 0; c < COLS; ++c)
+    {
+        float sum = 0;
+        for (size_t r = 0; r < ROWS; ++r)
+            sum += ((int32_t*)dense.data)[r * COLS + c];
+        CHECK(((float*)col_sums.data)[c] == sum);
+    }
+    for (size_t r = 0; r < ROWS; ++r)
+    {
+        float sum = 0;
+        for (size_t c = 0; c < COLS; ++c)
+            sum += ((int32_t*)dense.data)[r * COLS + c];
+        CHECK(((float*)row_sums.data)[r] == sum);
+    }
+
+    arr_free(&dense);
+    arr_free(&col_sums);
+    arr_free(&row_sums);
+    sparse_free(&sp);
+}
+
+// sparse_filter must keep the same rows as arr_filter on the dense array, implicit zeros included
+static void check_filter(bool (*filter)(void*), size_t* cols, size_t ncols, filter_type ftype)
+{
+    array dense, expected = {.data = NULL}, actual;
+    sparse_array sp, filtered = {.values = NULL};
+    make_dense(&dense);
+    sparse_from_dense(&dense, &sp);
+    arr_filter(&dense, filter, cols, ncols, ftype, &expected);
+    sparse_filter(&sp, filter, cols, ncols, ftype, &filtered);
+    sparse_to_dense(&filtered, &actual);
+    CHECK(expected.arr_shape[0] > 0);
+    CHECK(test_arrays_equal(&expected, &actual));
+    arr_free(&dense);
+    arr_free(&expected);
+    arr_free(&actual);
+    sparse_free(&sp);
+    sparse_free(&filtered);
+}
+
+static void test_filter(void)
+{
+    size_t cols[] = {0, 3, 29};
+    check_filter(&positive, NULL, 0, ANY);
+    check_filter(&positive, cols, 3, ANY);
+    check_filter(&not_positive, NULL, 0, ALL);
+    check_filter(&not_positive, cols, 3, ALL);
+}
+
+static void test_matmul(void)
+{
+    array dense, vec, mat, vec_result, mat_result;
+    sparse_array sp;
+    make_dense(&dense);
+    sparse_from_dense(&dense, &sp);
+
+    size_t vec_shape[] = {COLS};
+    arr_arange(&vec, 0, COLS, 1, FLOAT);
+    size_t mat_shape[] = {COLS, 4};
+    arr_init(&mat, mat_shape, 2, FLOAT);
+    for (size_t i = 0; i < mat.total_size; ++i)
+        ((float*)mat.data)[i] = (float)(i % 7) - 3;
+
+    sparse_matmul(&sp, &vec, &vec_result);
+    sparse_matmul(&sp, &mat, &mat_result);
+    CHECK(vec_result.total_size == ROWS && mat_result.total_size == ROWS * 4);
+
+    for (size_t r = 0; r < ROWS; ++r)
+    {
+        float expected = 0;
+        for (size_t c = 0; c < vec_shape[0]; ++c)
+            expected += ((int32_t*)dense.data)[r * COLS + c] * ((float*)vec.data)[c];
+        CHECK(((float*)vec_result.data)[r] == expected);
+        for (size_t k = 0; k < 4; ++k)
+        {
+            expected = 0;
+            for (size_t c = 0; c < COLS; ++c)
+                expected += ((int32_t*)dense.data)[r * COLS + c] * ((float*)mat.data)[c * 4 + k];
+            CHECK(((float*)mat_result.data)[r * 4 + k] == expected);
+        }
+    }
+
+    arr_free(&dense);
+    arr_free(&vec);
+    arr_free(&mat);
+    arr_free(&vec_result);
+    arr_free(&mat_result);
+    sparse_free(&sp);
+}
+
+int main(void)
+{
+    test_conversions();
+    test_sum_axis();
+    test_filter();
+    test_matmul();
+    return TEST_RESULT();
+}
@@ -0,0 +1,86 @@
+// Instrumentation counters. Built twice: against the library (counters compiled in only with ZUMPY_STATS) and, as
+// stats_enabled, from the sources with ZUMPY_STATS defined, so both the zero-cost and the counting builds are tested.
+
+#include "test_util.h"
+#include <pthread.h>
+
+static void* sum_on_thread(void* arg)
+{
+    arr_sum(arg);
+    return NULL;
+}
+
+static void test_names(void)
+{
+    CHECK(arr_stats_op_count() == STAT_OP_COUNT);
+    for (size_t op = 0; op < arr_stats_op_count(); ++op)
+        CHECK(arr_stats_op_name(op) != NULL);
+    CHECK(arr_stats_op_name(STAT_OP_COUNT) == NULL);
+    CHECK(strcmp(arr_stats_op_name(STAT_ARR_SUM), "arr_sum") == 0);
+}
+
+static void test_counters(void)
+{
+#ifdef ZUMPY_STATS
+    CHECK(arr_stats_enabled());
+#else
+    CHECK(!arr_stats_enabled());
+#endif
+
+    arr_stats_reset();
+    arr_stats before;
+    arr_stats_get(&before);
+
+    size_t shape[] = {1000, 10};
+    size_t bytes = 1000 * 10 * sizeof(int32_t);
+    array arr, view;
+    arr_init(&arr, shape, 2, INT32);
+    int32_t v = 1;
+    arr_fill(&arr, &v);
+    arr_sum(&arr);
+
+    // counts from other threads are added in
+    pthread_t thread;
+    pthread_create(&thread, NULL, &sum_on_thread, &arr);
+    pthread_join(thread, NULL);
+
+    // a share is one allocation until it is written
+    arr_share(&arr, &view);
+
+    arr_stats during;
+    arr_stats_get(&during);
+    arr_free(&arr);
+    arr_free(&view);
+    arr_stats after;
+    arr_stats_get(&after);
+
+    if (!arr_stats_enabled())
+    {
+        for (size_t op = 0; op < STAT_OP_COUNT; ++op)
+            CHECK(during.ops[op].calls == 0 && during.ops[op].bytes == 0 && during.ops[op].nanoseconds == 0);
+        CHECK(during.live_bytes == 0 && during.peak_bytes == 0 && during.allocations == 0);
+        return;
+    }
+
+    CHECK(during.ops[STAT_ARR_INIT].calls == 1);
+    CHECK(during.ops[STAT_ARR_FILL].calls == 1 && during.ops[STAT_ARR_FILL].bytes == bytes);
+    CHECK(during.ops[STAT_ARR_SUM].calls == 2 && during.ops[STAT_ARR_SUM].bytes == 2 * bytes);
+    CHECK(during.allocations == 1);
+    CHECK(during.live_bytes == before.live_bytes + bytes);
+    CHECK(during.peak_bytes >= during.live_bytes);
+    CHECK(after.ops[STAT_ARR_FREE].calls == 2);
+    CHECK(after.live_bytes == before.live_bytes);
+
+    arr_stats_reset();
+    arr_stats reset;
+    arr_stats_get(&reset);
+    CHECK(reset.ops[STAT_ARR_SUM].calls == 0 && reset.allocations == 0);
+    CHECK(reset.peak_bytes == reset.live_bytes);
+}
+
+int main(void)
+{
+    test_names();
+    test_counters();
+    return TEST_RESULT();
+}
@@ -0,0 +1,45 @@
+// Minimal checking helpers shared by the test drivers. Every test file is its own executable registered with ctest;
+// a failed CHECK prints where it failed and the driver keeps going so one run reports every failure.
+
+#ifndef ZUMPY_TEST_UTIL_H
+#define ZUMPY_TEST_UTIL_H
+
+#include "../src/c/include/zumpy.h"
+
+static int test_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+// exit code for main()
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
+
+// true if both arrays have the same dtype, shape and elements (compressed arrays are compared by value)
+static inline bool test_arrays_equal(array* a, array* b)
+{
+    if (a->dtype != b->dtype || a->shape_size != b->shape_size || a->total_size != b->total_size)
+        return false;
+    for (size_t i = 0; i < a->shape_size; ++i)
+        if (a->arr_shape[i] != b->arr_shape[i])
+            return false;
+
+    size_t* offsets = malloc(sizeof(size_t) * (a->total_size > 0 ? a->total_size : 1));
+    char* va = malloc(a->type_size * (a->total_size > 0 ? a->total_size : 1));
+    char* vb = malloc(b->type_size * (b->total_size > 0 ? b->total_size : 1));
+    for (size_t i = 0; i < a->total_size; ++i)
+        offsets[i] = i;
+    bool equal = arr_get_flat(a, offsets, a->total_size, va) == 0 && arr_get_flat(b, offsets, b->total_size, vb) == 0
+        && memcmp(va, vb, a->type_size * a->total_size) == 0;
+    free(offsets);
+    free(va);
+    free(vb);
+    return equal;
+}
+
+#endif
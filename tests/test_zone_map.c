@@ -0,0 +1,234 @@
+// Zone map range filters (arr_filter_range) against the element-by-element arr_filter, including NaNs, block edges,
+// a partial last block, invalidation by writes, and the zone map stored in .zmp files.
+
+#include "test_util.h"
+#include <math.h>
+
+static double range_low;
+static double range_high;
+
+static bool in_range_float(void* value)
+{
+    float v = *(float*)value;
+    return v >= range_low && v <= range_high;
+}
+
+static bool in_range_int(void* value)
+{
+    int32_t v = *(int32_t*)value;
+    return v >= range_low && v <= range_high;
+}
+
+// arr_filter_range must return exactly what arr_filter does with the same condition
+static bool range_matches_filter(array* arr, double low, double high, size_t* cols, size_t ncols, filter_type ftype)
+{
+    range_low = low;
+    range_high = high;
+    array expected = {.data = NULL};
+    array actual = {.data = NULL};
+    arr_filter(arr, arr->dtype == FLOAT ? &in_range_float : &in_range_int, cols, ncols, ftype, &expected);
+    arr_filter_range(arr, low, high, cols, ncols, ftype, &actual);
+    bool equal = test_arrays_equal(&expected, &actual);
+    if (!equal)
+        fprintf(stderr, "range [%g, %g] on %zu columns: %zu rows expected, %zu returned\n", low, high, ncols,
+            expected.arr_shape[0], actual.arr_shape[0]);
+    arr_free(&expected);
+    arr_free(&actual);
+    return equal;
+}
+
+// 3000 x 2 floats (two full zone map blocks and a partial one): column 0 is the row number, column 1 the row number
+// modulo 100
+static void make_float_rows(array* arr)
+{
+    size_t shape[] = {3000, 2};
+    arr_init(arr, shape, 2, FLOAT);
+    for (size_t r = 0; r < shape[0]; ++r)
+    {
+        size_t idx[] = {r, 0};
+        float v = r;
+        arr_set(arr, idx, &v);
+        idx[1] = 1;
+        v = r % 100;
+        arr_set(arr, idx, &v);
+    }
+}
+
+static void test_nan_blocks(void)
+{
+    array arr;
+    make_float_rows(&arr);
+    size_t col0[] = {0};
+
+    // warm the zone map first so the NaN is written into a block that was already summarized
+    CHECK(range_matches_filter(&arr, 1024, 2047, col0, 1, ANY));
+
+    float nan = NAN;
+    size_t idx[] = {1500, 0};
+    arr_set(&arr, idx, &nan);
+
+    // the block holding the NaN lies inside the range but must not be taken whole
+    array filtered = {.data = NULL};
+    arr_filter_range(&arr, 1024, 2047, col0, 1, ANY, &filtered);
+    CHECK(filtered.arr_shape[0] == 1023);
+    arr_free(&filtered);
+
+    CHECK(range_matches_filter(&arr, 0, 3000, col0, 1, ANY));
+    CHECK(range_matches_filter(&arr, 0, 3000, NULL, 0, ALL));
+    CHECK(range_matches_filter(&arr, -INFINITY, INFINITY, NULL, 0, ANY));
+
+    // a whole column of NaNs in one block
+    for (size_t r = 0; r < 1024; ++r)
+    {
+        size_t nidx[] = {r, 1};
+        arr_set(&arr, nidx, &nan);
+    }
+    CHECK(range_matches_filter(&arr, 0, 99, NULL, 0, ALL));
+    CHECK(range_matches_filter(&arr, 0, 99, NULL, 0, ANY));
+
+    arr_free(&arr);
+}
+
+static void test_block_edges(void)
+{
+    array arr;
+    make_float_rows(&arr);
+    size_t col0[] = {0};
+    size_t col1[] = {1};
+
+    // bounds on, just before and just after block boundaries, and within the partial last block
+    double edges[] = {0, 1023, 1024, 2047, 2048, 2999, 3000};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); ++i)
+        for (size_t j = i; j < sizeof(edges) / sizeof(edges[0]); ++j)
+        {
+            CHECK(range_matches_filter(&arr, edges[i], edges[j], col0, 1, ANY));
+            CHECK(range_matches_filter(&arr, edges[i] - 0.5, edges[j] + 0.5, col0, 1, ANY));
+        }
+
+    CHECK(range_matches_filter(&arr, 10, 20, col1, 1, ANY));
+    CHECK(range_matches_filter(&arr, 10, 2500, NULL, 0, ANY));
+    CHECK(range_matches_filter(&arr, 10, 2500, NULL, 0, ALL));
+
+    // nothing matches: an empty result
+    array empty = {.data = NULL};
+    arr_filter_range(&arr, 5000, 6000, NULL, 0, ANY, &empty);
+    CHECK(empty.total_size == 0);
+    arr_free(&empty);
+
+    // writes invalidate their block, including the partial last one
+    float v = -7;
+    size_t idx[] = {2990, 0};
+    arr_set(&arr, idx, &v);
+    CHECK(range_matches_filter(&arr, -10, -5, col0, 1, ANY));
+    CHECK(range_matches_filter(&arr, 2048, 3000, col0, 1, ANY));
+    v = 1;
+    arr_fill(&arr, &v);
+    CHECK(range_matches_filter(&arr, 1, 1, NULL, 0, ALL));
+
+    arr_free(&arr);
+}
+
+static void test_int_and_1d(void)
+{
+    size_t shape[] = {5000};
+    array arr;
+    arr_init(&arr, shape, 1, INT32);
+    for (size_t r = 0; r < shape[0]; ++r)
+    {
+        size_t idx[] = {r};
+        int32_t v = (int32_t)((r * 7919) % 5000);
+        arr_set(&arr, idx, &v);
+    }
+    CHECK(range_matches_filter(&arr, 100, 200, NULL, 0, ANY));
+    CHECK(range_matches_filter(&arr, -1, 5000, NULL, 0, ANY));
+    arr_free(&arr);
+}
+
+static void test_saved_zone_map(void)
+{
+    const char* path = "test_zone_map.zmp";
+    array arr;
+    make_float_rows(&arr);
+    float nan = NAN;
+    size_t idx[] = {1500, 0};
+    arr_set(&arr, idx, &nan);
+    arr_zone_map_build(&arr);
+    CHECK(arr_save(&arr, path));
+
+    // the NaN count comes back with the stored zone map
+    array loaded;
+    CHECK(arr_load(&loaded, path));
+    CHECK(loaded.zone_map != NULL);
+    size_t col0[] = {0};
+    array filtered = {.data = NULL};
+    arr_filter_range(&loaded, 1024, 2047, col0, 1, ANY, &filtered);
+    CHECK(filtered.arr_shape[0] == 1023);
+    arr_free(&filtered);
+    CHECK(range_matches_filter(&loaded, 0, 3000, NULL, 0, ALL));
+    arr_free(&loaded);
+    arr_free(&arr);
+    remove(path);
+}
+
+// internal function to write a .zmp file and then overwrite bytes at offset with the given value
+static void write_patched(const char* path, long offset, uint64_t value)
+{
+    size_t shape[] = {4, 2};
+    array arr;
+    arr_zeros(&arr, shape, 2, INT32);
+    arr_save(&arr, path);
+    arr_free(&arr);
+    FILE* file = fopen(path, "r+b");
+    fseek(file, offset, SEEK_SET);
+    fwrite(&value, sizeof(value), 1, file);
+    fclose(file);
+}
+
+static void test_corrupt_headers(void)
+{
+    const char* path = "test_zone_map_corrupt.zmp";
+    array arr;
+
+    // shape_size (offset 16) larger than the file
+    write_patched(path, 16, (uint64_t)1 << 40);
+    CHECK(!arr_load(&arr, path));
+
+    // a dimension (offset 24) describing far more data than the file holds
+    write_patched(path, 24, (uint64_t)1 << 40);
+    CHECK(!arr_load(&arr, path));
+
+    // dimensions whose product overflows
+    write_patched(path, 24, UINT64_MAX / 2);
+    CHECK(!arr_load(&arr, path));
+
+    // truncated data
+    size_t shape[] = {100};
+    arr_zeros(&arr, shape, 1, FLOAT);
+    arr_save(&arr, path);
+    arr_free(&arr);
+    FILE* file = fopen(path, "r+b");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    char* bytes = malloc(size);
+    file = fopen(path, "rb");
+    fread(bytes, 1, size, file);
+    fclose(file);
+    file = fopen(path, "wb");
+    fwrite(bytes, 1, size - 8, file);
+    fclose(file);
+    free(bytes);
+    CHECK(!arr_load(&arr, path));
+
+    remove(path);
+}
+
+int main(void)
+{
+    test_nan_blocks();
+    test_block_edges();
+    test_int_and_1d();
+    test_saved_zone_map();
+    test_corrupt_headers();
+    return TEST_RESULT();
+}